@@ -0,0 +1,364 @@
+#include "apu.h"
+#include "block.h"
+#include "bus.h"
+#include "emu.h"
+#include "nes.h"
+#include "ppu.h"
+#include "tile.h"
+#include "trace.h"
+#include "runner.h"
+#include "state.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NTSC_CPU_HZ 1789773.0
+#define REPETITIONS 7
+#define MIX_CYCLES 50000000ull
+#define ROM_FRAMES 600ull
+#define PPU_FRAMES 120
+#define TILE_ROWS 200000000ull
+#define STATES 20000
+#define APU_SECONDS 60
+
+// Each mix is an endless loop at $0200 exercising one class of instructions.
+typedef struct {
+  const char *name;
+  const u8 *code;
+  u32 size;
+} Mix;
+
+// LDA #; ADC #; AND #; ORA #; EOR #; TAX; TAY; INX; DEY; CLC; SEC; JMP
+static const u8 ALU_MIX[] = {0xA9, 0x35, 0x69, 0x11, 0x29, 0xF7, 0x09,
+                             0x02, 0x49, 0x55, 0xAA, 0xA8, 0xE8, 0x88,
+                             0x18, 0x38, 0x4C, 0x00, 0x02};
+
+// LDA abs,X; STA zp; LDA (zp),Y; STA abs,Y; INC zp; DEC abs; ASL zp; INX;
+// INY; JMP
+static const u8 MEMORY_MIX[] = {0xBD, 0x00, 0x03, 0x85, 0x10, 0xB1, 0x20,
+                                0x99, 0x00, 0x04, 0xE6, 0x11, 0xCE, 0x00,
+                                0x05, 0x06, 0x12, 0xE8, 0xC8, 0x4C, 0x00,
+                                0x02};
+
+// LDX #$10; loop: CMP #; BEQ +0; DEX; BNE loop; BIT zp; BMI +0; JMP
+static const u8 BRANCH_MIX[] = {0xA2, 0x10, 0xC9, 0x40, 0xF0, 0x00, 0xCA,
+                                0xD0, 0xF9, 0x24, 0x10, 0x30, 0x00, 0x4C,
+                                0x00, 0x02};
+
+// JSR sub; PHA; PHP; PLP; PLA; JMP; sub: TSX; TXS; RTS
+static const u8 STACK_MIX[] = {0x20, 0x0A, 0x02, 0x48, 0x08, 0x28, 0x68,
+                               0x4C, 0x00, 0x02, 0xBA, 0x9A, 0x60};
+
+static const Mix MIXES[] = {
+    {"alu", ALU_MIX, sizeof(ALU_MIX)},
+    {"memory", MEMORY_MIX, sizeof(MEMORY_MIX)},
+    {"branch", BRANCH_MIX, sizeof(BRANCH_MIX)},
+    {"stack", STACK_MIX, sizeof(STACK_MIX)},
+};
+
+static const char *const ENGINE_NAMES[] = {"interp", "blocks", "jit"};
+
+typedef struct {
+  double mean;
+  double stddev;
+  double min;
+  double max;
+} Stats;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Stats stats(const double *samples, u32 count) {
+  Stats s = {0, 0, samples[0], samples[0]};
+  for (u32 i = 0; i < count; i++) {
+    s.mean += samples[i];
+    s.min = samples[i] < s.min ? samples[i] : s.min;
+    s.max = samples[i] > s.max ? samples[i] : s.max;
+  }
+  s.mean /= count;
+  for (u32 i = 0; i < count; i++) {
+    s.stddev += (samples[i] - s.mean) * (samples[i] - s.mean);
+  }
+  s.stddev = sqrt(s.stddev / count);
+  return s;
+}
+
+static void load_mix(CPU *cpu, u8 *mem, const Mix *mix) {
+  memset(mem, 0, 0x10000);
+  memcpy(mem + 0x0200, mix->code, mix->size);
+  mem[0x20] = 0x00;
+  mem[0x21] = 0x06;
+  power_on(cpu);
+  bus_map(&cpu->bus, 0x00, 0xFF, mem, 0x10000, 1);
+  cpu->PC = 0x0200;
+  cpu->S = 0xFD;
+}
+
+// Average cycles per instruction, counted once with execute() so the timed
+// runs can go through run_until() untouched.
+static double cycles_per_instruction(CPU *cpu, u8 *mem, const Mix *mix) {
+  u64 instructions = 0;
+  load_mix(cpu, mem, mix);
+  while (cpu->cycles < 100000) {
+    execute(cpu);
+    instructions++;
+  }
+  return (double)cpu->cycles / instructions;
+}
+
+static void bench_mix(CPU *cpu, u8 *mem, const Mix *mix, Engine engine) {
+  double mhz[REPETITIONS];
+  double cpi = cycles_per_instruction(cpu, mem, mix);
+
+  for (u32 rep = 0; rep < REPETITIONS; rep++) {
+    load_mix(cpu, mem, mix);
+    if (engine == ENGINE_BLOCKS) {
+      block_cache_attach(cpu);
+    } else if (engine == ENGINE_JIT) {
+      block_cache_attach_jit(cpu);
+    }
+    double start = now();
+    run_until(cpu, MIX_CYCLES);
+    double elapsed = now() - start;
+    mhz[rep] = cpu->cycles / elapsed / 1e6;
+    block_cache_detach(cpu);
+  }
+
+  Stats s = stats(mhz, REPETITIONS);
+  printf("engine=%-6s mix=%-8s mhz=%8.2f stddev=%6.2f min=%8.2f max=%8.2f "
+         "mips=%8.2f realtime=%7.1fx fps=%8.1f\n",
+         ENGINE_NAMES[engine], mix->name, s.mean, s.stddev, s.min, s.max,
+         s.mean / cpi,
+         s.mean * 1e6 / NTSC_CPU_HZ,
+         s.mean * 1e6 / FRAMES_TO_CPU_CYCLES(1.0));
+}
+
+static void bench_rom(NES *nes, const char *path, Engine engine) {
+  double fps[REPETITIONS];
+  double mhz = 0;
+  RunConfig config = {.max_cycles = FRAMES_TO_CPU_CYCLES(ROM_FRAMES),
+                      .engine = engine};
+
+  for (u32 rep = 0; rep < REPETITIONS; rep++) {
+    RomError err = nes_load(nes, path);
+    if (err != ROM_OK) {
+      printf("rom=%s error=\"%s\"\n", path, rom_error_str(err));
+      return;
+    }
+    double start = now();
+    RunResult result = runner_run(nes, &config);
+    double elapsed = now() - start;
+    nes_unload(nes);
+    fps[rep] = CPU_CYCLES_TO_FRAMES((double)result.cycles) / elapsed;
+    mhz += result.cycles / elapsed / 1e6 / REPETITIONS;
+  }
+
+  Stats s = stats(fps, REPETITIONS);
+  printf("engine=%s rom=%s fps=%.1f stddev=%.1f min=%.1f max=%.1f "
+         "mhz=%.2f\n",
+         ENGINE_NAMES[engine], path, s.mean, s.stddev, s.min, s.max, mhz);
+}
+
+// What recording every instruction costs the interpreter on each mix.
+static void bench_trace(CPU *cpu, u8 *mem) {
+  static Trace trace;
+  trace_init(&trace, TRACE_DEFAULT_ENTRIES);
+  for (u32 i = 0; i < sizeof(MIXES) / sizeof(MIXES[0]); i++) {
+    double mhz[REPETITIONS];
+    for (u32 rep = 0; rep < REPETITIONS; rep++) {
+      load_mix(cpu, mem, &MIXES[i]);
+      cpu->trace = &trace;
+      double start = now();
+      run_until(cpu, MIX_CYCLES);
+      mhz[rep] = cpu->cycles / (now() - start) / 1e6;
+    }
+    Stats s = stats(mhz, REPETITIONS);
+    printf("trace mix=%-8s mhz=%8.2f stddev=%6.2f min=%8.2f max=%8.2f\n",
+           MIXES[i].name, s.mean, s.stddev, s.min, s.max);
+  }
+  trace_free(&trace);
+}
+
+// A busy screen: random tiles and palettes with all 64 sprites on it.
+static void load_scene(PPU *ppu) {
+  static Rom rom = {.mirroring = MIRROR_VERTICAL};
+  u32 seed = 1;
+  ppu_power_on(ppu, &rom);
+  for (u32 addr = 0; addr < 0x3F20; addr++) {
+    seed = seed * 1103515245 + 12345;
+    ppu_write(ppu, addr, seed >> 16);
+  }
+  for (u32 i = 0; i < 256; i++) {
+    seed = seed * 1103515245 + 12345;
+    ppu->oam[i] = seed >> 16;
+  }
+  ppu_write_register(ppu, 0x2001, PPU_MASK_BACKGROUND | PPU_MASK_SPRITES);
+}
+
+// Frames per second drawn by the scanline renderer, when nothing interrupts
+// a line, and by the dot renderer, when every dot is caught up on its own.
+static void bench_ppu(PPU *ppu, u32 step) {
+  double fps[REPETITIONS];
+  u64 dots = (u64)PPU_FRAMES * PPU_LINES_PER_FRAME * PPU_DOTS_PER_LINE;
+
+  for (u32 rep = 0; rep < REPETITIONS; rep++) {
+    load_scene(ppu);
+    double start = now();
+    while (ppu->dots < dots) {
+      ppu_run_to(ppu, ppu->dots + step);
+    }
+    fps[rep] = ppu->frame / (now() - start);
+  }
+
+  Stats s = stats(fps, REPETITIONS);
+  printf("ppu=%-4s fps=%.1f stddev=%.1f min=%.1f max=%.1f\n",
+         step == 1 ? "dot" : "line", s.mean, s.stddev, s.min, s.max);
+}
+
+// Millions of tile rows (8 pixels each) merged per second by each decoder,
+// in batches of a scanline's 32.
+static void bench_tiles(void) {
+  const TileDecoder *decoders;
+  u32 count = tile_decoders(&decoders);
+  u8 lo[32], hi[32], palette[32], out[32 * 8];
+  for (u32 i = 0; i < 32; i++) {
+    lo[i] = i * 37;
+    hi[i] = i * 91;
+    palette[i] = i & 3;
+  }
+
+  for (u32 d = 0; d < count; d++) {
+    double rows[REPETITIONS];
+    for (u32 rep = 0; rep < REPETITIONS; rep++) {
+      double start = now();
+      for (u64 done = 0; done < TILE_ROWS; done += 32) {
+        decoders[d].decode(lo, hi, palette, 32, out);
+        __asm__ volatile("" : : "r"(out) : "memory");
+      }
+      rows[rep] = TILE_ROWS / (now() - start) / 1e6;
+    }
+    Stats s = stats(rows, REPETITIONS);
+    printf("tiles=%-6s mrows=%.1f stddev=%.1f min=%.1f max=%.1f\n",
+           decoders[d].name, s.mean, s.stddev, s.min, s.max);
+  }
+}
+
+// Seconds of sound made per second, with every channel playing and the
+// samples read out a frame at a time, in each audio mode.
+static void bench_apu(u8 *mem, ApuAudio audio) {
+  static const char *const MODES[] = {"full", "decimated", "off"};
+  static Apu apu;
+  static Bus bus;
+  static s16 samples[APU_SAMPLE_RATE / 30];
+  static const u16 WRITES[][2] = {
+      {0x4015, 0x1F}, {0x4000, 0xBF}, {0x4002, 0xFD}, {0x4003, 0x08},
+      {0x4004, 0x7F}, {0x4006, 0xA9}, {0x4007, 0x08}, {0x4008, 0xFF},
+      {0x400A, 0x7E}, {0x400B, 0x08}, {0x400C, 0x3F}, {0x400E, 0x04},
+      {0x400F, 0x08}, {0x4010, 0x4F}, {0x4012, 0x00}, {0x4013, 0xFF},
+      {0x4015, 0x1F},
+  };
+  for (u32 i = 0; i < 0x4000; i++) {
+    mem[0xC000 + i] = i * 77;
+  }
+  bus_init(&bus);
+  bus_map(&bus, 0xC0, 0xFF, mem + 0xC000, 0x4000, 0);
+
+  double realtime[REPETITIONS];
+  for (u32 rep = 0; rep < REPETITIONS; rep++) {
+    apu_power_on(&apu, &bus, APU_SAMPLE_RATE);
+    apu_set_audio(&apu, audio);
+    for (u32 i = 0; i < sizeof(WRITES) / sizeof(WRITES[0]); i++) {
+      apu_write(&apu, WRITES[i][0], WRITES[i][1]);
+    }
+    u64 end = (u64)APU_SECONDS * APU_CLOCK_RATE;
+    double start = now();
+    for (u64 cycle = 0; cycle < end; cycle += APU_BLOCK_CYCLES) {
+      apu_run_to(&apu, cycle + APU_BLOCK_CYCLES);
+      apu_read_samples(&apu, samples, sizeof(samples) / sizeof(samples[0]));
+    }
+    realtime[rep] = APU_SECONDS / (now() - start);
+    apu_free(&apu);
+  }
+
+  Stats s = stats(realtime, REPETITIONS);
+  printf("apu=%-9s realtime=%.1fx stddev=%.1f min=%.1f max=%.1f\n",
+         MODES[audio], s.mean, s.stddev, s.min, s.max);
+}
+
+// Microseconds per save, per update of a saved state with no pages written
+// since, and per restore of a whole machine, as a search or rollback loop
+// would do them back to back.
+static void bench_state(NES *nes) {
+  static u8 prg[0x8000];
+  static Rom rom = {
+      .prg = prg, .prg_size = sizeof(prg), .mirroring = MIRROR_VERTICAL};
+  static const char *const OPS[] = {"save", "update", "load"};
+  u8 *buf = malloc(state_size());
+  power_on(&nes->cpu);
+  ppu_power_on(&nes->ppu, &rom);
+  mapper_init(&nes->mapper, &rom, &nes->cpu.bus, &nes->ppu);
+  apu_power_on(&nes->apu, &nes->cpu.bus, APU_SAMPLE_RATE);
+  sched_init(&nes->sched);
+
+  for (u32 op = 0; op < 3; op++) {
+    double us[REPETITIONS];
+    state_save(nes, buf);
+    for (u32 rep = 0; rep < REPETITIONS; rep++) {
+      double start = now();
+      for (u32 i = 0; i < STATES; i++) {
+        if (op == 0) {
+          state_save(nes, buf);
+        } else if (op == 1) {
+          state_update(nes, buf);
+        } else {
+          state_load(nes, buf, state_size());
+        }
+        __asm__ volatile("" : : "r"(buf) : "memory");
+      }
+      us[rep] = (now() - start) * 1e6 / STATES;
+    }
+    Stats s = stats(us, REPETITIONS);
+    printf("state=%-6s bytes=%u us=%.2f stddev=%.2f min=%.2f max=%.2f\n",
+           OPS[op], state_size(), s.mean, s.stddev, s.min, s.max);
+  }
+  apu_free(&nes->apu);
+  free(buf);
+}
+
+int main(int argc, char *argv[]) {
+  static CPU cpu;
+  static NES nes;
+  static PPU ppu;
+  u8 *mem = malloc(0x10000);
+
+#ifdef THREADED_DISPATCH
+  printf("dispatch=threaded repetitions=%d\n", REPETITIONS);
+#else
+  printf("dispatch=call repetitions=%d\n", REPETITIONS);
+#endif
+  for (Engine engine = ENGINE_INTERPRETER; engine <= ENGINE_JIT; engine++) {
+    for (u32 i = 0; i < sizeof(MIXES) / sizeof(MIXES[0]); i++) {
+      bench_mix(&cpu, mem, &MIXES[i], engine);
+    }
+    for (int i = 1; i < argc; i++) {
+      bench_rom(&nes, argv[i], engine);
+    }
+  }
+
+  bench_trace(&cpu, mem);
+  bench_ppu(&ppu, PPU_LINES_PER_FRAME * PPU_DOTS_PER_LINE);
+  bench_ppu(&ppu, 1);
+  bench_tiles();
+  for (ApuAudio audio = APU_AUDIO_FULL; audio <= APU_AUDIO_OFF; audio++) {
+    bench_apu(mem, audio);
+  }
+  bench_state(&nes);
+
+  free(mem);
+  return 0;
+}
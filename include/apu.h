@@ -0,0 +1,162 @@
+#ifndef APU_H
+#define APU_H
+
+#include "blip.h"
+#include "types.h"
+
+#define APU_CLOCK_RATE 1789773 // NTSC CPU cycles per second
+#define APU_SAMPLE_RATE 48000
+// Cycles per block of samples, about a frame. Samples become readable a block
+// at a time.
+#define APU_BLOCK_CYCLES 29780
+#define APU_BUFFER_BLOCKS 8 // Blocks kept before the oldest are dropped
+#define APU_DECIMATION 4    // Fewer samples by this much when decimated
+// CPU cycles a DMC fetch halts the CPU for. It's 3 when the halt lands on a
+// write, which the APU can't tell.
+#define APU_DMC_STALL 4
+
+// How much of the sound is made. Whatever the CPU can see, lengths, the
+// frame counter, the DMC's fetches and stalls and the cycles interrupts are
+// raised on, runs the same in all of them; only the waveforms, which nothing
+// but a listener observes, are cut.
+typedef enum : u8 {
+  APU_AUDIO_FULL,      // At the sample rate given at power on
+  APU_AUDIO_DECIMATED, // At a quarter of it, for previews and checks
+  APU_AUDIO_OFF,       // None at all: channels skip their timer clocks
+} ApuAudio;
+
+typedef enum : u8 {
+  APU_STATUS_PULSE1 = 0x01,
+  APU_STATUS_PULSE2 = 0x02,
+  APU_STATUS_TRIANGLE = 0x04,
+  APU_STATUS_NOISE = 0x08,
+  APU_STATUS_DMC = 0x10,
+  APU_STATUS_FRAME_IRQ = 0x40,
+  APU_STATUS_DMC_IRQ = 0x80,
+} ApuStatus;
+
+// Volume envelope shared by the pulse and noise channels.
+typedef struct {
+  u8 start;
+  u8 divider;
+  u8 decay;
+  u8 period; // Also the constant volume
+  u8 constant;
+  u8 loop; // Also halts the length counter
+} Envelope;
+
+typedef struct {
+  Envelope envelope;
+  u8 length;
+  u8 duty;
+  u8 step; // Position in the 8-step duty sequence
+  u8 sweep_enabled;
+  u8 sweep_period;
+  u8 sweep_negate;
+  u8 sweep_shift;
+  u8 sweep_divider;
+  u8 sweep_reload;
+  u16 period; // Timer period, clocked every other CPU cycle
+  u64 next;   // CPU cycle of the next timer clock
+  u8 output;  // Level last put into the buffer
+} Pulse;
+
+typedef struct {
+  u8 length;
+  u8 control; // Also halts the length counter
+  u8 linear;
+  u8 linear_load;
+  u8 linear_reload;
+  u8 step; // Position in the 32-step sequence
+  u16 period;
+  u64 next;
+  u8 output;
+} Triangle;
+
+typedef struct {
+  Envelope envelope;
+  u8 length;
+  u8 short_mode; // 93-step sequences instead of 32767
+  u8 rate;       // Index into the period table
+  u16 shift;     // The 15-bit LFSR
+  u64 next;
+  u8 output;
+} Noise;
+
+typedef struct {
+  u8 irq_enabled;
+  u8 loop;
+  u8 rate;
+  u8 level; // The 7-bit output level, also what it puts out
+  u16 sample_addr;
+  u16 sample_length;
+  u16 addr; // Next byte to fetch
+  u16 bytes_left;
+  u8 buffer;
+  u8 buffer_full;
+  u8 shift;
+  u8 bits_left;
+  u8 silent;
+  u64 next;
+  u8 output;
+} Dmc;
+
+// The 2A03's sound. Like the PPU it only runs when caught up with
+// apu_run_to, and then it doesn't tick: each channel jumps from one timer
+// clock to the next, the frame counter from one step to the next, and a
+// channel only touches the Blip buffer on the clocks where its output level
+// actually changes. Channels with nothing to play skip their clocks in one go.
+typedef struct {
+  // Everything from pulse up to bus is plain data, which save states copy as
+  // it is.
+  Pulse pulse[2];
+  Triangle triangle;
+  Noise noise;
+  Dmc dmc;
+  u8 enabled;     // Channels switched on through $4015, as ApuStatus bits
+  u8 five_step;   // Frame counter mode
+  u8 irq_inhibit; // Frame interrupts disabled
+  u8 status;      // APU_STATUS_FRAME_IRQ and APU_STATUS_DMC_IRQ
+  u8 frame_step;
+  u64 frame_next;  // CPU cycle of the next frame counter step
+  u64 cycles;      // CPU cycle it has run up to
+  u64 block_start; // CPU cycle the open block of samples started at
+
+  const Bus *bus; // Where the DMC fetches its samples
+  u32 dmc_stall;  // CPU cycles the DMC's fetches took, for the console to
+                  // stall the CPU by and reset
+  ApuAudio audio;
+  u32 sample_rate; // Of APU_AUDIO_FULL
+  u32 blip_rate;   // What blip was last opened at
+  Blip blip;
+} Apu;
+
+// Resets the APU and allocates its sample buffer. Returns -1 if it can't.
+int apu_power_on(Apu *apu, const Bus *bus, u32 sample_rate);
+void apu_free(Apu *apu);
+// The reset button: silences every channel, as writing 0 to $4015 does,
+// acknowledges both interrupts and restarts the frame counter in its mode.
+void apu_reset(Apu *apu);
+// Switches how much sound is made, from the current cycle on. Samples not read
+// yet are dropped. Returns -1 if the buffer for the new rate can't be had.
+int apu_set_audio(Apu *apu, ApuAudio audio);
+
+// Runs until the given CPU cycle.
+void apu_run_to(Apu *apu, u64 cycle);
+
+// $4000-$4013, $4015 and $4017, at the cycle the APU has been run up to.
+void apu_write(Apu *apu, u16 addr, u8 val);
+// $4015. Acknowledges the frame interrupt.
+u8 apu_read_status(Apu *apu);
+
+// The CPU cycles the frame interrupt will be raised and the DMC will fetch
+// next on, if the registers aren't written before, or UINT64_MAX if they
+// won't. The APU has to be run past them to get there.
+u64 apu_next_frame_irq(const Apu *apu);
+u64 apu_next_dmc_fetch(const Apu *apu);
+
+// Reads up to count samples of finished blocks as signed 16-bit mono and
+// returns how many there were.
+u32 apu_read_samples(Apu *apu, s16 *out, u32 count);
+
+#endif // APU_H
@@ -0,0 +1,45 @@
+#ifndef BLIP_H
+#define BLIP_H
+
+#include "types.h"
+
+#define BLIP_PHASE_BITS 6 // Steps are placed to 1/64 of an output sample
+#define BLIP_PHASES (1 << BLIP_PHASE_BITS)
+#define BLIP_TAPS 16      // Output samples one step is spread over
+#define BLIP_KERNEL_BITS 15 // Each phase of the kernel sums to 1 << this
+
+// Band-limited step synthesis. A source adds a delta whenever its output
+// changes, timed in input clocks, and the delta goes straight into the buffer
+// as a band-limited impulse at the output rate. Resampling happens there and
+// then, so a source that changes every few hundred clocks costs that much and
+// never produces one sample per clock. Time runs in blocks: blip_end_block
+// closes the open block, making its samples readable, and starts the next
+// one at clock 0.
+typedef struct {
+  u64 factor;     // Output samples per clock, 32.32 fixed point
+  u64 offset;     // Where clock 0 of the open block lands in buf, 32.32
+  u32 avail;      // Samples of closed blocks, ready to read
+  u32 size;       // Samples buf holds, not counting the kernel's overhang
+  s32 integrator; // Sum of every delta read so far, the waveform's level
+  s32 *buf;       // Impulses not read yet
+  s16 kernel[BLIP_PHASES][BLIP_TAPS];
+} Blip;
+
+// Allocates room for size samples. Returns -1 if it can't.
+int blip_init(Blip *blip, u32 clock_rate, u32 sample_rate, u32 size);
+void blip_free(Blip *blip);
+// Drops everything buffered and starts a new block at clock 0.
+void blip_clear(Blip *blip);
+
+// How many output samples clocks input clocks make, rounded up.
+u32 blip_samples(const Blip *blip, u32 clocks);
+// Adds a step of delta at time clocks into the open block.
+void blip_add_delta(Blip *blip, u32 time, s32 delta);
+// Closes the open block after clocks. The caller keeps avail plus the block
+// within size, see blip_samples.
+void blip_end_block(Blip *blip, u32 clocks);
+// Reads up to count samples into out, or drops them if out is NULL. Returns
+// how many there were.
+u32 blip_read(Blip *blip, s16 *out, u32 count);
+
+#endif // BLIP_H
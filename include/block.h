@@ -0,0 +1,58 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include "emu.h"
+
+#define BLOCK_MAX_INSTRUCTIONS 16
+#define BLOCK_CACHE_SIZE 2048 // Entries, must be a power of two
+
+typedef struct Jit Jit;
+// Native translation of a block, see jit.h.
+typedef void (*JitCode)(CPU *cpu);
+
+// Set in a decoded operand, so that operand 0 can be told from none.
+#define OPERAND_DECODED 0x10000
+
+// A straight run of instructions within one page, decoded once along with
+// their operands, which for zero page and absolute modes are the effective
+// addresses. Handlers get them through cpu->operand instead of fetching them
+// again. A store into the page, operands included, bumps its generation
+// through the bus's code[] flags, which retires the block. The only operand
+// outside the page, that of a last instruction crossing into the next one,
+// isn't decoded and is fetched as usual.
+typedef struct {
+  u16 pc;
+  u8 count;
+  u32 generation; // The page's generation when the block was decoded
+  const u8 *page; // The memory the page was mapped to at the time
+  u16 hits;       // Runs so far, for picking blocks worth translating
+  u16 max_cycles; // Upper bound on the cycles one run can take
+  JitCode native; // NULL until the JIT has translated the block
+  Instruction instructions[BLOCK_MAX_INSTRUCTIONS];
+  u32 operands[BLOCK_MAX_INSTRUCTIONS]; // With OPERAND_DECODED, or 0
+} Block;
+
+// Direct-mapped on PC. A write to a page holding blocks bumps that page's
+// generation, which retires all of its blocks at once. Remapping a page (a
+// mapper bank switch) is caught by the page pointer check, both on lookup and
+// after every instruction, since a block can switch out its own bank.
+struct BlockCache {
+  Jit *jit; // NULL unless hot blocks get translated to native code
+  u32 generation[256];
+  Block blocks[BLOCK_CACHE_SIZE];
+};
+
+// Gives the CPU a fresh block cache so run_until executes from it.
+void block_cache_attach(CPU *cpu);
+// As block_cache_attach, additionally translating hot blocks to native code
+// where the host supports it.
+void block_cache_attach_jit(CPU *cpu);
+void block_cache_detach(CPU *cpu);
+
+// Runs until cpu->deadline or the CPU halts.
+void block_run(CPU *cpu);
+
+// Called by write_byte when it stores into a page with cached code.
+void block_invalidate_page(CPU *cpu, u8 page);
+
+#endif // BLOCK_H
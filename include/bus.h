@@ -0,0 +1,31 @@
+#ifndef BUS_H
+#define BUS_H
+
+#include "types.h"
+
+// Unmaps every page. Unmapped reads return the high byte of the address, as
+// open bus mostly does on hardware, and unmapped writes are dropped.
+void bus_init(Bus *bus);
+
+// Maps pages first..last onto mem, wrapping every size bytes so that smaller
+// blocks are mirrored across the range. size must be a multiple of 256.
+// Read-only mappings drop writes.
+void bus_map(Bus *bus, u8 first, u8 last, u8 *mem, u32 size, u8 writable);
+
+// Maps pages first..last onto mem for reading, like a read-only bus_map, but
+// keeps their write handlers: cartridge registers sit under the ROM they
+// switch, and a bank switch only moves the read pointers.
+void bus_map_rom(Bus *bus, u8 first, u8 last, u8 *mem, u32 size);
+
+// Routes every access to pages first..last through the given handlers. A NULL
+// handler leaves that direction open bus.
+void bus_map_io(Bus *bus, u8 first, u8 last, BusReadFunc read,
+                BusWriteFunc write, void *ctx);
+
+// write_byte marks every page it writes to, I/O or not, so checkpoints (save
+// states, rewind, rollback) can copy only the pages that changed since the
+// last one.
+void bus_clear_dirty(Bus *bus);
+u8 bus_page_dirty(const Bus *bus, u8 page);
+
+#endif // BUS_H
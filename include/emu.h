@@ -0,0 +1,34 @@
+#ifndef EMU_H
+#define EMU_H
+
+#include "types.h"
+
+typedef void (*InstructionFunc)(CPU *);
+
+typedef struct {
+  InstructionFunc func;
+  u8 length; // Bytes to advance PC by after func, 0 if func sets PC itself
+  u8 cycles; // Base cycle count, before page-crossing/branch penalties
+} Instruction;
+
+extern const Instruction INSTRUCTION_TABLE[256];
+
+typedef enum : u8 {
+  ENGINE_INTERPRETER, // Fetch and decode every instruction
+  ENGINE_BLOCKS,      // Run pre-decoded basic blocks, see block.h
+  ENGINE_JIT,         // Blocks, with hot ones translated to native code
+} Engine;
+
+void power_on(CPU *cpu);
+void reset(CPU *cpu);
+void execute(CPU *cpu);
+// Runs until the cycle counter reaches cycles or the CPU halts, from the
+// block cache if one is attached, or one instruction at a time if a trace is.
+// The last instruction may overshoot the target by a few cycles.
+void run_until(CPU *cpu, u64 cycles);
+void run_loop(CPU *cpu);
+// Makes the run_until in progress return once the current instruction is done,
+// for I/O handlers that need the caller to act (e.g. deliver an interrupt).
+void stop_run(CPU *cpu);
+
+#endif // EMU_H
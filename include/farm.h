@@ -0,0 +1,36 @@
+#ifndef FARM_H
+#define FARM_H
+
+#include "runner.h"
+
+typedef struct {
+  char *rom;
+  RunConfig config;
+  RunStatus expect;
+  RunResult result;
+} FarmJob;
+
+typedef struct {
+  FarmJob *jobs;
+  u32 count;
+} FarmJobList;
+
+// Reads a job list with one job per line:
+//   <rom> <frames> <until|blargg|-> <pass|timeout|jam|fail>
+// Blank lines and lines starting with # are skipped. ROM paths are relative
+// to the list's directory. Returns 0 on success, or the failing line number.
+int farm_load(FarmJobList *list, const char *path);
+void farm_free(FarmJobList *list);
+
+// Runs every job on its own emulator instance across threads workers (0 for
+// one per online core). Each worker owns a deque of jobs and steals from the
+// others once its own runs dry, so long ROMs don't leave cores idle.
+void farm_run(FarmJobList *list, u32 threads);
+
+// Prints each job's result line followed by a summary; returns the number of
+// jobs whose status didn't match what was expected.
+u32 farm_report(FILE *out, const FarmJobList *list);
+// The same as Unity test lines, see runner_print_unity.
+u32 farm_report_unity(FILE *out, const FarmJobList *list);
+
+#endif // FARM_H
@@ -0,0 +1,163 @@
+#ifndef INSTRUCTIONS_H
+#define INSTRUCTIONS_H
+
+#include "opcode.h"
+
+// Every official opcode as X(opcode, handler, length, cycles). The length is
+// how far the dispatcher advances PC after the handler runs; it is 0 for
+// instructions that set PC themselves (JMP, JSR, RTS, RTI, BRK). Cycles is the
+// base cost: handlers add page-crossing and branch-taken penalties on top.
+#define INSTRUCTION_LIST(X)                                                    \
+  X(ADC_IMM, adc_immediate, 2, 2)                                              \
+  X(ADC_ZP, adc_zeropage, 2, 3)                                                \
+  X(ADC_ZPX, adc_zeropage_x, 2, 4)                                             \
+  X(ADC_ABS, adc_absolute, 3, 4)                                               \
+  X(ADC_ABSX, adc_absolute_x, 3, 4)                                            \
+  X(ADC_ABSY, adc_absolute_y, 3, 4)                                            \
+  X(ADC_INDX, adc_indirect_x, 2, 6)                                            \
+  X(ADC_INDY, adc_indirect_y, 2, 5)                                            \
+  X(AND_IMM, and_immediate, 2, 2)                                              \
+  X(AND_ZP, and_zeropage, 2, 3)                                                \
+  X(AND_ZPX, and_zeropage_x, 2, 4)                                             \
+  X(AND_ABS, and_absolute, 3, 4)                                               \
+  X(AND_ABSX, and_absolute_x, 3, 4)                                            \
+  X(AND_ABSY, and_absolute_y, 3, 4)                                            \
+  X(AND_INDX, and_indirect_x, 2, 6)                                            \
+  X(AND_INDY, and_indirect_y, 2, 5)                                            \
+  X(ASL_ACC, asl_accumulator, 1, 2)                                            \
+  X(ASL_ZP, asl_zeropage, 2, 5)                                                \
+  X(ASL_ZPX, asl_zeropage_x, 2, 6)                                             \
+  X(ASL_ABS, asl_absolute, 3, 6)                                               \
+  X(ASL_ABSX, asl_absolute_x, 3, 7)                                            \
+  X(BCC_REL, bcc, 2, 2)                                                        \
+  X(BCS_REL, bcs, 2, 2)                                                        \
+  X(BEQ_REL, beq, 2, 2)                                                        \
+  X(BIT_ZP, bit_zeropage, 2, 3)                                                \
+  X(BIT_ABS, bit_absolute, 3, 4)                                               \
+  X(BMI_REL, bmi, 2, 2)                                                        \
+  X(BNE_REL, bne, 2, 2)                                                        \
+  X(BPL_REL, bpl, 2, 2)                                                        \
+  X(BRK_IMP, brk, 0, 7)                                                        \
+  X(BVC_REL, bvc, 2, 2)                                                        \
+  X(BVS_REL, bvs, 2, 2)                                                        \
+  X(CLC_IMP, clc, 1, 2)                                                        \
+  X(CLD_IMP, cld, 1, 2)                                                        \
+  X(CLI_IMP, cli, 1, 2)                                                        \
+  X(CLV_IMP, clv, 1, 2)                                                        \
+  X(CMP_IMM, cmp_immediate, 2, 2)                                              \
+  X(CMP_ZP, cmp_zeropage, 2, 3)                                                \
+  X(CMP_ZPX, cmp_zeropage_x, 2, 4)                                             \
+  X(CMP_ABS, cmp_absolute, 3, 4)                                               \
+  X(CMP_ABSX, cmp_absolute_x, 3, 4)                                            \
+  X(CMP_ABSY, cmp_absolute_y, 3, 4)                                            \
+  X(CMP_INDX, cmp_indirect_x, 2, 6)                                            \
+  X(CMP_INDY, cmp_indirect_y, 2, 5)                                            \
+  X(CPX_IMM, cpx_immediate, 2, 2)                                              \
+  X(CPX_ZP, cpx_zeropage, 2, 3)                                                \
+  X(CPX_ABS, cpx_absolute, 3, 4)                                               \
+  X(CPY_IMM, cpy_immediate, 2, 2)                                              \
+  X(CPY_ZP, cpy_zeropage, 2, 3)                                                \
+  X(CPY_ABS, cpy_absolute, 3, 4)                                               \
+  X(DEC_ZP, dec_zeropage, 2, 5)                                                \
+  X(DEC_ZPX, dec_zeropage_x, 2, 6)                                             \
+  X(DEC_ABS, dec_absolute, 3, 6)                                               \
+  X(DEC_ABSX, dec_absolute_x, 3, 7)                                            \
+  X(DEX_IMP, dex, 1, 2)                                                        \
+  X(DEY_IMP, dey, 1, 2)                                                        \
+  X(EOR_IMM, eor_immediate, 2, 2)                                              \
+  X(EOR_ZP, eor_zeropage, 2, 3)                                                \
+  X(EOR_ZPX, eor_zeropage_x, 2, 4)                                             \
+  X(EOR_ABS, eor_absolute, 3, 4)                                               \
+  X(EOR_ABSX, eor_absolute_x, 3, 4)                                            \
+  X(EOR_ABSY, eor_absolute_y, 3, 4)                                            \
+  X(EOR_INDX, eor_indirect_x, 2, 6)                                            \
+  X(EOR_INDY, eor_indirect_y, 2, 5)                                            \
+  X(INC_ZP, inc_zeropage, 2, 5)                                                \
+  X(INC_ZPX, inc_zeropage_x, 2, 6)                                             \
+  X(INC_ABS, inc_absolute, 3, 6)                                               \
+  X(INC_ABSX, inc_absolute_x, 3, 7)                                            \
+  X(INX_IMP, inx, 1, 2)                                                        \
+  X(INY_IMP, iny, 1, 2)                                                        \
+  X(JMP_ABS, jmp_absolute, 0, 3)                                               \
+  X(JMP_IND, jmp_indirect, 0, 5)                                               \
+  X(JSR_ABS, jsr, 0, 6)                                                        \
+  X(LDA_IMM, lda_immediate, 2, 2)                                              \
+  X(LDA_ZP, lda_zeropage, 2, 3)                                                \
+  X(LDA_ZPX, lda_zeropage_x, 2, 4)                                             \
+  X(LDA_ABS, lda_absolute, 3, 4)                                               \
+  X(LDA_ABSX, lda_absolute_x, 3, 4)                                            \
+  X(LDA_ABSY, lda_absolute_y, 3, 4)                                            \
+  X(LDA_INDX, lda_indirect_x, 2, 6)                                            \
+  X(LDA_INDY, lda_indirect_y, 2, 5)                                            \
+  X(LDX_IMM, ldx_immediate, 2, 2)                                              \
+  X(LDX_ZP, ldx_zeropage, 2, 3)                                                \
+  X(LDX_ZPY, ldx_zeropage_y, 2, 4)                                             \
+  X(LDX_ABS, ldx_absolute, 3, 4)                                               \
+  X(LDX_ABSY, ldx_absolute_y, 3, 4)                                            \
+  X(LDY_IMM, ldy_immediate, 2, 2)                                              \
+  X(LDY_ZP, ldy_zeropage, 2, 3)                                                \
+  X(LDY_ZPX, ldy_zeropage_x, 2, 4)                                             \
+  X(LDY_ABS, ldy_absolute, 3, 4)                                               \
+  X(LDY_ABSX, ldy_absolute_x, 3, 4)                                            \
+  X(LSR_ACC, lsr_accumulator, 1, 2)                                            \
+  X(LSR_ZP, lsr_zeropage, 2, 5)                                                \
+  X(LSR_ZPX, lsr_zeropage_x, 2, 6)                                             \
+  X(LSR_ABS, lsr_absolute, 3, 6)                                               \
+  X(LSR_ABSX, lsr_absolute_x, 3, 7)                                            \
+  X(NOP_IMP, nop, 1, 2)                                                        \
+  X(ORA_IMM, ora_immediate, 2, 2)                                              \
+  X(ORA_ZP, ora_zeropage, 2, 3)                                                \
+  X(ORA_ZPX, ora_zeropage_x, 2, 4)                                             \
+  X(ORA_ABS, ora_absolute, 3, 4)                                               \
+  X(ORA_ABSX, ora_absolute_x, 3, 4)                                            \
+  X(ORA_ABSY, ora_absolute_y, 3, 4)                                            \
+  X(ORA_INDX, ora_indirect_x, 2, 6)                                            \
+  X(ORA_INDY, ora_indirect_y, 2, 5)                                            \
+  X(PHA_IMP, pha, 1, 3)                                                        \
+  X(PHP_IMP, php, 1, 3)                                                        \
+  X(PLA_IMP, pla, 1, 4)                                                        \
+  X(PLP_IMP, plp, 1, 4)                                                        \
+  X(ROL_ACC, rol_accumulator, 1, 2)                                            \
+  X(ROL_ZP, rol_zeropage, 2, 5)                                                \
+  X(ROL_ZPX, rol_zeropage_x, 2, 6)                                             \
+  X(ROL_ABS, rol_absolute, 3, 6)                                               \
+  X(ROL_ABSX, rol_absolute_x, 3, 7)                                            \
+  X(ROR_ACC, ror_accumulator, 1, 2)                                            \
+  X(ROR_ZP, ror_zeropage, 2, 5)                                                \
+  X(ROR_ZPX, ror_zeropage_x, 2, 6)                                             \
+  X(ROR_ABS, ror_absolute, 3, 6)                                               \
+  X(ROR_ABSX, ror_absolute_x, 3, 7)                                            \
+  X(RTI_IMP, rti, 0, 6)                                                        \
+  X(RTS_IMP, rts, 0, 6)                                                        \
+  X(SBC_IMM, sbc_immediate, 2, 2)                                              \
+  X(SBC_ZP, sbc_zeropage, 2, 3)                                                \
+  X(SBC_ZPX, sbc_zeropage_x, 2, 4)                                             \
+  X(SBC_ABS, sbc_absolute, 3, 4)                                               \
+  X(SBC_ABSX, sbc_absolute_x, 3, 4)                                            \
+  X(SBC_ABSY, sbc_absolute_y, 3, 4)                                            \
+  X(SBC_INDX, sbc_indirect_x, 2, 6)                                            \
+  X(SBC_INDY, sbc_indirect_y, 2, 5)                                            \
+  X(SEC_IMP, sec, 1, 2)                                                        \
+  X(SED_IMP, sed, 1, 2)                                                        \
+  X(SEI_IMP, sei, 1, 2)                                                        \
+  X(STA_ZP, sta_zeropage, 2, 3)                                                \
+  X(STA_ZPX, sta_zeropage_x, 2, 4)                                             \
+  X(STA_ABS, sta_absolute, 3, 4)                                               \
+  X(STA_ABSX, sta_absolute_x, 3, 5)                                            \
+  X(STA_ABSY, sta_absolute_y, 3, 5)                                            \
+  X(STA_INDX, sta_indirect_x, 2, 6)                                            \
+  X(STA_INDY, sta_indirect_y, 2, 6)                                            \
+  X(STX_ZP, stx_zeropage, 2, 3)                                                \
+  X(STX_ZPY, stx_zeropage_y, 2, 4)                                             \
+  X(STX_ABS, stx_absolute, 3, 4)                                               \
+  X(STY_ZP, sty_zeropage, 2, 3)                                                \
+  X(STY_ZPX, sty_zeropage_x, 2, 4)                                             \
+  X(STY_ABS, sty_absolute, 3, 4)                                               \
+  X(TAX_IMP, tax, 1, 2)                                                        \
+  X(TAY_IMP, tay, 1, 2)                                                        \
+  X(TSX_IMP, tsx, 1, 2)                                                        \
+  X(TXA_IMP, txa, 1, 2)                                                        \
+  X(TXS_IMP, txs, 1, 2)                                                        \
+  X(TYA_IMP, tya, 1, 2)
+
+#endif // INSTRUCTIONS_H
@@ -0,0 +1,28 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "block.h"
+
+#define JIT_THRESHOLD 64    // Runs before a block is translated
+#define JIT_SMC_LIMIT 64    // Rewrites before a page is left to the blocks
+#define JIT_ARENA_SIZE (1u << 20)
+
+// Translates blocks to x86-64. Simple register and flag instructions are
+// emitted inline, everything else becomes a direct call to its handler, so
+// cycle counting and memory access stay exactly those of the interpreter.
+// Pages still being rewritten after JIT_SMC_LIMIT invalidations and pages
+// without a direct memory mapping are never translated.
+struct Jit {
+  u8 *arena; // Filled front to back and flushed when full, never writable
+             // and executable at once
+  u32 used;
+};
+
+// NULL when the host can't run generated code.
+Jit *jit_create(void);
+void jit_destroy(Jit *jit);
+
+// Sets block->native, returning 0 if the block was left interpreted.
+int jit_compile(Jit *jit, BlockCache *cache, Block *block);
+
+#endif // JIT_H
@@ -0,0 +1,79 @@
+#ifndef MAPPER_H
+#define MAPPER_H
+
+#include "ppu.h"
+#include "rom.h"
+#include "types.h"
+
+typedef enum : u8 {
+  MAPPER_NROM = 0,
+  MAPPER_MMC1 = 1,
+  MAPPER_UXROM = 2,
+  MAPPER_CNROM = 3,
+  MAPPER_MMC3 = 4,
+} MapperNumber;
+
+// MMC1's registers are loaded a bit at a time through a serial port.
+typedef struct {
+  u8 shift;   // Bits written so far under a marker bit, which reaches bit 0
+              // when the fifth write is due
+  u8 control; // $8000: mirroring, PRG mode and CHR mode
+  u8 chr[2];  // $A000 and $C000
+  u8 prg;     // $E000
+} Mmc1;
+
+// MMC3 counts scanlines by the rises of A12 the PPU makes, see a12_rises in
+// ppu.h, and is only brought up to date with them by mapper_sync.
+typedef struct {
+  u8 select;      // $8000: the register $8001 writes, the PRG and CHR modes
+  u8 bank[8];     // R0-R7
+  u8 mirroring;   // $A000
+  u8 irq_latch;   // $C000: what the counter reloads with
+  u8 irq_counter;
+  u8 irq_reload;  // Set by $C001: reload on the next clock
+  u8 irq_enabled; // Set by $E001, cleared by $E000
+  u32 a12_seen;   // The PPU's a12_rises the counter has been clocked up to
+} Mmc3;
+
+typedef struct Mapper Mapper;
+typedef void (*MapperWriteFunc)(Mapper *mapper, u16 addr, u8 val);
+typedef void (*MapperMapFunc)(Mapper *mapper);
+
+// The cartridge's bank switching. Banks are installed straight into the
+// CPU's page table and the PPU's pattern table windows whenever a register
+// changes, so reading ROM never calls into the mapper: only writes to
+// $8000-$FFFF do, and each of those remaps at most 128 pages.
+struct Mapper {
+  // Everything up to write is plain data, which save states copy as it is.
+  u8 bank; // UxROM's PRG bank, CNROM's CHR bank
+  u8 irq;  // Holding the CPU's IRQ line
+  Mmc1 mmc1;
+  Mmc3 mmc3;
+
+  MapperWriteFunc write; // The board's register writes
+  MapperMapFunc map;     // Maps the banks the registers select
+  Bus *bus;
+  PPU *ppu;
+  Rom *rom;
+};
+
+// Picks the mapper for rom's board and maps its power-on banks onto
+// $8000-$FFFF and the pattern tables. Write handlers are left to the caller.
+// Returns -1 if the board isn't emulated.
+int mapper_init(Mapper *mapper, Rom *rom, Bus *bus, PPU *ppu);
+
+// A write to $8000-$FFFF. The PPU has to be caught up first, since bank
+// switches and mirroring change what it draws from then on.
+void mapper_write(Mapper *mapper, u16 addr, u8 val);
+// Maps the banks the registers select again, after they were restored.
+void mapper_map(Mapper *mapper);
+
+// Brings the IRQ counter up to the PPU, which has to be caught up first.
+// mapper_write does this itself.
+void mapper_sync(Mapper *mapper);
+// How many dots from the PPU's position on the IRQ fires at the earliest if
+// the PPU's configuration stays as it is, or UINT64_MAX if it won't. Call it
+// again after a sync then: the IRQ may be further off, never closer.
+u64 mapper_dots_to_irq(const Mapper *mapper);
+
+#endif // MAPPER_H
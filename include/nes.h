@@ -0,0 +1,54 @@
+#ifndef NES_H
+#define NES_H
+
+#include "apu.h"
+#include "mapper.h"
+#include "ppu.h"
+#include "rom.h"
+#include "sched.h"
+#include "types.h"
+
+// NTSC timing: the PPU runs 3 dots per CPU cycle and a frame is 262 scanlines
+// of 341 dots.
+#define PPU_DOTS_PER_FRAME (341 * 262)
+#define CPU_CYCLES_TO_FRAMES(cycles) ((cycles) * 3 / PPU_DOTS_PER_FRAME)
+#define FRAMES_TO_CPU_CYCLES(frames) ((frames) * PPU_DOTS_PER_FRAME / 3)
+
+// What the console schedules on its Scheduler: everything that has to stop
+// the CPU at a known cycle rather than when the CPU next looks.
+typedef enum : u8 {
+  EVENT_VBLANK,     // Pending only while NMIs are enabled
+  EVENT_MAPPER_IRQ, // The earliest the mapper's IRQ can fire
+  EVENT_FRAME_IRQ,  // The APU's frame interrupt, while it's enabled
+  EVENT_DMC_FETCH,  // The DMC's next fetch, which stalls the CPU
+} NesEvent;
+
+// One console with a cartridge inserted. Everything an emulated machine needs
+// lives in here, so any number of them can run side by side.
+typedef struct {
+  CPU cpu;
+  PPU ppu;
+  Apu apu;
+  Rom rom;
+  Mapper mapper;
+  Scheduler sched;
+  u8 prg_ram[0x2000]; // Cartridge RAM at $6000-$7FFF
+} NES;
+
+// Loads the ROM at path, maps it and resets the CPU.
+RomError nes_load(NES *nes, const char *path);
+void nes_unload(NES *nes);
+// Presses the reset button: the CPU jumps through its reset vector, the PPU's
+// and APU's registers are cleared and the mapper is back at its power-on
+// banks. RAM and the cycle count carry on.
+void nes_reset(NES *nes);
+
+// Runs the CPU until the cycle count reaches cycles or it halts, delivering
+// NMIs and IRQs. The PPU and APU are only caught up when the CPU accesses
+// them, stops for an interrupt or returns.
+void nes_run_until(NES *nes, u64 cycles);
+// Brings the PPU and APU up to the CPU's current cycle. DMC fetches on the
+// way stall the CPU, so it may end up a few cycles further on.
+void nes_sync(NES *nes);
+
+#endif // NES_H
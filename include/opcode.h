@@ -7,14 +7,22 @@
 u8 read_byte(CPU *cpu, u16 addr);
 void write_byte(CPU *cpu, u16 addr, u8 val);
 u16 absolute_addr(CPU *cpu);
+u16 absolute_addr_at(CPU *cpu, u16 at);
 
 // Flag operations
 void set_flag(CPU *cpu, Flag flag, u8 val);
 u8 get_flag(CPU *cpu, Flag flag);
+void set_nz(CPU *cpu, u8 value);
+// P with any lazily tracked flags folded in, for pushes and debuggers
+u8 get_status(CPU *cpu);
+void set_status(CPU *cpu, u8 val);
 
 // No operation
 void nop(CPU *cpu);
 
+// Unofficial opcodes are not emulated yet and halt the CPU like KIL/JAM
+void jam(CPU *cpu);
+
 // LDA instructions
 void lda_immediate(CPU *cpu);
 void lda_zeropage(CPU *cpu);
@@ -63,6 +71,8 @@ void tax(CPU *cpu);
 void tay(CPU *cpu);
 void txa(CPU *cpu);
 void tya(CPU *cpu);
+void tsx(CPU *cpu);
+void txs(CPU *cpu);
 
 // Branch instructions
 void bcc(CPU *cpu);
@@ -138,9 +148,79 @@ void sbc_absolute_y(CPU *cpu);
 void sbc_indirect_x(CPU *cpu);
 void sbc_indirect_y(CPU *cpu);
 
+void cpx_immediate(CPU *cpu);
+void cpx_zeropage(CPU *cpu);
+void cpx_absolute(CPU *cpu);
+
+void cpy_immediate(CPU *cpu);
+void cpy_zeropage(CPU *cpu);
+void cpy_absolute(CPU *cpu);
+
 void bit_zeropage(CPU *cpu);
 void bit_absolute(CPU *cpu);
+
+// Increments and decrements
+void inc_zeropage(CPU *cpu);
+void inc_zeropage_x(CPU *cpu);
+void inc_absolute(CPU *cpu);
+void inc_absolute_x(CPU *cpu);
+void inx(CPU *cpu);
+void iny(CPU *cpu);
+
+void dec_zeropage(CPU *cpu);
+void dec_zeropage_x(CPU *cpu);
+void dec_absolute(CPU *cpu);
+void dec_absolute_x(CPU *cpu);
+void dex(CPU *cpu);
+void dey(CPU *cpu);
+
+// Shifts and rotates
+void asl_accumulator(CPU *cpu);
+void asl_zeropage(CPU *cpu);
+void asl_zeropage_x(CPU *cpu);
+void asl_absolute(CPU *cpu);
+void asl_absolute_x(CPU *cpu);
+
+void lsr_accumulator(CPU *cpu);
+void lsr_zeropage(CPU *cpu);
+void lsr_zeropage_x(CPU *cpu);
+void lsr_absolute(CPU *cpu);
+void lsr_absolute_x(CPU *cpu);
+
+void rol_accumulator(CPU *cpu);
+void rol_zeropage(CPU *cpu);
+void rol_zeropage_x(CPU *cpu);
+void rol_absolute(CPU *cpu);
+void rol_absolute_x(CPU *cpu);
+
+void ror_accumulator(CPU *cpu);
+void ror_zeropage(CPU *cpu);
+void ror_zeropage_x(CPU *cpu);
+void ror_absolute(CPU *cpu);
+void ror_absolute_x(CPU *cpu);
+
+// Flag instructions
+void clc(CPU *cpu);
+void cld(CPU *cpu);
+void cli(CPU *cpu);
+void clv(CPU *cpu);
+void sec(CPU *cpu);
+void sed(CPU *cpu);
+void sei(CPU *cpu);
+
+// Jumps and subroutines
+void jmp_absolute(CPU *cpu);
+void jmp_indirect(CPU *cpu);
+void jsr(CPU *cpu);
+void rts(CPU *cpu);
+void rti(CPU *cpu);
+
 // System instructions
 void brk(CPU *cpu);
 
+// Interrupts
+void nmi(CPU *cpu);
+// The caller checks that I is clear.
+void irq(CPU *cpu);
+
 #endif // OPCODE_H
@@ -0,0 +1,127 @@
+#ifndef PPU_H
+#define PPU_H
+
+#include "rom.h"
+#include "types.h"
+
+#define PPU_WIDTH 256
+#define PPU_HEIGHT 240
+#define PPU_DOTS_PER_LINE 341
+#define PPU_LINES_PER_FRAME 262
+#define PPU_VBLANK_LINE 241
+#define PPU_PRERENDER_LINE 261
+
+typedef enum : u8 {
+  PPU_CTRL_INCREMENT = 0x04,        // $2007 steps by 32 instead of 1
+  PPU_CTRL_SPRITE_TABLE = 0x08,     // 8x8 sprites use the table at $1000
+  PPU_CTRL_BACKGROUND_TABLE = 0x10, // Background uses the table at $1000
+  PPU_CTRL_SPRITE_SIZE = 0x20,      // 8x16 sprites
+  PPU_CTRL_NMI = 0x80,              // NMI at the start of vblank
+} PpuCtrl;
+
+typedef enum : u8 {
+  PPU_MASK_GRAYSCALE = 0x01,
+  PPU_MASK_BACKGROUND_LEFT = 0x02, // Background in the leftmost 8 pixels
+  PPU_MASK_SPRITES_LEFT = 0x04,    // Sprites in the leftmost 8 pixels
+  PPU_MASK_BACKGROUND = 0x08,
+  PPU_MASK_SPRITES = 0x10,
+} PpuMask;
+
+typedef enum : u8 {
+  PPU_STATUS_OVERFLOW = 0x20,
+  PPU_STATUS_SPRITE0 = 0x40,
+  PPU_STATUS_VBLANK = 0x80,
+} PpuStatus;
+
+// The 2C02. It only ever runs when someone catches it up with ppu_run_to,
+// which draws the lines in between in one go with the scanline renderer and
+// steps dot by dot only through the partial lines at either end. Since the
+// CPU catches it up on every register access, a line takes the slow path
+// exactly when the CPU touched the PPU while it was being drawn.
+typedef struct {
+  // Where the windows of the PPU's address space point. Everything from ctrl
+  // up to chr_ram_tiles is plain data, which save states copy as it is.
+  u8 *chr[8];       // Pattern tables in 1 KiB windows
+  u8 *chr_tiles[8]; // The same windows pre-decoded, see chr_decode
+  u8 *nametable[4];
+
+  u8 ctrl;
+  u8 mask;
+  u8 status;
+  u8 oam_addr;
+  u16 v;          // Current VRAM address
+  u16 t;          // Temporary VRAM address, the top left of the next frame
+  u8 x;           // Fine X scroll
+  u8 w;           // $2005/$2006 write toggle
+  u8 read_buffer; // Delayed $2007 reads
+  u8 latch;       // Last value written, what write-only registers read as
+  u8 nmi;         // NMI requested, cleared by whoever delivers it
+
+  u16 scanline;
+  u16 dot;
+  u8 odd_frame;
+  u64 frame;
+  u64 dots; // Dots elapsed since power on
+
+  // Background pipeline: two tiles in flight plus the next one fetched.
+  u16 pattern_lo;
+  u16 pattern_hi;
+  u16 attribute_lo;
+  u16 attribute_hi;
+  u8 next_pattern_lo;
+  u8 next_pattern_hi;
+  u8 next_attribute;
+
+  // Sprites drawn ahead into one byte per pixel, see SpritePixel in ppu.c:
+  // the current line's and the one being evaluated for the next line.
+  u8 sprite_line[PPU_WIDTH];
+  u8 sprite_next[PPU_WIDTH];
+  u8 sprite_line_count;
+  u8 sprite_next_count;
+  u8 sprite_next_high; // 8x16 sprites for the next line fetch from $1000
+
+  // Rises of address line A12 so far, as MMC3 sees them through its filter:
+  // at most one per rendered line, which is how it counts scanlines.
+  u32 a12_rises;
+
+  u8 chr_writable;
+  u8 palette[32];
+  u8 oam[256];
+  u8 ciram[0x1000]; // 2 KiB on the console, 4 KiB with four-screen boards
+  u8 chr_ram[0x2000];
+  u8 chr_ram_tiles[0x2000 * 4];
+
+  u32 fast_lines; // Lines drawn by the scanline renderer, for benchmarks
+  u8 framebuffer[PPU_HEIGHT * PPU_WIDTH]; // Palette entries, $00-$3F
+} PPU;
+
+// Resets the PPU and points it at the cartridge's CHR ROM, or at its own CHR
+// RAM when the board has none.
+void ppu_power_on(PPU *ppu, Rom *rom);
+// The reset button: clears the registers the CPU writes, but the PPU keeps
+// its place in the frame and what is in its memory.
+void ppu_reset(PPU *ppu);
+void ppu_set_mirroring(PPU *ppu, Mirroring mirroring);
+// Switches a 1 KiB pattern table window to other CHR, given with its decoded
+// tiles.
+void ppu_map_chr(PPU *ppu, u8 window, u8 *chr, u8 *tiles);
+
+// Runs until dots have elapsed since power on.
+void ppu_run_to(PPU *ppu, u64 dots);
+// How far away the dot that raises vblank is.
+u32 ppu_dots_to_vblank(const PPU *ppu);
+// How far away the count-th rise of A12 from now is, if ctrl and mask stay as
+// they are, or UINT64_MAX if there won't be one. With 8x16 sprites whether a
+// line has one depends on its sprites, so every line that might is counted
+// and the answer is only the earliest it can be.
+u64 ppu_dots_to_a12_rises(const PPU *ppu, u32 count);
+
+// $2000-$2007, mirrored every 8 bytes up to $3FFF.
+u8 ppu_read_register(PPU *ppu, u16 addr);
+void ppu_write_register(PPU *ppu, u16 addr, u8 val);
+
+// The PPU's own address space: pattern tables, nametables and palette.
+u8 ppu_read(PPU *ppu, u16 addr);
+void ppu_write(PPU *ppu, u16 addr, u8 val);
+
+#endif // PPU_H
@@ -0,0 +1,43 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "nes.h"
+#include "types.h"
+
+#define REWIND_MAX_KEYFRAME_INTERVAL 256
+
+// Recent history as save states in a fixed-size ring. Every keyframe_interval
+// frames a whole state is kept; the frames in between only keep what changed
+// since the frame before, as the XOR of the two states. Both are run-length
+// encoded, and since a frame leaves almost all of a state alone, a delta is
+// mostly one long run of zeros. Reaching any frame decodes its keyframe plus
+// at most keyframe_interval - 1 deltas. When the ring fills up the oldest
+// keyframe and its deltas go first.
+typedef struct {
+  u8 *arena;
+  u32 size;
+  u32 head;   // Where the next entry goes
+  u32 tail;   // The oldest entry, always a keyframe
+  u32 newest; // The newest entry
+  u32 frames; // Entries held
+  u32 keyframe_interval;
+  u32 since_keyframe; // Deltas after the newest keyframe
+  u8 *last;           // The newest frame's state, decoded
+  u8 *next;           // The machine's state as of the last push, brought up
+                      // to date with state_update for the next one
+  u8 *encoded;        // The entry being pushed, encoded
+} Rewind;
+
+// Allocates a ring of arena_size bytes, which must hold at least two whole
+// states. Returns -1 if it can't.
+int rewind_init(Rewind *rw, u32 arena_size, u32 keyframe_interval);
+void rewind_free(Rewind *rw);
+
+// Records the machine's current state as the newest frame. Pushes take the
+// machine's dirty pages, so nothing else may state_update it meanwhile.
+void rewind_push(Rewind *rw, NES *nes);
+// Restores the frame back frames before the newest one (0 is the newest) and
+// forgets everything after it. Returns -1 if it's no longer held.
+int rewind_seek(Rewind *rw, NES *nes, u32 back);
+
+#endif // REWIND_H
@@ -0,0 +1,68 @@
+#ifndef ROM_H
+#define ROM_H
+
+#include "types.h"
+#include <stddef.h>
+
+typedef enum : u8 {
+  MIRROR_HORIZONTAL,
+  MIRROR_VERTICAL,
+  MIRROR_FOUR_SCREEN,
+  MIRROR_SINGLE_LOWER, // One-screen, set by the mapper
+  MIRROR_SINGLE_UPPER,
+} Mirroring;
+
+typedef enum : u8 {
+  ROM_OK,
+  ROM_ERR_OPEN,   // The file could not be opened or mapped
+  ROM_ERR_FORMAT, // Not an iNES/NES 2.0 file
+  ROM_ERR_SIZE,   // The file is shorter than the header says
+  ROM_ERR_MAPPER, // The board's mapper isn't emulated
+  ROM_ERR_MEMORY, // Out of memory setting up the console for it
+} RomError;
+
+// A cartridge image mapped straight from disk. prg and chr point into the
+// mapping, so banks can be handed to the bus without copying anything.
+typedef struct {
+  u8 *data; // Whole file, mmap'd read-only
+  size_t size;
+  u8 *prg;
+  u32 prg_size;
+  u8 *chr; // NULL when the board uses CHR RAM
+  u32 chr_size;
+  u8 *chr_tiles;   // chr decoded a 1 KiB bank at a time by rom_chr_tiles
+  u8 *chr_decoded; // Bitmap of the 1 KiB banks in chr_tiles decoded so far
+  u32 prg_ram_size; // Battery-backed or not, 0 if none
+  u32 chr_ram_size;
+  u16 mapper;
+  u8 submapper;
+  Mirroring mirroring;
+  u8 battery;
+  u8 nes2; // Header is in NES 2.0 format
+} Rom;
+
+// Parses an iNES or NES 2.0 image already in memory. rom keeps pointers into
+// data, which must outlive it.
+RomError rom_parse(Rom *rom, u8 *data, size_t size);
+
+// Maps the file at path and parses it. Release with rom_unload.
+RomError rom_load(Rom *rom, const char *path);
+void rom_unload(Rom *rom);
+
+const char *rom_error_str(RomError err);
+
+// Zero-copy views of a bank_size sized bank. Bank numbers wrap around the
+// available data like the address lines on a real board do.
+u8 *rom_prg_bank(const Rom *rom, u32 bank, u32 bank_size);
+u8 *rom_chr_bank(const Rom *rom, u32 bank, u32 bank_size);
+// The same bank in chr_tiles, decoded the first time it's asked for. NULL
+// unless the ROM came from rom_load.
+u8 *rom_chr_tiles(Rom *rom, u32 bank, u32 bank_size);
+
+// Pattern tables decoded ahead of time: each 16-byte tile becomes 64 bytes,
+// one colour index (0-3) per pixel in rows of 8, so drawing a tile row is a
+// copy plus the palette. Tiles keep their offset (times 4), so bank switches
+// only move pointers; only CHR RAM writes need chr_decode again.
+void chr_decode(const u8 *chr, u32 size, u8 *tiles);
+
+#endif // ROM_H
@@ -0,0 +1,56 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include "emu.h"
+#include "nes.h"
+#include <stdio.h>
+
+#define RUNNER_MESSAGE_SIZE 256
+
+typedef enum : u8 {
+  RUN_PASS,    // The exit condition was met
+  RUN_TIMEOUT, // The cycle budget ran out first
+  RUN_JAM,     // The CPU halted on an unsupported opcode
+  RUN_FAIL,    // The ROM reported a failure through the $6000 protocol
+  RUN_ERROR,   // The ROM could not be loaded
+} RunStatus;
+
+typedef struct {
+  u64 max_cycles; // 0 runs without a budget
+  u64 check_interval; // Cycles between exit condition checks, 0 for a frame
+  u8 has_until;
+  u8 until_not_equal; // Stop when the address differs from until_value
+  u16 until_addr;
+  u8 until_value;
+  u8 blargg; // Stop once the ROM reports a result at $6000, see runner.c
+  Engine engine; // How the CPU executes, ENGINE_INTERPRETER by default
+  FILE *audio;   // Receives the sound as raw 16-bit mono PCM when set
+  ApuAudio audio_mode; // How audio is made; without audio there's none
+} RunConfig;
+
+typedef struct {
+  RunStatus status;
+  RomError error; // Set when status is RUN_ERROR
+  u64 cycles;
+  u16 pc;
+  u8 value; // Byte at until_addr, or the result code, when the run ended
+  char message[RUNNER_MESSAGE_SIZE]; // Text the ROM left at $6004
+} RunResult;
+
+// Parses "ADDR=VAL" or "ADDR!=VAL" (both hex) into the exit condition, or
+// "blargg" for the status protocol of blargg's test ROMs.
+int runner_parse_until(RunConfig *config, const char *arg);
+
+// Runs a loaded machine with no video or frame pacing until the exit
+// condition holds, the budget runs out or the CPU halts.
+RunResult runner_run(NES *nes, const RunConfig *config);
+
+// Prints one machine-readable line describing the result.
+void runner_print(FILE *out, const char *rom, const RunResult *result);
+// Prints the result as a Unity test line, passing when the status is the
+// expected one, so make test can count it with the unit tests.
+void runner_print_unity(FILE *out, const char *rom, const RunResult *result,
+                        RunStatus expect);
+const char *run_status_str(RunStatus status);
+
+#endif // RUNNER_H
@@ -0,0 +1,30 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "types.h"
+
+#define SCHED_MAX_EVENTS 16
+#define SCHED_IDLE 0xFF // Slot of an event that isn't scheduled
+
+// When each of a fixed set of events is next due, in CPU cycles, kept in a
+// binary min-heap so the earliest is always at the front. Every event has an
+// id below SCHED_MAX_EVENTS and is scheduled at most once: scheduling it again
+// moves it. Nothing is allocated, so it can live inside the machine it times.
+typedef struct {
+  u64 time[SCHED_MAX_EVENTS];
+  u8 heap[SCHED_MAX_EVENTS]; // Ids of the pending events
+  u8 slot[SCHED_MAX_EVENTS]; // Each id's index in heap, or SCHED_IDLE
+  u8 count;
+} Scheduler;
+
+void sched_init(Scheduler *sched);
+// Schedules the event for time, or moves it there if it's already pending.
+void sched_set(Scheduler *sched, u8 id, u64 time);
+void sched_cancel(Scheduler *sched, u8 id);
+// When the earliest pending event is due, UINT64_MAX if none is.
+u64 sched_next(const Scheduler *sched);
+// Removes and returns the earliest event due at or before now, or SCHED_IDLE
+// if there isn't one.
+u8 sched_pop(Scheduler *sched, u64 now);
+
+#endif // SCHED_H
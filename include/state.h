@@ -0,0 +1,45 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include "nes.h"
+#include "types.h"
+
+#define STATE_VERSION 4
+
+typedef enum : u8 {
+  STATE_OK,
+  STATE_ERR_OPEN,    // The file could not be created, opened or mapped
+  STATE_ERR_FORMAT,  // Not a save state, or a truncated one
+  STATE_ERR_VERSION, // Saved by an incompatible version
+  STATE_ERR_ROM,     // Saved with a differently sized cartridge or mapper
+} StateError;
+
+// A save state is a header followed by chunks, each a four character tag, a
+// size and that many bytes, padded to 8 so every chunk stays aligned in a
+// mapped file. Most chunks are straight copies of a part of NES, so saving
+// and restoring are a handful of memcpy calls; loaders skip tags they don't
+// know. The layout is the host's, so states only move between builds for
+// the same platform. Only what the machine needs to carry on is saved: the
+// framebuffer and anything decoded from CHR are rebuilt on restore.
+
+// The size of every state, whatever the machine's state.
+u32 state_size(void);
+// Writes a state of nes into buf, which must hold state_size() bytes.
+void state_save(const NES *nes, u8 *buf);
+// Brings buf, a state of nes saved earlier, up to date. Of the memory the CPU
+// writes, only pages marked dirty on the bus since the last update are
+// copied; everything else is copied whole. Clears the dirty pages, so each
+// machine should have only one buffer kept up to date like this.
+void state_update(NES *nes, u8 *buf);
+// Restores nes, which must have the same cartridge loaded, from a state of
+// size bytes. nes is left untouched unless the state is valid.
+StateError state_load(NES *nes, const u8 *buf, u32 size);
+
+// The same through a shared mapping of the file at path, so nothing is copied
+// through an intermediate buffer.
+StateError state_save_file(const NES *nes, const char *path);
+StateError state_load_file(NES *nes, const char *path);
+
+const char *state_error_str(StateError err);
+
+#endif // STATE_H
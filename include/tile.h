@@ -0,0 +1,23 @@
+#ifndef TILE_H
+#define TILE_H
+
+#include "types.h"
+
+// Merges count tile rows, given as their two bitplane bytes and a 2-bit
+// palette each, into 8 pixels per row: palette << 2 | colour, leftmost first.
+typedef void (*TileDecodeFunc)(const u8 *lo, const u8 *hi, const u8 *palette,
+                               u32 count, u8 *out);
+
+typedef struct {
+  const char *name;
+  TileDecodeFunc decode;
+} TileDecoder;
+
+// The implementations this host can run, fastest last. SSE2 is built in on
+// x86-64 and AVX2 is picked up at runtime when the CPU has it.
+u32 tile_decoders(const TileDecoder **list);
+
+// The fastest of them.
+TileDecodeFunc tile_decoder(void);
+
+#endif // TILE_H
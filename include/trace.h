@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+#include <stdio.h>
+
+#define TRACE_DEFAULT_ENTRIES (1u << 20)
+#define TRACE_MAX_CAPACITY (1u << 31) // The largest power of two in a u32
+#define TRACE_LINE_SIZE 128
+
+// The machine as an instruction was about to execute, packed into 16 bytes.
+typedef struct {
+  u32 cycles;    // Low 32 bits of the cycle count
+  u8 cycles_hi;  // And the next 8
+  u8 bytes[3];   // The opcode and whatever operands follow it
+  u16 pc;
+  u8 a, x, y, p, s;
+} TraceEntry;
+
+// The last entries recorded, oldest overwritten first. While a trace is
+// attached run_until interprets one instruction at a time (blocks and the JIT
+// are bypassed) and stores one entry before each; formatting them as text is
+// left until somebody reads them.
+struct Trace {
+  TraceEntry *entries;
+  u32 mask; // Capacity - 1, a power of two
+  u64 count; // Entries ever recorded
+};
+
+// Allocates room for capacity entries, rounded up to a power of two. Returns
+// -1 if it can't, or if capacity is over TRACE_MAX_CAPACITY.
+int trace_init(Trace *trace, u32 capacity);
+void trace_free(Trace *trace);
+
+// Writes the entries held, oldest first, to a binary file. Returns -1 on
+// error.
+int trace_save(const Trace *trace, const char *path);
+// Prints a file written by trace_save as text; see trace_format. Returns -1
+// if it can't be read.
+int trace_print(FILE *out, const char *path);
+
+// One line in the format of nestest.log, without the memory values it shows
+// after some operands (those aren't recorded), e.g.
+//   C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 ...
+// The PPU position is worked out from the cycle count.
+void trace_format(char *line, const TraceEntry *entry);
+
+#endif // TRACE_H
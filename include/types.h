@@ -5,8 +5,11 @@
 
 typedef uint8_t u8;
 typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
 typedef int8_t s8;
 typedef int16_t s16;
+typedef int32_t s32;
 
 typedef enum : u8 {
   // ADC - Add with Carry
@@ -284,8 +287,33 @@ typedef enum : u8 {
   FLAG_CARRY = 0x01
 } Flag;
 
-// The memory handling is temporary until I get the CPU opcodes to a functional
-// state.
+// What can hold the CPU's IRQ line, a bit each since it stays asserted until
+// every source lets go.
+typedef enum : u8 {
+  IRQ_MAPPER = 0x01,
+  IRQ_APU = 0x02, // The frame counter's or the DMC's
+} IrqSource;
+
+typedef u8 (*BusReadFunc)(void *ctx, u16 addr);
+typedef void (*BusWriteFunc)(void *ctx, u16 addr, u8 val);
+
+// The CPU address space split into 256-byte pages. Pages backed by plain
+// memory (RAM, PRG ROM) are accessed through a direct pointer; a NULL pointer
+// traps the access to the page's handler instead (PPU/APU registers, mapper
+// registers, open bus).
+typedef struct {
+  u8 *read[256];
+  u8 *write[256];
+  BusReadFunc read_handler[256];
+  BusWriteFunc write_handler[256];
+  void *ctx[256];
+  u8 code[256]; // Pages holding decoded blocks, see block.h
+  u64 dirty[4]; // One bit per page written since bus_clear_dirty
+} Bus;
+
+typedef struct BlockCache BlockCache;
+typedef struct Trace Trace;
+
 typedef struct {
   u8 A;   // Accumulator
   u8 X;   // Index register X
@@ -293,7 +321,18 @@ typedef struct {
   u8 S;   // Stack pointer
   u16 PC; // Program counter
   u8 P;   // Status registers
-  u8 mem[0x10000];
+  u8 n_result; // With LAZY_FLAGS, N is bit 7 of this rather than of P
+  u8 z_result; // With LAZY_FLAGS, Z is set when this is 0 rather than in P
+  u8 halted; // Set when a JAM/unimplemented opcode stops the CPU
+  u8 irq;    // IrqSource bits holding the IRQ line, taken while I is clear
+  u64 cycles; // CPU cycles elapsed since power on
+  u64 deadline; // Cycle count the current run_until stops at
+  u32 operand;  // The running instruction's operand if its block decoded it,
+                // see block.h, 0 if it has to be fetched
+  Bus bus;
+  u8 ram[0x800]; // Internal work RAM, mirrored up to $1FFF
+  BlockCache *blocks; // Decoded block cache, NULL to interpret directly
+  Trace *trace; // Records every instruction when set, see trace.h
 } CPU;
 
 #endif // TYPES_H
@@ -0,0 +1,582 @@
+#include "apu.h"
+#include <stddef.h>
+#include <string.h>
+
+// Each channel's share of the output per step of its level, the linear
+// approximation of the console's mixer scaled to 16 bits.
+#define PULSE_WEIGHT 247
+#define TRIANGLE_WEIGHT 279
+#define NOISE_WEIGHT 162
+#define DMC_WEIGHT 110
+
+static const u8 LENGTHS[32] = {10, 254, 20,  2,  40, 4,  80, 6,  160, 8,  60,
+                               10, 14,  12,  26, 14, 12, 16, 24, 18, 48,  20,
+                               96, 22,  192, 24, 72, 26, 16, 28, 32, 30};
+
+// Which of the 8 steps are high, bit n for step n.
+static const u8 DUTIES[4] = {0x02, 0x06, 0x1E, 0xF9};
+
+static const u8 TRIANGLE_STEPS[32] = {15, 14, 13, 12, 11, 10, 9,  8,  7,  6, 5,
+                                      4,  3,  2,  1,  0,  0,  1,  2,  3,  4, 5,
+                                      6,  7,  8,  9,  10, 11, 12, 13, 14, 15};
+
+static const u16 NOISE_PERIODS[16] = {4,   8,   16,  32,  64,  96,
+                                      128, 160, 202, 254, 380, 508,
+                                      762, 1016, 2034, 4068};
+
+static const u16 DMC_PERIODS[16] = {428, 380, 340, 320, 286, 254, 226, 214,
+                                    190, 160, 142, 128, 106, 84,  72,  54};
+
+// Frame counter steps in CPU cycles from the start of the sequence, which
+// starts over one cycle after the last step.
+static const u16 FRAME_STEPS[2][5] = {
+    {7457, 14913, 22371, 29829},
+    {7457, 14913, 22371, 29829, 37281},
+};
+static const u8 FRAME_STEP_COUNT[2] = {4, 5};
+
+static void set_output(Apu *apu, u8 *output, u8 level, s32 weight,
+                       u64 cycle) {
+  if (level != *output && apu->audio != APU_AUDIO_OFF) {
+    blip_add_delta(&apu->blip, cycle - apu->block_start,
+                   (level - *output) * weight);
+    *output = level;
+  }
+}
+
+static u8 envelope_volume(const Envelope *envelope) {
+  return envelope->constant ? envelope->period : envelope->decay;
+}
+
+static void clock_envelope(Envelope *envelope) {
+  if (envelope->start) {
+    envelope->start = 0;
+    envelope->decay = 15;
+    envelope->divider = envelope->period;
+  } else if (envelope->divider) {
+    envelope->divider--;
+  } else {
+    envelope->divider = envelope->period;
+    if (envelope->decay) {
+      envelope->decay--;
+    } else if (envelope->loop) {
+      envelope->decay = 15;
+    }
+  }
+}
+
+static u16 sweep_target(const Pulse *pulse, u8 ones_complement) {
+  u16 change = pulse->period >> pulse->sweep_shift;
+  if (pulse->sweep_negate) {
+    return pulse->period - change - ones_complement;
+  }
+  return pulse->period + change;
+}
+
+// The sweep unit silences the channel whether it's enabled or not.
+static int pulse_muted(const Pulse *pulse) {
+  return pulse->period < 8 ||
+         (!pulse->sweep_negate && sweep_target(pulse, 0) > 0x7FF);
+}
+
+static int pulse_silent(const Pulse *pulse) {
+  return !pulse->length || pulse_muted(pulse) ||
+         !envelope_volume(&pulse->envelope);
+}
+
+static u8 pulse_level(const Pulse *pulse) {
+  if (pulse_silent(pulse) || !(DUTIES[pulse->duty] >> pulse->step & 1)) {
+    return 0;
+  }
+  return envelope_volume(&pulse->envelope);
+}
+
+static u8 noise_level(const Noise *noise) {
+  if (!noise->length || (noise->shift & 1)) {
+    return 0;
+  }
+  return envelope_volume(&noise->envelope);
+}
+
+// How many clocks of period fall before end, counting from next.
+static u64 clocks_before(u64 next, u64 period, u64 end) {
+  return next < end ? (end - next + period - 1) / period : 0;
+}
+
+static void run_pulse(Apu *apu, Pulse *pulse, u64 end) {
+  u64 period = (pulse->period + 1) * 2;
+  if (pulse_silent(pulse) || apu->audio == APU_AUDIO_OFF) {
+    u64 clocks = clocks_before(pulse->next, period, end);
+    pulse->step = (pulse->step + clocks) & 7;
+    pulse->next += clocks * period;
+    return;
+  }
+  while (pulse->next < end) {
+    pulse->step = (pulse->step + 1) & 7;
+    set_output(apu, &pulse->output, pulse_level(pulse), PULSE_WEIGHT,
+               pulse->next);
+    pulse->next += period;
+  }
+}
+
+static void run_triangle(Apu *apu, u64 end) {
+  Triangle *triangle = &apu->triangle;
+  u64 period = triangle->period + 1;
+  // The sequence holds its place while either counter is out. Ultrasonic
+  // periods are held too rather than played as a pop.
+  if (!triangle->length || !triangle->linear || triangle->period < 2) {
+    triangle->next += clocks_before(triangle->next, period, end) * period;
+    return;
+  }
+  if (apu->audio == APU_AUDIO_OFF) {
+    u64 clocks = clocks_before(triangle->next, period, end);
+    triangle->step = (triangle->step + clocks) & 31;
+    triangle->next += clocks * period;
+    return;
+  }
+  while (triangle->next < end) {
+    triangle->step = (triangle->step + 1) & 31;
+    set_output(apu, &triangle->output, TRIANGLE_STEPS[triangle->step],
+               TRIANGLE_WEIGHT, triangle->next);
+    triangle->next += period;
+  }
+}
+
+static void run_noise(Apu *apu, u64 end) {
+  Noise *noise = &apu->noise;
+  u64 period = NOISE_PERIODS[noise->rate];
+  // Nothing but the sound depends on the LFSR, so while it can't be heard it
+  // doesn't have to shift either.
+  if (!noise->length || !envelope_volume(&noise->envelope) ||
+      apu->audio == APU_AUDIO_OFF) {
+    noise->next += clocks_before(noise->next, period, end) * period;
+    return;
+  }
+  u8 tap = noise->short_mode ? 6 : 1;
+  while (noise->next < end) {
+    u16 feedback = (noise->shift ^ noise->shift >> tap) & 1;
+    noise->shift = noise->shift >> 1 | feedback << 14;
+    set_output(apu, &noise->output, noise_level(noise), NOISE_WEIGHT,
+               noise->next);
+    noise->next += period;
+  }
+}
+
+// Fills the sample buffer from memory when it's empty. The CPU is halted for
+// the fetch, which the console takes from dmc_stall.
+static void dmc_fetch(Apu *apu) {
+  Dmc *dmc = &apu->dmc;
+  if (dmc->buffer_full || !dmc->bytes_left) {
+    return;
+  }
+  apu->dmc_stall += APU_DMC_STALL;
+  const u8 *page = apu->bus->read[dmc->addr >> 8];
+  dmc->buffer = page ? page[dmc->addr & 0xFF] : 0;
+  dmc->buffer_full = 1;
+  dmc->addr = dmc->addr == 0xFFFF ? 0x8000 : dmc->addr + 1;
+  if (--dmc->bytes_left == 0) {
+    if (dmc->loop) {
+      dmc->addr = dmc->sample_addr;
+      dmc->bytes_left = dmc->sample_length;
+    } else if (dmc->irq_enabled) {
+      apu->status |= APU_STATUS_DMC_IRQ;
+    }
+  }
+}
+
+// The shift register has run out: the next byte moves in from the buffer,
+// or silence if it's empty, and the buffer is refilled.
+static void dmc_reload(Apu *apu) {
+  Dmc *dmc = &apu->dmc;
+  dmc->bits_left = 8;
+  dmc->silent = !dmc->buffer_full;
+  dmc->shift = dmc->buffer;
+  dmc->buffer_full = 0;
+  dmc_fetch(apu);
+}
+
+// Without sound only the clocks that empty the shift register matter, since
+// they fetch, so the ones in between are skipped.
+static void run_dmc_fetches(Apu *apu, u64 end) {
+  Dmc *dmc = &apu->dmc;
+  u64 period = DMC_PERIODS[dmc->rate];
+  for (;;) {
+    u64 last = dmc->next + (dmc->bits_left - 1) * period;
+    if (last >= end) {
+      u64 clocks = clocks_before(dmc->next, period, end);
+      dmc->bits_left -= clocks;
+      dmc->next += clocks * period;
+      return;
+    }
+    dmc->next = last + period;
+    dmc_reload(apu);
+  }
+}
+
+static void run_dmc(Apu *apu, u64 end) {
+  Dmc *dmc = &apu->dmc;
+  u64 period = DMC_PERIODS[dmc->rate];
+  if (dmc->silent && !dmc->buffer_full && !dmc->bytes_left) {
+    u64 clocks = clocks_before(dmc->next, period, end);
+    dmc->bits_left = (dmc->bits_left + 7 - clocks % 8) % 8 + 1;
+    dmc->next += clocks * period;
+    return;
+  }
+  if (apu->audio == APU_AUDIO_OFF) {
+    run_dmc_fetches(apu, end);
+    return;
+  }
+  while (dmc->next < end) {
+    if (!dmc->silent) {
+      if (dmc->shift & 1) {
+        dmc->level += dmc->level <= 125 ? 2 : 0;
+      } else {
+        dmc->level -= dmc->level >= 2 ? 2 : 0;
+      }
+      set_output(apu, &dmc->output, dmc->level, DMC_WEIGHT, dmc->next);
+    }
+    dmc->shift >>= 1;
+    if (--dmc->bits_left == 0) {
+      dmc_reload(apu);
+    }
+    dmc->next += period;
+  }
+}
+
+static void run_channels(Apu *apu, u64 end) {
+  run_pulse(apu, &apu->pulse[0], end);
+  run_pulse(apu, &apu->pulse[1], end);
+  run_triangle(apu, end);
+  run_noise(apu, end);
+  run_dmc(apu, end);
+}
+
+static void clock_sweep(Pulse *pulse, u8 ones_complement) {
+  if (!pulse->sweep_divider && pulse->sweep_enabled && pulse->sweep_shift &&
+      !pulse_muted(pulse)) {
+    pulse->period = sweep_target(pulse, ones_complement);
+  }
+  if (!pulse->sweep_divider || pulse->sweep_reload) {
+    pulse->sweep_divider = pulse->sweep_period;
+    pulse->sweep_reload = 0;
+  } else {
+    pulse->sweep_divider--;
+  }
+}
+
+static void clock_quarter_frame(Apu *apu) {
+  clock_envelope(&apu->pulse[0].envelope);
+  clock_envelope(&apu->pulse[1].envelope);
+  clock_envelope(&apu->noise.envelope);
+  Triangle *triangle = &apu->triangle;
+  if (triangle->linear_reload) {
+    triangle->linear = triangle->linear_load;
+  } else if (triangle->linear) {
+    triangle->linear--;
+  }
+  if (!triangle->control) {
+    triangle->linear_reload = 0;
+  }
+}
+
+static void clock_half_frame(Apu *apu) {
+  for (u32 i = 0; i < 2; i++) {
+    Pulse *pulse = &apu->pulse[i];
+    if (pulse->length && !pulse->envelope.loop) {
+      pulse->length--;
+    }
+    // Pulse 1 negates in ones' complement, pulse 2 in two's.
+    clock_sweep(pulse, i == 0);
+  }
+  if (apu->triangle.length && !apu->triangle.control) {
+    apu->triangle.length--;
+  }
+  if (apu->noise.length && !apu->noise.envelope.loop) {
+    apu->noise.length--;
+  }
+}
+
+// Puts out whatever levels the registers or the frame counter just changed.
+static void refresh(Apu *apu, u64 cycle) {
+  for (u32 i = 0; i < 2; i++) {
+    Pulse *pulse = &apu->pulse[i];
+    set_output(apu, &pulse->output, pulse_level(pulse), PULSE_WEIGHT, cycle);
+  }
+  set_output(apu, &apu->noise.output, noise_level(&apu->noise), NOISE_WEIGHT,
+             cycle);
+}
+
+static void clock_frame(Apu *apu) {
+  u8 five_step = apu->five_step;
+  u8 last = FRAME_STEP_COUNT[five_step] - 1;
+  u8 step = apu->frame_step;
+  if (!five_step || step != 3) {
+    clock_quarter_frame(apu);
+  }
+  if (step == 1 || step == last) {
+    clock_half_frame(apu);
+  }
+  if (!five_step && step == last && !apu->irq_inhibit) {
+    apu->status |= APU_STATUS_FRAME_IRQ;
+  }
+  refresh(apu, apu->frame_next);
+
+  if (step == last) {
+    apu->frame_step = 0;
+    apu->frame_next += 1 + FRAME_STEPS[five_step][0];
+  } else {
+    apu->frame_step++;
+    apu->frame_next += FRAME_STEPS[five_step][step + 1] -
+                       FRAME_STEPS[five_step][step];
+  }
+}
+
+// Makes the block's samples readable, dropping the oldest ones if nobody has
+// read them for so long that the next block wouldn't fit.
+static void end_block(Apu *apu) {
+  Blip *blip = &apu->blip;
+  apu->block_start += APU_BLOCK_CYCLES;
+  if (apu->audio == APU_AUDIO_OFF) {
+    return;
+  }
+  blip_end_block(blip, APU_BLOCK_CYCLES);
+  u32 room = blip->size - blip_samples(blip, APU_BLOCK_CYCLES);
+  if (blip->avail > room) {
+    blip_read(blip, NULL, blip->avail - room);
+  }
+}
+
+void apu_run_to(Apu *apu, u64 cycle) {
+  while (apu->cycles < cycle) {
+    u64 block_end = apu->block_start + APU_BLOCK_CYCLES;
+    u64 end = cycle < block_end ? cycle : block_end;
+    while (apu->frame_next < end) {
+      run_channels(apu, apu->frame_next);
+      clock_frame(apu);
+    }
+    run_channels(apu, end);
+    apu->cycles = end;
+    if (end == block_end) {
+      end_block(apu);
+    }
+  }
+}
+
+static int open_blip(Apu *apu, u32 rate) {
+  u32 block = (u64)rate * APU_BLOCK_CYCLES / APU_CLOCK_RATE + 1;
+  apu->blip_rate = rate;
+  return blip_init(&apu->blip, APU_CLOCK_RATE, rate,
+                   block * (APU_BUFFER_BLOCKS + 1));
+}
+
+int apu_power_on(Apu *apu, const Bus *bus, u32 sample_rate) {
+  memset(apu, 0, offsetof(Apu, bus));
+  apu->noise.shift = 1;
+  apu->dmc.bits_left = 8;
+  apu->dmc.silent = 1;
+  apu->dmc.sample_addr = 0xC000;
+  apu->dmc.sample_length = 1;
+  apu->frame_next = FRAME_STEPS[0][0];
+  apu->bus = bus;
+  apu->dmc_stall = 0;
+  apu->audio = APU_AUDIO_FULL;
+  apu->sample_rate = sample_rate;
+  return open_blip(apu, sample_rate);
+}
+
+void apu_free(Apu *apu) { blip_free(&apu->blip); }
+
+int apu_set_audio(Apu *apu, ApuAudio audio) {
+  apu->audio = audio;
+  if (audio == APU_AUDIO_OFF) {
+    blip_clear(&apu->blip);
+    return 0;
+  }
+  u32 rate = apu->sample_rate;
+  if (audio == APU_AUDIO_DECIMATED) {
+    rate /= APU_DECIMATION;
+  }
+  if (rate != apu->blip_rate) {
+    blip_free(&apu->blip);
+    if (open_blip(apu, rate) != 0) {
+      return -1;
+    }
+  }
+  // Start over from silence, then put out the levels as they are now. The
+  // triangle and DMC catch up on their next clock.
+  blip_clear(&apu->blip);
+  apu->pulse[0].output = 0;
+  apu->pulse[1].output = 0;
+  apu->triangle.output = 0;
+  apu->noise.output = 0;
+  apu->dmc.output = 0;
+  refresh(apu, apu->cycles);
+  return 0;
+}
+
+static void write_envelope(Envelope *envelope, u8 val) {
+  envelope->loop = val >> 5 & 1;
+  envelope->constant = val >> 4 & 1;
+  envelope->period = val & 0x0F;
+}
+
+static void write_pulse(Pulse *pulse, u8 reg, u8 val) {
+  switch (reg) {
+  case 0:
+    pulse->duty = val >> 6;
+    write_envelope(&pulse->envelope, val);
+    break;
+  case 1:
+    pulse->sweep_enabled = val >> 7;
+    pulse->sweep_period = val >> 4 & 7;
+    pulse->sweep_negate = val >> 3 & 1;
+    pulse->sweep_shift = val & 7;
+    pulse->sweep_reload = 1;
+    break;
+  case 2:
+    pulse->period = (pulse->period & 0x700) | val;
+    break;
+  case 3:
+    pulse->period = (pulse->period & 0xFF) | (val & 7) << 8;
+    pulse->step = 0;
+    pulse->envelope.start = 1;
+    break;
+  }
+}
+
+void apu_write(Apu *apu, u16 addr, u8 val) {
+  u8 reg = addr & 3;
+  switch (addr) {
+  case 0x4000 ... 0x4007: {
+    u8 index = addr >> 2 & 1;
+    write_pulse(&apu->pulse[index], reg, val);
+    if (reg == 3 && (apu->enabled & (APU_STATUS_PULSE1 << index))) {
+      apu->pulse[index].length = LENGTHS[val >> 3];
+    }
+    break;
+  }
+  case 0x4008:
+    apu->triangle.control = val >> 7;
+    apu->triangle.linear_load = val & 0x7F;
+    break;
+  case 0x400A:
+    apu->triangle.period = (apu->triangle.period & 0x700) | val;
+    break;
+  case 0x400B:
+    apu->triangle.period = (apu->triangle.period & 0xFF) | (val & 7) << 8;
+    if (apu->enabled & APU_STATUS_TRIANGLE) {
+      apu->triangle.length = LENGTHS[val >> 3];
+    }
+    apu->triangle.linear_reload = 1;
+    break;
+  case 0x400C:
+    write_envelope(&apu->noise.envelope, val);
+    break;
+  case 0x400E:
+    apu->noise.short_mode = val >> 7;
+    apu->noise.rate = val & 0x0F;
+    break;
+  case 0x400F:
+    if (apu->enabled & APU_STATUS_NOISE) {
+      apu->noise.length = LENGTHS[val >> 3];
+    }
+    apu->noise.envelope.start = 1;
+    break;
+  case 0x4010:
+    apu->dmc.irq_enabled = val >> 7;
+    apu->dmc.loop = val >> 6 & 1;
+    apu->dmc.rate = val & 0x0F;
+    if (!apu->dmc.irq_enabled) {
+      apu->status &= ~APU_STATUS_DMC_IRQ;
+    }
+    break;
+  case 0x4011:
+    apu->dmc.level = val & 0x7F;
+    set_output(apu, &apu->dmc.output, apu->dmc.level, DMC_WEIGHT,
+               apu->cycles);
+    break;
+  case 0x4012:
+    apu->dmc.sample_addr = 0xC000 | val << 6;
+    break;
+  case 0x4013:
+    apu->dmc.sample_length = (val << 4) + 1;
+    break;
+  case 0x4015:
+    apu->enabled = val & 0x1F;
+    for (u32 i = 0; i < 2; i++) {
+      if (!(val & (APU_STATUS_PULSE1 << i))) {
+        apu->pulse[i].length = 0;
+      }
+    }
+    if (!(val & APU_STATUS_TRIANGLE)) {
+      apu->triangle.length = 0;
+    }
+    if (!(val & APU_STATUS_NOISE)) {
+      apu->noise.length = 0;
+    }
+    apu->status &= ~APU_STATUS_DMC_IRQ;
+    if (!(val & APU_STATUS_DMC)) {
+      apu->dmc.bytes_left = 0;
+    } else if (!apu->dmc.bytes_left) {
+      apu->dmc.addr = apu->dmc.sample_addr;
+      apu->dmc.bytes_left = apu->dmc.sample_length;
+      dmc_fetch(apu);
+    }
+    break;
+  case 0x4017:
+    apu->five_step = val >> 7;
+    apu->irq_inhibit = val >> 6 & 1;
+    if (apu->irq_inhibit) {
+      apu->status &= ~APU_STATUS_FRAME_IRQ;
+    }
+    // The sequence restarts 3 or 4 cycles later; the 5-step one clocks
+    // everything straight away.
+    apu->frame_step = 0;
+    apu->frame_next = apu->cycles + 3 + (apu->cycles & 1) + FRAME_STEPS[0][0];
+    if (apu->five_step) {
+      clock_quarter_frame(apu);
+      clock_half_frame(apu);
+    }
+    break;
+  }
+  refresh(apu, apu->cycles);
+}
+
+void apu_reset(Apu *apu) {
+  apu_write(apu, 0x4015, 0);
+  apu_write(apu, 0x4017, apu->five_step << 7 | apu->irq_inhibit << 6);
+  apu->status = 0;
+}
+
+u8 apu_read_status(Apu *apu) {
+  u8 val = apu->status;
+  val |= apu->pulse[0].length ? APU_STATUS_PULSE1 : 0;
+  val |= apu->pulse[1].length ? APU_STATUS_PULSE2 : 0;
+  val |= apu->triangle.length ? APU_STATUS_TRIANGLE : 0;
+  val |= apu->noise.length ? APU_STATUS_NOISE : 0;
+  val |= apu->dmc.bytes_left ? APU_STATUS_DMC : 0;
+  apu->status &= ~APU_STATUS_FRAME_IRQ;
+  return val;
+}
+
+u64 apu_next_frame_irq(const Apu *apu) {
+  if (apu->five_step || apu->irq_inhibit ||
+      (apu->status & APU_STATUS_FRAME_IRQ)) {
+    return UINT64_MAX;
+  }
+  const u16 *steps = FRAME_STEPS[0];
+  return apu->frame_next + steps[3] - steps[apu->frame_step];
+}
+
+u64 apu_next_dmc_fetch(const Apu *apu) {
+  const Dmc *dmc = &apu->dmc;
+  if (!dmc->bytes_left) {
+    return UINT64_MAX;
+  }
+  // The buffer is refilled as soon as the shift register empties it.
+  return dmc->next + (dmc->bits_left - 1) * (u64)DMC_PERIODS[dmc->rate];
+}
+
+u32 apu_read_samples(Apu *apu, s16 *out, u32 count) {
+  return blip_read(&apu->blip, out, count);
+}
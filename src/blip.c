@@ -0,0 +1,106 @@
+#include "blip.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CUTOFF 0.45 // Of the output rate, leaving the kernel room to roll off
+#define HIGH_PASS_SHIFT 10 // Pulls the level back towards 0 like the console's
+
+// A windowed sinc for each phase, delayed by half the taps so a step never
+// reaches back before the sample it falls in.
+static void make_kernel(Blip *blip) {
+  const double half = BLIP_TAPS / 2;
+  for (u32 phase = 0; phase < BLIP_PHASES; phase++) {
+    double taps[BLIP_TAPS];
+    double sum = 0;
+    for (u32 i = 0; i < BLIP_TAPS; i++) {
+      double x = i - half + 1 - (double)phase / BLIP_PHASES;
+      double sinc = x == 0 ? 1 : sin(2 * M_PI * CUTOFF * x) /
+                                     (2 * M_PI * CUTOFF * x);
+      double w = M_PI * x / half;
+      double blackman = 0.42 + 0.5 * cos(w) + 0.08 * cos(2 * w);
+      taps[i] = sinc * blackman;
+      sum += taps[i];
+    }
+    // Every phase has to add up to exactly the step, or the level drifts.
+    s32 total = 0;
+    for (u32 i = 0; i < BLIP_TAPS; i++) {
+      blip->kernel[phase][i] = lround(taps[i] / sum * (1 << BLIP_KERNEL_BITS));
+      total += blip->kernel[phase][i];
+    }
+    blip->kernel[phase][BLIP_TAPS / 2 - 1] += (1 << BLIP_KERNEL_BITS) - total;
+  }
+}
+
+int blip_init(Blip *blip, u32 clock_rate, u32 sample_rate, u32 size) {
+  blip->buf = calloc(size + BLIP_TAPS, sizeof(s32));
+  if (!blip->buf) {
+    return -1;
+  }
+  blip->size = size;
+  // Rounded up, so a block never comes out a sample short.
+  blip->factor = (((u64)sample_rate << 32) + clock_rate - 1) / clock_rate;
+  make_kernel(blip);
+  blip_clear(blip);
+  return 0;
+}
+
+void blip_free(Blip *blip) {
+  free(blip->buf);
+  blip->buf = NULL;
+}
+
+void blip_clear(Blip *blip) {
+  blip->offset = 0;
+  blip->avail = 0;
+  blip->integrator = 0;
+  memset(blip->buf, 0, (blip->size + BLIP_TAPS) * sizeof(s32));
+}
+
+u32 blip_samples(const Blip *blip, u32 clocks) {
+  return ((blip->offset & 0xFFFFFFFF) + clocks * blip->factor + 0xFFFFFFFF) >>
+         32;
+}
+
+void blip_add_delta(Blip *blip, u32 time, s32 delta) {
+  u64 pos = blip->offset + time * blip->factor;
+  u32 index = pos >> 32;
+  if (index >= blip->size) {
+    return;
+  }
+  const s16 *kernel = blip->kernel[(u32)pos >> (32 - BLIP_PHASE_BITS)];
+  s32 *out = blip->buf + index;
+  for (u32 i = 0; i < BLIP_TAPS; i++) {
+    out[i] += kernel[i] * delta;
+  }
+}
+
+void blip_end_block(Blip *blip, u32 clocks) {
+  blip->offset += clocks * blip->factor;
+  blip->avail = blip->offset >> 32;
+}
+
+u32 blip_read(Blip *blip, s16 *out, u32 count) {
+  u32 n = count < blip->avail ? count : blip->avail;
+  s32 sum = blip->integrator;
+  for (u32 i = 0; i < n; i++) {
+    sum += blip->buf[i];
+    if (out) {
+      s32 sample = sum >> BLIP_KERNEL_BITS;
+      out[i] = sample > INT16_MAX   ? INT16_MAX
+               : sample < INT16_MIN ? INT16_MIN
+                                    : sample;
+    }
+    sum -= sum >> HIGH_PASS_SHIFT;
+  }
+  blip->integrator = sum;
+
+  // Shift what's left, the open block and the kernel's overhang included, to
+  // the front.
+  u32 total = blip->size + BLIP_TAPS;
+  memmove(blip->buf, blip->buf + n, (total - n) * sizeof(s32));
+  memset(blip->buf + total - n, 0, n * sizeof(s32));
+  blip->offset -= (u64)n << 32;
+  blip->avail -= n;
+  return n;
+}
@@ -0,0 +1,134 @@
+#include "block.h"
+#include "jit.h"
+#include "opcode.h"
+#include <stdlib.h>
+
+void block_cache_attach(CPU *cpu) {
+  block_cache_detach(cpu);
+  cpu->blocks = calloc(1, sizeof(BlockCache));
+}
+
+void block_cache_attach_jit(CPU *cpu) {
+  block_cache_attach(cpu);
+  cpu->blocks->jit = jit_create();
+}
+
+void block_cache_detach(CPU *cpu) {
+  if (cpu->blocks) {
+    jit_destroy(cpu->blocks->jit);
+  }
+  free(cpu->blocks);
+  cpu->blocks = NULL;
+  for (u32 page = 0; page < 256; page++) {
+    cpu->bus.code[page] = 0;
+  }
+}
+
+// Mirrored memory (work RAM, small PRG-RAM) is reachable through several
+// pages, so a write through any of them has to retire blocks decoded at all.
+void block_invalidate_page(CPU *cpu, u8 page) {
+  const u8 *mem = cpu->bus.write[page];
+  for (u32 alias = 0; alias < 256; alias++) {
+    if (cpu->bus.read[alias] == mem) {
+      if (cpu->blocks) {
+        cpu->blocks->generation[alias]++;
+      }
+      cpu->bus.code[alias] = 0;
+    }
+  }
+  cpu->bus.code[page] = 0;
+}
+
+// Anything that can move PC somewhere other than the next instruction.
+static int ends_block(u8 opcode, const Instruction *instruction) {
+  return instruction->length == 0 || (opcode & 0x1F) == 0x10 ||
+         instruction->func == &jam;
+}
+
+static void decode(CPU *cpu, Block *block, const u8 *mem) {
+  u16 pc = cpu->PC;
+  u8 page = pc >> 8;
+  block->pc = pc;
+  block->page = mem;
+  block->generation = cpu->blocks->generation[page];
+  block->count = 0;
+  block->hits = 0;
+  block->max_cycles = 0;
+  block->native = NULL;
+  while (block->count < BLOCK_MAX_INSTRUCTIONS) {
+    u8 opcode = mem[pc & 0xFF];
+    const Instruction *instruction = &INSTRUCTION_TABLE[opcode];
+    // Operand bytes are read even for instructions without any; the handler
+    // just never looks at them.
+    u32 operand = 0;
+    if ((pc & 0xFF) <= 0xFD) {
+      operand = OPERAND_DECODED | mem[(pc & 0xFF) + 1] |
+                mem[(pc & 0xFF) + 2] << 8;
+    }
+    block->operands[block->count] = operand;
+    block->instructions[block->count++] = *instruction;
+    // Page crossings cost one extra cycle, taken branches up to two.
+    block->max_cycles += instruction->cycles + 2;
+    pc += instruction->length;
+    if (ends_block(opcode, instruction) || (pc >> 8) != page) {
+      break;
+    }
+  }
+  for (u32 alias = 0; alias < 256; alias++) {
+    if (cpu->bus.write[alias] == mem) {
+      cpu->bus.code[alias] = 1;
+    }
+  }
+}
+
+void block_run(CPU *cpu) {
+  BlockCache *cache = cpu->blocks;
+  while (!cpu->halted && cpu->cycles < cpu->deadline) {
+    u8 page = cpu->PC >> 8;
+    const u8 *mem = cpu->bus.read[page];
+    if (mem == NULL) {
+      // Code running out of I/O space can't be cached.
+      execute(cpu);
+      continue;
+    }
+
+    Block *block = &cache->blocks[(cpu->PC ^ (cpu->PC >> 5)) &
+                                  (BLOCK_CACHE_SIZE - 1)];
+    u32 generation = cache->generation[page];
+    if (block->pc != cpu->PC || block->page != mem ||
+        block->generation != generation || block->count == 0) {
+      decode(cpu, block, mem);
+    }
+
+    // A native block runs to its end, so it is only entered when that can't
+    // overshoot the deadline; otherwise the instructions are stepped below,
+    // which keeps the cycle count identical to the interpreter's.
+    if (block->native && cpu->cycles + block->max_cycles < cpu->deadline) {
+      block->native(cpu);
+      cpu->operand = 0;
+      continue;
+    }
+    // A block left interpreted, or dropped by an arena flush, starts counting
+    // again so it gets another chance once it is hot.
+    if (cache->jit && !block->native && ++block->hits >= JIT_THRESHOLD &&
+        !jit_compile(cache->jit, cache, block)) {
+      block->hits = 0;
+    }
+
+    for (u8 i = 0; i < block->count; i++) {
+      const Instruction *instruction = &block->instructions[i];
+      cpu->operand = block->operands[i];
+      instruction->func(cpu);
+      cpu->PC += instruction->length;
+      cpu->cycles += instruction->cycles;
+      // Stop at the deadline, or if the block just overwrote or bank
+      // switched its own page.
+      if (cpu->cycles >= cpu->deadline ||
+          cache->generation[page] != generation ||
+          cpu->bus.read[page] != mem) {
+        break;
+      }
+    }
+    cpu->operand = 0;
+  }
+}
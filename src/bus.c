@@ -0,0 +1,53 @@
+#include "bus.h"
+#include <stddef.h>
+#include <string.h>
+
+static u8 open_bus_read(void *ctx, u16 addr) {
+  (void)ctx;
+  return addr >> 8;
+}
+
+static void open_bus_write(void *ctx, u16 addr, u8 val) {
+  (void)ctx;
+  (void)addr;
+  (void)val;
+}
+
+void bus_init(Bus *bus) {
+  bus_map_io(bus, 0x00, 0xFF, &open_bus_read, &open_bus_write, NULL);
+}
+
+void bus_map(Bus *bus, u8 first, u8 last, u8 *mem, u32 size, u8 writable) {
+  for (u32 page = first; page <= last; page++) {
+    u8 *base = mem + (((page - first) << 8) % size);
+    bus->read[page] = base;
+    bus->write[page] = writable ? base : NULL;
+    bus->read_handler[page] = &open_bus_read;
+    bus->write_handler[page] = &open_bus_write;
+    bus->ctx[page] = NULL;
+  }
+}
+
+void bus_map_rom(Bus *bus, u8 first, u8 last, u8 *mem, u32 size) {
+  for (u32 page = first; page <= last; page++) {
+    bus->read[page] = mem + (((page - first) << 8) % size);
+    bus->write[page] = NULL;
+  }
+}
+
+void bus_map_io(Bus *bus, u8 first, u8 last, BusReadFunc read,
+                BusWriteFunc write, void *ctx) {
+  for (u32 page = first; page <= last; page++) {
+    bus->read[page] = NULL;
+    bus->write[page] = NULL;
+    bus->read_handler[page] = read ? read : &open_bus_read;
+    bus->write_handler[page] = write ? write : &open_bus_write;
+    bus->ctx[page] = ctx;
+  }
+}
+
+void bus_clear_dirty(Bus *bus) { memset(bus->dirty, 0, sizeof(bus->dirty)); }
+
+u8 bus_page_dirty(const Bus *bus, u8 page) {
+  return (bus->dirty[page >> 6] >> (page & 63)) & 1;
+}
@@ -1,94 +1,124 @@
+#include "emu.h"
+#include "block.h"
+#include "bus.h"
+#include "instructions.h"
 #include "opcode.h"
-#include "types.h"
-#include <stdio.h>
+#include "trace.h"
+#include <stdint.h>
+#include <string.h>
 
-typedef void (*InstructionFunc)(CPU *);
+// Opcodes missing from INSTRUCTION_LIST fall back to jam.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
 
-const InstructionFunc INSTRUCTION_TABLE[256] = {
-    [BRK_IMP] = &brk,
-    [LDA_IMM] = &lda_immediate,
-    [LDA_ZP] = &lda_zeropage,
-    [LDA_ZPX] = &lda_zeropage_x,
-    [LDA_ABS] = &lda_absolute,
-    [LDA_ABSX] = &lda_absolute_x,
-    [LDA_ABSY] = &lda_absolute_y,
-    [LDA_INDX] = &lda_indirect_x,
-    [LDA_INDY] = &lda_indirect_y,
-    [LDX_IMM] = &ldx_immediate,
-    [LDX_ZP] = &ldx_zeropage,
-    [LDX_ZPY] = &ldx_zeropage_y,
-    [LDX_ABS] = &ldx_absolute,
-    [LDX_ABSY] = &ldx_absolute_y,
-    [LDY_IMM] = &ldy_immediate,
-    [LDY_ZP] = &ldy_zeropage,
-    [LDY_ZPX] = &ldy_zeropage_x,
-    [LDY_ABS] = &ldy_absolute,
-    [LDY_ABSX] = &ldy_absolute_x,
-    [STA_ZP] = &sta_zeropage,
-    [STA_ZPX] = &sta_zeropage_x,
-    [STA_ABS] = &sta_absolute,
-    [STA_ABSX] = &sta_absolute_x,
-    [STA_ABSY] = &sta_absolute_y,
-    [STA_INDX] = &sta_indirect_x,
-    [STA_INDY] = &sta_indirect_y,
-    [STX_ZP] = &stx_zeropage,
-    [STX_ZPY] = &stx_zeropage_y,
-    [STX_ABS] = &stx_absolute,
-    [STY_ZP] = &sty_zeropage,
-    [STY_ZPX] = &sty_zeropage_x,
-    [STY_ABS] = &sty_absolute,
-    [TAX_IMP] = &tax,
-    [TAY_IMP] = &tay,
-    [TXA_IMP] = &txa,
-    [TYA_IMP] = &tya,
-    [BCC_REL] = &bcc,
-    [BCS_REL] = &bcs,
-    [BEQ_REL] = &beq,
-    [BMI_REL] = &bmi,
-    [BNE_REL] = &bne,
-    [BPL_REL] = &bpl,
-    [BVC_REL] = &bvc,
-    [BVS_REL] = &bvs,
-    [PHA_IMP] = &pha,
-    [PHP_IMP] = &php,
-    [PLA_IMP] = &pla,
-    [PLP_IMP] = &plp,
-};
+#define TABLE_ENTRY(op, func, length, cycles) [op] = {&func, length, cycles},
+const Instruction INSTRUCTION_TABLE[256] = {
+    [0 ... 255] = {&jam, 0, 0},
+    INSTRUCTION_LIST(TABLE_ENTRY)};
+#undef TABLE_ENTRY
+
+void power_on(CPU *cpu) {
+  memset(cpu, 0, sizeof(*cpu));
+  bus_init(&cpu->bus);
+  bus_map(&cpu->bus, 0x00, 0x1F, cpu->ram, sizeof(cpu->ram), 1);
+}
+
+void reset(CPU *cpu) {
+  cpu->PC = absolute_addr_at(cpu, 0xFFFC);
+  cpu->S = 0xFD;
+  set_status(cpu, FLAG_INTERRUPT_DISABLE | 0x20);
+  cpu->halted = 0;
+  cpu->cycles += 7;
+}
 
 void execute(CPU *cpu) {
-  u8 opcode = read_byte(cpu, cpu->PC);
-  if (1) {
-  }
+  const Instruction *instruction = &INSTRUCTION_TABLE[read_byte(cpu, cpu->PC)];
+  instruction->func(cpu);
+  cpu->PC += instruction->length;
+  cpu->cycles += instruction->cycles;
 }
 
-void run_loop(CPU *cpu) {
-  while (1) {
+#ifdef THREADED_DISPATCH
+// Computed-goto dispatch: every opcode ends in its own indirect jump, so the
+// branch predictor learns opcode-to-opcode transitions instead of sharing the
+// single indirect call in execute().
+static void interpret(CPU *cpu) {
+#define LABEL_ENTRY(op, func, len, cyc) [op] = &&op_##op,
+  static void *const labels[256] = {[0 ... 255] = &&op_jam,
+                                    INSTRUCTION_LIST(LABEL_ENTRY)};
+#undef LABEL_ENTRY
+
+#define DISPATCH()                                                             \
+  if (cpu->cycles >= cpu->deadline) {                                          \
+    return;                                                                    \
+  }                                                                            \
+  goto *labels[read_byte(cpu, cpu->PC)]
+#define LABEL_BODY(op, func, len, cyc)                                         \
+  op_##op : func(cpu);                                                         \
+  cpu->PC += len;                                                              \
+  cpu->cycles += cyc;                                                          \
+  DISPATCH();
+
+  DISPATCH();
+  INSTRUCTION_LIST(LABEL_BODY)
+op_jam:
+  jam(cpu);
+#undef LABEL_BODY
+#undef DISPATCH
+}
+#else
+static void interpret(CPU *cpu) {
+  while (!cpu->halted && cpu->cycles < cpu->deadline) {
     execute(cpu);
-    if (get_flag(cpu, FLAG_BREAK)) {
-      break;
-    }
   }
 }
+#endif
 
-int main(int argc, char *argv[]) {
-  if (argc < 2) {
-    fprintf(stderr, "file not provided.\n");
-    return 1;
+// Kept apart so the untraced loops don't pay for the check. Each entry is
+// built in registers and stored in one go; operands that would have to be read
+// through an I/O handler are recorded as 0 instead.
+static void interpret_traced(CPU *cpu) {
+  Trace *trace = cpu->trace;
+  while (!cpu->halted && cpu->cycles < cpu->deadline) {
+    TraceEntry entry = {
+        .cycles = cpu->cycles,
+        .cycles_hi = cpu->cycles >> 32,
+        .pc = cpu->PC,
+        .a = cpu->A,
+        .x = cpu->X,
+        .y = cpu->Y,
+        .p = get_status(cpu),
+        .s = cpu->S,
+    };
+    const u8 *mem = cpu->bus.read[cpu->PC >> 8];
+    if (mem && (cpu->PC & 0xFF) <= 0xFD) {
+      memcpy(entry.bytes, mem + (cpu->PC & 0xFF), 3);
+    } else {
+      for (u32 i = 0; i < 3; i++) {
+        const u8 *page = cpu->bus.read[(u16)(cpu->PC + i) >> 8];
+        entry.bytes[i] = page ? page[(cpu->PC + i) & 0xFF] : 0;
+      }
+    }
+    trace->entries[trace->count++ & trace->mask] = entry;
+    execute(cpu);
   }
+}
 
-  char *filename = argv[1];
-  FILE *file = fopen(filename, "rb");
-  if (file == NULL) {
-    fprintf(stderr, "error opening file. the file may not exist.\n");
-    return 1;
+void run_until(CPU *cpu, u64 cycles) {
+  cpu->deadline = cycles;
+  if (cpu->trace) {
+    interpret_traced(cpu);
+    return;
   }
+  if (cpu->blocks) {
+    block_run(cpu);
+    return;
+  }
+  interpret(cpu);
+}
 
-  fseek(file, 0, SEEK_END);
-  long file_size = ftell(file);
-  fseek(file, 0, SEEK_SET);
+void stop_run(CPU *cpu) { cpu->deadline = 0; }
 
-  printf("the file is %ld big\n", file_size);
-  CPU cpu = {0};
+void run_loop(CPU *cpu) { run_until(cpu, UINT64_MAX); }
 
-  return 0;
-}
+#pragma GCC diagnostic pop
@@ -0,0 +1,225 @@
+#include "farm.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int parse_status(const char *str, RunStatus *status) {
+  static const RunStatus statuses[] = {RUN_PASS, RUN_TIMEOUT, RUN_JAM,
+                                       RUN_FAIL};
+  for (u32 i = 0; i < sizeof(statuses) / sizeof(statuses[0]); i++) {
+    if (strcmp(str, run_status_str(statuses[i])) == 0) {
+      *status = statuses[i];
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static char *resolve_path(const char *list_path, const char *rom) {
+  const char *slash = strrchr(list_path, '/');
+  if (rom[0] == '/' || slash == NULL) {
+    return strdup(rom);
+  }
+  size_t dir_len = slash - list_path + 1;
+  char *path = malloc(dir_len + strlen(rom) + 1);
+  memcpy(path, list_path, dir_len);
+  strcpy(path + dir_len, rom);
+  return path;
+}
+
+int farm_load(FarmJobList *list, const char *path) {
+  list->jobs = NULL;
+  list->count = 0;
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return -1;
+  }
+
+  u32 capacity = 0;
+  char line[1024];
+  int line_no = 0;
+  while (fgets(line, sizeof(line), file)) {
+    line_no++;
+    char rom[512], until[32], expect[16];
+    unsigned long long frames;
+    if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#') {
+      continue;
+    }
+    FarmJob job = {0};
+    if (sscanf(line, "%511s %llu %31s %15s", rom, &frames, until, expect) !=
+            4 ||
+        (strcmp(until, "-") != 0 &&
+         runner_parse_until(&job.config, until) != 0) ||
+        parse_status(expect, &job.expect) != 0) {
+      fclose(file);
+      farm_free(list);
+      return line_no;
+    }
+    job.config.max_cycles = FRAMES_TO_CPU_CYCLES(frames);
+    job.rom = resolve_path(path, rom);
+
+    if (list->count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      list->jobs = realloc(list->jobs, capacity * sizeof(FarmJob));
+    }
+    list->jobs[list->count++] = job;
+  }
+  fclose(file);
+  return 0;
+}
+
+void farm_free(FarmJobList *list) {
+  for (u32 i = 0; i < list->count; i++) {
+    free(list->jobs[i].rom);
+  }
+  free(list->jobs);
+  list->jobs = NULL;
+  list->count = 0;
+}
+
+// A worker's share of the jobs. The owner takes from the head and thieves
+// take from the tail, so they only contend over the last few entries.
+typedef struct {
+  pthread_mutex_t lock;
+  u32 *items;
+  u32 head;
+  u32 tail;
+} WorkQueue;
+
+typedef struct {
+  FarmJobList *list;
+  WorkQueue *queues;
+  u32 count;
+} Farm;
+
+typedef struct {
+  Farm *farm;
+  u32 id;
+} Worker;
+
+static int take_own(WorkQueue *queue, u32 *job) {
+  int found = 0;
+  pthread_mutex_lock(&queue->lock);
+  if (queue->head < queue->tail) {
+    *job = queue->items[queue->head++];
+    found = 1;
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return found;
+}
+
+static int steal(WorkQueue *queue, u32 *job) {
+  int found = 0;
+  pthread_mutex_lock(&queue->lock);
+  if (queue->head < queue->tail) {
+    *job = queue->items[--queue->tail];
+    found = 1;
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return found;
+}
+
+static int next_job(Worker *worker, u32 *job) {
+  Farm *farm = worker->farm;
+  if (take_own(&farm->queues[worker->id], job)) {
+    return 1;
+  }
+  // No job ever adds more work, so one empty sweep means we're done.
+  for (u32 i = 1; i < farm->count; i++) {
+    if (steal(&farm->queues[(worker->id + i) % farm->count], job)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void run_job(NES *nes, FarmJob *job) {
+  RunResult result = {0};
+  result.error = nes_load(nes, job->rom);
+  if (result.error != ROM_OK) {
+    result.status = RUN_ERROR;
+  } else {
+    result = runner_run(nes, &job->config);
+    nes_unload(nes);
+  }
+  job->result = result;
+}
+
+static void *worker_main(void *arg) {
+  Worker *worker = arg;
+  NES *nes = malloc(sizeof(NES));
+  u32 job;
+  while (next_job(worker, &job)) {
+    run_job(nes, &worker->farm->list->jobs[job]);
+  }
+  free(nes);
+  return NULL;
+}
+
+void farm_run(FarmJobList *list, u32 threads) {
+  if (threads == 0) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cores > 0 ? cores : 1;
+  }
+  if (threads > list->count) {
+    threads = list->count ? list->count : 1;
+  }
+
+  Farm farm = {list, calloc(threads, sizeof(WorkQueue)), threads};
+  Worker *workers = calloc(threads, sizeof(Worker));
+  pthread_t *handles = calloc(threads, sizeof(pthread_t));
+  for (u32 i = 0; i < threads; i++) {
+    WorkQueue *queue = &farm.queues[i];
+    pthread_mutex_init(&queue->lock, NULL);
+    queue->items = malloc((list->count / threads + 1) * sizeof(u32));
+  }
+  // Deal the jobs out round-robin; stealing evens out whatever is left.
+  for (u32 i = 0; i < list->count; i++) {
+    WorkQueue *queue = &farm.queues[i % threads];
+    queue->items[queue->tail++] = i;
+  }
+
+  for (u32 i = 0; i < threads; i++) {
+    workers[i] = (Worker){&farm, i};
+    pthread_create(&handles[i], NULL, &worker_main, &workers[i]);
+  }
+  for (u32 i = 0; i < threads; i++) {
+    pthread_join(handles[i], NULL);
+  }
+
+  for (u32 i = 0; i < threads; i++) {
+    pthread_mutex_destroy(&farm.queues[i].lock);
+    free(farm.queues[i].items);
+  }
+  free(farm.queues);
+  free(workers);
+  free(handles);
+}
+
+u32 farm_report(FILE *out, const FarmJobList *list) {
+  u32 failed = 0;
+  for (u32 i = 0; i < list->count; i++) {
+    const FarmJob *job = &list->jobs[i];
+    runner_print(out, job->rom, &job->result);
+    if (job->result.status != job->expect) {
+      fprintf(out, "mismatch rom=%s expected=%s\n", job->rom,
+              run_status_str(job->expect));
+      failed++;
+    }
+  }
+  fprintf(out, "farm jobs=%u passed=%u failed=%u\n", list->count,
+          list->count - failed, failed);
+  return failed;
+}
+
+u32 farm_report_unity(FILE *out, const FarmJobList *list) {
+  u32 failed = 0;
+  for (u32 i = 0; i < list->count; i++) {
+    const FarmJob *job = &list->jobs[i];
+    runner_print_unity(out, job->rom, &job->result, job->expect);
+    failed += job->result.status != job->expect;
+  }
+  fprintf(out, "%u Tests %u Failures 0 Ignored\n", list->count, failed);
+  return failed;
+}
@@ -0,0 +1,400 @@
+#include "jit.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Worst case per instruction is about 130 bytes: two flushes, a handler call
+// with its operand and the generation, page and deadline checks.
+#define MAX_BLOCK_CODE 2560
+
+// The generated code keeps the CPU pointer in rbx and uses eax, ecx and edx
+// as scratch, all addressed as [rbx + disp32].
+#define RBX_DISP32(reg) (0x80 | ((reg) << 3) | 3)
+#define EAX 0
+#define ECX 1
+#define EDX 2
+
+typedef struct {
+  u8 *code;
+  u32 size;
+  u16 pending_pc;     // PC advance not yet written back
+  u32 pending_cycles; // Cycles not yet written back
+} Emitter;
+
+static void emit8(Emitter *e, u8 byte) { e->code[e->size++] = byte; }
+
+static void emit32(Emitter *e, u32 value) {
+  memcpy(e->code + e->size, &value, 4);
+  e->size += 4;
+}
+
+static void emit64(Emitter *e, u64 value) {
+  memcpy(e->code + e->size, &value, 8);
+  e->size += 8;
+}
+
+static void emit_modrm(Emitter *e, u8 reg, u32 field) {
+  emit8(e, RBX_DISP32(reg));
+  emit32(e, field);
+}
+
+// movzx reg, byte [rbx + field]
+static void load_field(Emitter *e, u8 reg, u32 field) {
+  emit8(e, 0x0F);
+  emit8(e, 0xB6);
+  emit_modrm(e, reg, field);
+}
+
+// mov byte [rbx + field], reg8
+static void store_field(Emitter *e, u8 reg, u32 field) {
+  emit8(e, 0x88);
+  emit_modrm(e, reg, field);
+}
+
+// mov byte [rbx + field], imm8
+static void store_field_imm(Emitter *e, u32 field, u8 value) {
+  emit8(e, 0xC6);
+  emit_modrm(e, 0, field);
+  emit8(e, value);
+}
+
+// Group 1 byte op on [rbx + field]: 1 is or, 4 is and.
+static void alu_field_imm(Emitter *e, u8 op, u32 field, u8 value) {
+  emit8(e, 0x80);
+  emit_modrm(e, op, field);
+  emit8(e, value);
+}
+
+// Updates N and Z for the value in al, as set_nz does.
+static void emit_nz(Emitter *e) {
+#ifdef LAZY_FLAGS
+  store_field(e, EAX, offsetof(CPU, n_result));
+  store_field(e, EAX, offsetof(CPU, z_result));
+#else
+  load_field(e, ECX, offsetof(CPU, P));
+  emit8(e, 0x83); // and ecx, ~(N | Z)
+  emit8(e, 0xE1);
+  emit8(e, (u8) ~(FLAG_NEGATIVE | FLAG_ZERO));
+  emit8(e, 0x84); // test al, al
+  emit8(e, 0xC0);
+  emit8(e, 0x0F); // setz dl
+  emit8(e, 0x94);
+  emit8(e, 0xC2);
+  emit8(e, 0xD0); // shl dl, 1
+  emit8(e, 0xE2);
+  emit8(e, 0x08); // or cl, dl
+  emit8(e, 0xD1);
+  emit8(e, 0x88); // mov dl, al
+  emit8(e, 0xC2);
+  emit8(e, 0x80); // and dl, N
+  emit8(e, 0xE2);
+  emit8(e, FLAG_NEGATIVE);
+  emit8(e, 0x08); // or cl, dl
+  emit8(e, 0xD1);
+  store_field(e, ECX, offsetof(CPU, P));
+#endif
+}
+
+// N and Z for a value known at translation time.
+static void emit_nz_const(Emitter *e, u8 value) {
+#ifdef LAZY_FLAGS
+  store_field_imm(e, offsetof(CPU, n_result), value);
+  store_field_imm(e, offsetof(CPU, z_result), value);
+#else
+  alu_field_imm(e, 4, offsetof(CPU, P), (u8) ~(FLAG_NEGATIVE | FLAG_ZERO));
+  u8 flags = (value & FLAG_NEGATIVE) | (value ? 0 : FLAG_ZERO);
+  if (flags) {
+    alu_field_imm(e, 1, offsetof(CPU, P), flags);
+  }
+#endif
+}
+
+// Writes back the PC and cycles of inline instructions, which handlers and
+// the caller expect to be current.
+static void flush(Emitter *e) {
+  if (e->pending_pc) {
+    emit8(e, 0x66); // add word [rbx + PC], imm16
+    emit8(e, 0x81);
+    emit_modrm(e, 0, offsetof(CPU, PC));
+    emit8(e, e->pending_pc & 0xFF);
+    emit8(e, e->pending_pc >> 8);
+    e->pending_pc = 0;
+  }
+  if (e->pending_cycles) {
+    emit8(e, 0x48); // add qword [rbx + cycles], imm32
+    emit8(e, 0x81);
+    emit_modrm(e, 0, offsetof(CPU, cycles));
+    emit32(e, e->pending_cycles);
+    e->pending_cycles = 0;
+  }
+}
+
+static void emit_return(Emitter *e) {
+  emit8(e, 0x5B); // pop rbx
+  emit8(e, 0xC3); // ret
+}
+
+// Hands the handler its decoded operand, or 0 to make it fetch its own.
+static void emit_call(Emitter *e, InstructionFunc func, u32 operand) {
+  emit8(e, 0xC7); // mov dword [rbx + operand], imm32
+  emit_modrm(e, 0, offsetof(CPU, operand));
+  emit32(e, operand);
+  emit8(e, 0x48); // mov rdi, rbx
+  emit8(e, 0x89);
+  emit8(e, 0xDF);
+  emit8(e, 0x48); // mov rax, func
+  emit8(e, 0xB8);
+  emit64(e, (u64)(uintptr_t)func);
+  emit8(e, 0xFF); // call rax
+  emit8(e, 0xD0);
+}
+
+// Leaves the block if a handler stored into its page.
+static void emit_generation_check(Emitter *e, const u32 *generation,
+                                  u32 expected) {
+  emit8(e, 0x48); // mov rax, generation
+  emit8(e, 0xB8);
+  emit64(e, (u64)(uintptr_t)generation);
+  emit8(e, 0x81); // cmp dword [rax], expected
+  emit8(e, 0x38);
+  emit32(e, expected);
+  emit8(e, 0x74); // je +2
+  emit8(e, 0x02);
+  emit_return(e);
+}
+
+// Leaves the block if a handler bank switched its page out from under it.
+static void emit_page_check(Emitter *e, u8 page, const u8 *expected) {
+  emit8(e, 0x48); // mov rax, [rbx + bus.read[page]]
+  emit8(e, 0x8B);
+  emit_modrm(e, EAX, offsetof(CPU, bus.read) + page * sizeof(u8 *));
+  emit8(e, 0x48); // mov rcx, expected
+  emit8(e, 0xB9);
+  emit64(e, (u64)(uintptr_t)expected);
+  emit8(e, 0x48); // cmp rax, rcx
+  emit8(e, 0x39);
+  emit8(e, 0xC8);
+  emit8(e, 0x74); // je +2
+  emit8(e, 0x02);
+  emit_return(e);
+}
+
+// Leaves the block if a handler cut the run short with stop_run().
+static void emit_deadline_check(Emitter *e) {
+  emit8(e, 0x48); // mov rax, [rbx + cycles]
+  emit8(e, 0x8B);
+  emit_modrm(e, EAX, offsetof(CPU, cycles));
+  emit8(e, 0x48); // cmp rax, [rbx + deadline]
+  emit8(e, 0x3B);
+  emit_modrm(e, EAX, offsetof(CPU, deadline));
+  emit8(e, 0x72); // jb +2
+  emit8(e, 0x02);
+  emit_return(e);
+}
+
+static void transfer(Emitter *e, u32 from, u32 to, int flags) {
+  load_field(e, EAX, from);
+  store_field(e, EAX, to);
+  if (flags) {
+    emit_nz(e);
+  }
+}
+
+// inc or dec byte [rbx + field], then N and Z from the result.
+static void step(Emitter *e, u32 field, int down) {
+  emit8(e, 0xFE);
+  emit_modrm(e, down, field);
+  load_field(e, EAX, field);
+  emit_nz(e);
+}
+
+// Emits the instructions simple enough to inline, returning 0 for the rest.
+// operand is only valid when has_operand is set.
+static int emit_inline(Emitter *e, u8 opcode, u8 operand, int has_operand) {
+  const u32 A = offsetof(CPU, A);
+  const u32 X = offsetof(CPU, X);
+  const u32 Y = offsetof(CPU, Y);
+  const u32 S = offsetof(CPU, S);
+  const u32 P = offsetof(CPU, P);
+
+  switch (opcode) {
+  case LDA_IMM:
+  case LDX_IMM:
+  case LDY_IMM:
+    if (!has_operand) {
+      return 0;
+    }
+    store_field_imm(e, opcode == LDA_IMM ? A : opcode == LDX_IMM ? X : Y,
+                    operand);
+    emit_nz_const(e, operand);
+    return 1;
+  case TAX_IMP:
+    transfer(e, A, X, 1);
+    return 1;
+  case TAY_IMP:
+    transfer(e, A, Y, 1);
+    return 1;
+  case TXA_IMP:
+    transfer(e, X, A, 1);
+    return 1;
+  case TYA_IMP:
+    transfer(e, Y, A, 1);
+    return 1;
+  case TSX_IMP:
+    transfer(e, S, X, 1);
+    return 1;
+  case TXS_IMP:
+    transfer(e, X, S, 0);
+    return 1;
+  case INX_IMP:
+    step(e, X, 0);
+    return 1;
+  case INY_IMP:
+    step(e, Y, 0);
+    return 1;
+  case DEX_IMP:
+    step(e, X, 1);
+    return 1;
+  case DEY_IMP:
+    step(e, Y, 1);
+    return 1;
+  case CLC_IMP:
+    alu_field_imm(e, 4, P, (u8)~FLAG_CARRY);
+    return 1;
+  case SEC_IMP:
+    alu_field_imm(e, 1, P, FLAG_CARRY);
+    return 1;
+  // CLI goes through cli(), which ends the run when it unmasks an IRQ.
+  case SEI_IMP:
+    alu_field_imm(e, 1, P, FLAG_INTERRUPT_DISABLE);
+    return 1;
+  case CLV_IMP:
+    alu_field_imm(e, 4, P, (u8)~FLAG_OVERFLOW);
+    return 1;
+  case CLD_IMP:
+    alu_field_imm(e, 4, P, (u8)~FLAG_DECIMAL);
+    return 1;
+  case SED_IMP:
+    alu_field_imm(e, 1, P, FLAG_DECIMAL);
+    return 1;
+  case NOP_IMP:
+    return 1;
+  }
+  return 0;
+}
+
+// The arena is never writable and executable at once: the pages a block is
+// emitted into are made writable for jit_compile and executable again before
+// anything runs.
+static int protect(u8 *start, u32 size, int prot) {
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t first = (uintptr_t)start & ~(page - 1);
+  uintptr_t end = ((uintptr_t)start + size + page - 1) & ~(page - 1);
+  return mprotect((void *)first, end - first, prot);
+}
+
+Jit *jit_create(void) {
+  void *arena = mmap(NULL, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (arena == MAP_FAILED) {
+    return NULL;
+  }
+  Jit *jit = calloc(1, sizeof(Jit));
+  if (jit == NULL) {
+    munmap(arena, JIT_ARENA_SIZE);
+    return NULL;
+  }
+  jit->arena = arena;
+  return jit;
+}
+
+void jit_destroy(Jit *jit) {
+  if (jit == NULL) {
+    return;
+  }
+  munmap(jit->arena, JIT_ARENA_SIZE);
+  free(jit);
+}
+
+// Drops every translation so the arena can be reused from the start.
+static void flush_arena(Jit *jit, BlockCache *cache) {
+  for (u32 i = 0; i < BLOCK_CACHE_SIZE; i++) {
+    cache->blocks[i].native = NULL;
+    cache->blocks[i].hits = 0;
+  }
+  jit->used = 0;
+}
+
+int jit_compile(Jit *jit, BlockCache *cache, Block *block) {
+  u8 page = block->pc >> 8;
+  if (block->native || cache->generation[page] >= JIT_SMC_LIMIT) {
+    return 0;
+  }
+  if (jit->used + MAX_BLOCK_CODE > JIT_ARENA_SIZE) {
+    flush_arena(jit, cache);
+  }
+
+  u8 *code = jit->arena + jit->used;
+  if (protect(code, MAX_BLOCK_CODE, PROT_READ | PROT_WRITE) < 0) {
+    return 0;
+  }
+  Emitter e = {code, 0, 0, 0};
+  emit8(&e, 0x53); // push rbx
+  emit8(&e, 0x48); // mov rbx, rdi
+  emit8(&e, 0x89);
+  emit8(&e, 0xFB);
+
+  u8 pc = block->pc & 0xFF;
+  for (u8 i = 0; i < block->count; i++) {
+    const Instruction *instruction = &block->instructions[i];
+    u8 opcode = block->page[pc];
+    // Operands are only decoded where they lie on the block's own page, which
+    // is the one the generation check covers.
+    u32 operand = block->operands[i];
+
+    if (!emit_inline(&e, opcode, operand, operand != 0)) {
+      flush(&e);
+      emit_call(&e, instruction->func, operand);
+      e.pending_pc = instruction->length;
+      e.pending_cycles = instruction->cycles;
+      if (i + 1 < block->count) {
+        flush(&e);
+        emit_generation_check(&e, &cache->generation[page],
+                              block->generation);
+        emit_page_check(&e, page, block->page);
+        emit_deadline_check(&e);
+      }
+    } else {
+      e.pending_pc += instruction->length;
+      e.pending_cycles += instruction->cycles;
+    }
+    pc += instruction->length;
+  }
+  flush(&e);
+  emit_return(&e);
+  if (protect(code, MAX_BLOCK_CODE, PROT_READ | PROT_EXEC) < 0) {
+    return 0;
+  }
+
+  block->native = (JitCode)(void *)code;
+  jit->used += (e.size + 15) & ~15u;
+  return 1;
+}
+
+#else
+Jit *jit_create(void) { return NULL; }
+
+void jit_destroy(Jit *jit) { (void)jit; }
+
+int jit_compile(Jit *jit, BlockCache *cache, Block *block) {
+  (void)jit;
+  (void)cache;
+  (void)block;
+  return 0;
+}
+#endif
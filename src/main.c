@@ -0,0 +1,194 @@
+#include "farm.h"
+#include "nes.h"
+#include "runner.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [options] rom.nes\n"
+          "       %s --farm jobs.txt [--threads N] [--unity]\n"
+          "  --info        print the ROM header and exit\n"
+          "  --cycles N    stop after N CPU cycles\n"
+          "  --frames N    stop after N frames\n"
+          "  --until A=V   stop once address A holds V (hex), or A!=V, or\n"
+          "                with blargg once the ROM reports at $6000\n"
+          "  --farm FILE   run every job in FILE in parallel\n"
+          "  --threads N   worker threads for --farm, default one per core\n"
+          "  --unity       report --farm results as Unity test lines\n"
+          "  --engine E    interp (default), blocks to cache decoded code or\n"
+          "                jit to also translate hot code to x86-64\n"
+          "  --trace FILE  record the last instructions run into FILE\n"
+          "  --audio FILE  write the sound to FILE as raw signed 16-bit\n"
+          "                mono PCM at 48 kHz\n"
+          "  --decimate    make the sound at 12 kHz instead, which is cheaper\n"
+          "  --print-trace FILE\n"
+          "                print a recorded trace in nestest.log format\n"
+          "Runs headless and prints one result line. The exit status is 0\n"
+          "when --until was met, 2 on timeout, 3 if the CPU jammed, 4 if the\n"
+          "ROM reported a failure and 1 on errors. With --farm it is 0 only\n"
+          "if every job matched.\n",
+          prog, prog);
+}
+
+static int print_info(const char *path) {
+  Rom rom;
+  RomError err = rom_load(&rom, path);
+  if (err != ROM_OK) {
+    fprintf(stderr, "%s: %s.\n", path, rom_error_str(err));
+    return 1;
+  }
+
+  printf("%s: %s mapper %u, %u KiB PRG, %u KiB CHR%s\n", path,
+         rom.nes2 ? "NES 2.0" : "iNES", rom.mapper, rom.prg_size / 1024,
+         (rom.chr_size ? rom.chr_size : rom.chr_ram_size) / 1024,
+         rom.chr_size ? "" : " RAM");
+  rom_unload(&rom);
+  return 0;
+}
+
+static int parse_engine(Engine *engine, const char *arg) {
+  if (strcmp(arg, "interp") == 0) {
+    *engine = ENGINE_INTERPRETER;
+  } else if (strcmp(arg, "blocks") == 0) {
+    *engine = ENGINE_BLOCKS;
+  } else if (strcmp(arg, "jit") == 0) {
+    *engine = ENGINE_JIT;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+static int run_farm(const char *path, u32 threads, Engine engine, int unity) {
+  FarmJobList list;
+  int err = farm_load(&list, path);
+  if (err < 0) {
+    fprintf(stderr, "%s: could not open job list.\n", path);
+    return 1;
+  }
+  if (err > 0) {
+    fprintf(stderr, "%s:%d: bad job.\n", path, err);
+    return 1;
+  }
+
+  for (u32 i = 0; i < list.count; i++) {
+    list.jobs[i].config.engine = engine;
+  }
+  farm_run(&list, threads);
+  u32 failed = unity ? farm_report_unity(stdout, &list)
+                     : farm_report(stdout, &list);
+  farm_free(&list);
+  return failed ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+  RunConfig config = {0};
+  const char *path = NULL;
+  const char *farm = NULL;
+  const char *trace_path = NULL;
+  const char *audio_path = NULL;
+  u32 threads = 0;
+  int info = 0;
+  int unity = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    int has_value = i + 1 < argc;
+    if (strcmp(arg, "--info") == 0) {
+      info = 1;
+    } else if (strcmp(arg, "--cycles") == 0 && has_value) {
+      config.max_cycles = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(arg, "--frames") == 0 && has_value) {
+      config.max_cycles = FRAMES_TO_CPU_CYCLES(strtoull(argv[++i], NULL, 0));
+    } else if (strcmp(arg, "--farm") == 0 && has_value) {
+      farm = argv[++i];
+    } else if (strcmp(arg, "--unity") == 0) {
+      unity = 1;
+    } else if (strcmp(arg, "--threads") == 0 && has_value) {
+      threads = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(arg, "--engine") == 0 && has_value) {
+      if (parse_engine(&config.engine, argv[++i]) != 0) {
+        fprintf(stderr, "unknown engine: %s\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(arg, "--trace") == 0 && has_value) {
+      trace_path = argv[++i];
+    } else if (strcmp(arg, "--decimate") == 0) {
+      config.audio_mode = APU_AUDIO_DECIMATED;
+    } else if (strcmp(arg, "--audio") == 0 && has_value) {
+      audio_path = argv[++i];
+    } else if (strcmp(arg, "--print-trace") == 0 && has_value) {
+      if (trace_print(stdout, argv[++i]) != 0) {
+        fprintf(stderr, "%s: could not read trace.\n", argv[i]);
+        return 1;
+      }
+      return 0;
+    } else if (strcmp(arg, "--until") == 0 && has_value) {
+      if (runner_parse_until(&config, argv[++i]) != 0) {
+        fprintf(stderr, "bad --until condition: %s\n", argv[i]);
+        return 1;
+      }
+    } else if (arg[0] == '-' || path != NULL) {
+      usage(argv[0]);
+      return 1;
+    } else {
+      path = arg;
+    }
+  }
+
+  if (farm != NULL) {
+    return run_farm(farm, threads, config.engine, unity);
+  }
+  if (path == NULL) {
+    fprintf(stderr, "file not provided.\n");
+    usage(argv[0]);
+    return 1;
+  }
+  if (info) {
+    return print_info(path);
+  }
+
+  static NES nes;
+  RunResult result = {0};
+  result.error = nes_load(&nes, path);
+  if (result.error != ROM_OK) {
+    result.status = RUN_ERROR;
+  } else {
+    static Trace trace;
+    if (trace_path && trace_init(&trace, TRACE_DEFAULT_ENTRIES) == 0) {
+      nes.cpu.trace = &trace;
+    }
+    if (audio_path && !(config.audio = fopen(audio_path, "wb"))) {
+      fprintf(stderr, "%s: could not open.\n", audio_path);
+    }
+    result = runner_run(&nes, &config);
+    if (config.audio) {
+      fclose(config.audio);
+    }
+    if (nes.cpu.trace) {
+      if (trace_save(&trace, trace_path) != 0) {
+        fprintf(stderr, "%s: could not write trace.\n", trace_path);
+      }
+      trace_free(&trace);
+    }
+    nes_unload(&nes);
+  }
+  runner_print(stdout, path, &result);
+
+  switch (result.status) {
+  case RUN_PASS:
+    return 0;
+  case RUN_TIMEOUT:
+    return 2;
+  case RUN_JAM:
+    return 3;
+  case RUN_FAIL:
+    return 4;
+  case RUN_ERROR:
+    break;
+  }
+  return 1;
+}
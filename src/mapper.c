@@ -0,0 +1,298 @@
+#include "mapper.h"
+#include "bus.h"
+#include <string.h>
+
+// Maps a size sized PRG bank at page first. Boards with less PRG than the
+// window, like 16 KiB NROM, mirror it across.
+static void map_prg(Mapper *mapper, u8 first, u32 bank, u32 size) {
+  const Rom *rom = mapper->rom;
+  u32 mirror = size < rom->prg_size ? size : rom->prg_size;
+  bus_map_rom(mapper->bus, first, first + (size >> 8) - 1,
+              rom_prg_bank(rom, bank, size), mirror);
+}
+
+// Maps 1 KiB CHR bank into a pattern table window, from the cartridge's CHR
+// ROM or the PPU's own CHR RAM.
+static void map_chr(Mapper *mapper, u8 window, u32 bank) {
+  Rom *rom = mapper->rom;
+  PPU *ppu = mapper->ppu;
+  if (rom->chr) {
+    ppu_map_chr(ppu, window, rom_chr_bank(rom, bank, 0x400),
+                rom_chr_tiles(rom, bank, 0x400));
+  } else {
+    u32 offset = bank * 0x400 % sizeof(ppu->chr_ram);
+    ppu_map_chr(ppu, window, ppu->chr_ram + offset,
+                ppu->chr_ram_tiles + offset * 4);
+  }
+}
+
+static void map_chr_8k(Mapper *mapper, u32 bank) {
+  for (u8 i = 0; i < 8; i++) {
+    map_chr(mapper, i, bank * 8 + i);
+  }
+}
+
+// Four-screen boards bring their own nametable RAM and ignore the mapper.
+static void set_mirroring(Mapper *mapper, Mirroring mirroring) {
+  if (mapper->rom->mirroring != MIRROR_FOUR_SCREEN) {
+    ppu_set_mirroring(mapper->ppu, mirroring);
+  }
+}
+
+// Last 16 or 8 KiB bank of PRG.
+static u32 last_bank(const Mapper *mapper, u32 size) {
+  return mapper->rom->prg_size / size - 1;
+}
+
+// NROM (0): 16 or 32 KiB of PRG and 8 KiB of CHR, nothing to switch.
+
+static void nrom_write(Mapper *mapper, u16 addr, u8 val) {
+  (void)mapper;
+  (void)addr;
+  (void)val;
+}
+
+static void nrom_map(Mapper *mapper) {
+  map_prg(mapper, 0x80, 0, 0x8000);
+  map_chr_8k(mapper, 0);
+}
+
+// MMC1 (1): five writes of bit 0 load the register that the address of the
+// last one selects. A write with bit 7 set starts over.
+
+static void mmc1_map(Mapper *mapper) {
+  static const Mirroring MIRRORING[4] = {
+      MIRROR_SINGLE_LOWER,
+      MIRROR_SINGLE_UPPER,
+      MIRROR_VERTICAL,
+      MIRROR_HORIZONTAL,
+  };
+  const Mmc1 *mmc1 = &mapper->mmc1;
+  set_mirroring(mapper, MIRRORING[mmc1->control & 0x03]);
+
+  // SUROM's 512 KiB are two halves of 256, picked with bit 4 of $A000.
+  u32 outer = mapper->rom->prg_size > 0x40000 ? mmc1->chr[0] & 0x10 : 0;
+  u32 prg = outer | (mmc1->prg & 0x0F);
+  switch ((mmc1->control >> 2) & 0x03) {
+  case 0:
+  case 1: // 32 KiB, ignoring the low bit
+    map_prg(mapper, 0x80, prg >> 1, 0x8000);
+    break;
+  case 2: // First bank fixed at $8000
+    map_prg(mapper, 0x80, outer, 0x4000);
+    map_prg(mapper, 0xC0, prg, 0x4000);
+    break;
+  case 3: // Last bank fixed at $C000
+    map_prg(mapper, 0x80, prg, 0x4000);
+    map_prg(mapper, 0xC0, outer | 0x0F, 0x4000);
+    break;
+  }
+
+  if (mmc1->control & 0x10) {
+    for (u8 i = 0; i < 4; i++) {
+      map_chr(mapper, i, mmc1->chr[0] * 4 + i);
+      map_chr(mapper, i + 4, mmc1->chr[1] * 4 + i);
+    }
+  } else {
+    map_chr_8k(mapper, mmc1->chr[0] >> 1);
+  }
+}
+
+static void mmc1_write(Mapper *mapper, u16 addr, u8 val) {
+  Mmc1 *mmc1 = &mapper->mmc1;
+  if (val & 0x80) {
+    mmc1->shift = 0x10;
+    mmc1->control |= 0x0C;
+    mmc1_map(mapper);
+    return;
+  }
+  u8 full = mmc1->shift & 1;
+  mmc1->shift = (mmc1->shift >> 1) | ((val & 1) << 4);
+  if (!full) {
+    return;
+  }
+  u8 reg = mmc1->shift;
+  mmc1->shift = 0x10;
+  switch (addr & 0x6000) {
+  case 0x0000:
+    mmc1->control = reg;
+    break;
+  case 0x2000:
+    mmc1->chr[0] = reg;
+    break;
+  case 0x4000:
+    mmc1->chr[1] = reg;
+    break;
+  case 0x6000:
+    mmc1->prg = reg;
+    break;
+  }
+  mmc1_map(mapper);
+}
+
+// UxROM (2): a switchable 16 KiB bank at $8000, the last one at $C000.
+
+static void uxrom_map(Mapper *mapper) {
+  map_prg(mapper, 0x80, mapper->bank, 0x4000);
+  map_prg(mapper, 0xC0, last_bank(mapper, 0x4000), 0x4000);
+  map_chr_8k(mapper, 0);
+}
+
+// CNROM (3): fixed PRG and a switchable 8 KiB of CHR.
+
+static void cnrom_map(Mapper *mapper) {
+  map_prg(mapper, 0x80, 0, 0x8000);
+  map_chr_8k(mapper, mapper->bank);
+}
+
+// Both latch the whole byte written anywhere in $8000-$FFFF.
+static void bank_write(Mapper *mapper, u16 addr, u8 val) {
+  (void)addr;
+  mapper->bank = val;
+  mapper->map(mapper);
+}
+
+// MMC3 (4): two switchable 8 KiB PRG banks with the second to last one
+// either at $8000 or $C000, and CHR in two 2 KiB and four 1 KiB banks whose
+// halves of the pattern tables can be swapped.
+
+static void mmc3_map(Mapper *mapper) {
+  const Mmc3 *mmc3 = &mapper->mmc3;
+  set_mirroring(mapper,
+                mmc3->mirroring & 1 ? MIRROR_HORIZONTAL : MIRROR_VERTICAL);
+
+  u32 second_last = last_bank(mapper, 0x2000) - 1;
+  u8 swap = mmc3->select & 0x40;
+  map_prg(mapper, 0x80, swap ? second_last : mmc3->bank[6], 0x2000);
+  map_prg(mapper, 0xA0, mmc3->bank[7], 0x2000);
+  map_prg(mapper, 0xC0, swap ? mmc3->bank[6] : second_last, 0x2000);
+  map_prg(mapper, 0xE0, second_last + 1, 0x2000);
+
+  u8 invert = mmc3->select & 0x80 ? 4 : 0;
+  for (u8 i = 0; i < 4; i++) {
+    map_chr(mapper, i ^ invert, (mmc3->bank[i >> 1] & 0xFE) | (i & 1));
+    map_chr(mapper, (i + 4) ^ invert, mmc3->bank[i + 2]);
+  }
+}
+
+// One rise of A12. This is the later MMC3 revision, which raises the IRQ
+// whenever the counter ends up at 0, reloaded with 0 or not.
+static void mmc3_clock(Mapper *mapper) {
+  Mmc3 *mmc3 = &mapper->mmc3;
+  if (mmc3->irq_counter == 0 || mmc3->irq_reload) {
+    mmc3->irq_counter = mmc3->irq_latch;
+    mmc3->irq_reload = 0;
+  } else {
+    mmc3->irq_counter--;
+  }
+  if (mmc3->irq_counter == 0 && mmc3->irq_enabled) {
+    mapper->irq = 1;
+  }
+}
+
+static void mmc3_write(Mapper *mapper, u16 addr, u8 val) {
+  Mmc3 *mmc3 = &mapper->mmc3;
+  mapper_sync(mapper);
+  switch (addr & 0xE001) {
+  case 0x8000:
+    mmc3->select = val;
+    break;
+  case 0x8001:
+    mmc3->bank[mmc3->select & 0x07] = val;
+    break;
+  case 0xA000:
+    mmc3->mirroring = val;
+    break;
+  case 0xC000:
+    mmc3->irq_latch = val;
+    return;
+  case 0xC001:
+    mmc3->irq_counter = 0;
+    mmc3->irq_reload = 1;
+    return;
+  case 0xE000:
+    mmc3->irq_enabled = 0;
+    mapper->irq = 0;
+    return;
+  case 0xE001:
+    mmc3->irq_enabled = 1;
+    return;
+  default:
+    // $A001 protects PRG RAM, which boards are assumed to leave writable.
+    return;
+  }
+  mmc3_map(mapper);
+}
+
+int mapper_init(Mapper *mapper, Rom *rom, Bus *bus, PPU *ppu) {
+  memset(mapper, 0, sizeof(*mapper));
+  mapper->bus = bus;
+  mapper->ppu = ppu;
+  mapper->rom = rom;
+  switch (rom->mapper) {
+  case MAPPER_NROM:
+    mapper->write = nrom_write;
+    mapper->map = nrom_map;
+    break;
+  case MAPPER_MMC1:
+    mapper->mmc1.shift = 0x10;
+    // Last bank fixed, so the vectors are there, and the header's mirroring
+    // until the game sets its own.
+    mapper->mmc1.control =
+        0x0C | (rom->mirroring == MIRROR_HORIZONTAL ? 0x03 : 0x02);
+    mapper->write = mmc1_write;
+    mapper->map = mmc1_map;
+    break;
+  case MAPPER_UXROM:
+    mapper->write = bank_write;
+    mapper->map = uxrom_map;
+    break;
+  case MAPPER_CNROM:
+    mapper->write = bank_write;
+    mapper->map = cnrom_map;
+    break;
+  case MAPPER_MMC3: {
+    static const u8 BANKS[8] = {0, 2, 4, 5, 6, 7, 0, 1};
+    memcpy(mapper->mmc3.bank, BANKS, sizeof(BANKS));
+    mapper->mmc3.mirroring = rom->mirroring == MIRROR_HORIZONTAL;
+    mapper->mmc3.a12_seen = ppu->a12_rises;
+    mapper->write = mmc3_write;
+    mapper->map = mmc3_map;
+    break;
+  }
+  default:
+    return -1;
+  }
+  mapper->map(mapper);
+  return 0;
+}
+
+void mapper_write(Mapper *mapper, u16 addr, u8 val) {
+  mapper->write(mapper, addr, val);
+}
+
+void mapper_map(Mapper *mapper) { mapper->map(mapper); }
+
+void mapper_sync(Mapper *mapper) {
+  if (mapper->rom->mapper != MAPPER_MMC3) {
+    return;
+  }
+  Mmc3 *mmc3 = &mapper->mmc3;
+  for (; mmc3->a12_seen != mapper->ppu->a12_rises; mmc3->a12_seen++) {
+    mmc3_clock(mapper);
+  }
+}
+
+u64 mapper_dots_to_irq(const Mapper *mapper) {
+  const Mmc3 *mmc3 = &mapper->mmc3;
+  if (mapper->rom->mapper != MAPPER_MMC3 || !mmc3->irq_enabled ||
+      mapper->irq) {
+    return UINT64_MAX;
+  }
+  // The clock that takes the counter to 0: after a reload, the one after
+  // it counts the latch down.
+  u32 clocks = mmc3->irq_counter == 0 || mmc3->irq_reload
+                   ? mmc3->irq_latch + 1u
+                   : mmc3->irq_counter;
+  return ppu_dots_to_a12_rises(mapper->ppu, clocks);
+}
@@ -0,0 +1,283 @@
+#include "nes.h"
+#include "bus.h"
+#include "emu.h"
+#include "opcode.h"
+#include <string.h>
+
+// The CPU runs freely and everything else is caught up lazily: on a register
+// access, or at the next event on the scheduler. Nothing is ticked per
+// instruction.
+
+// The DMC halts the CPU for each fetch it made since the last look.
+static void take_dmc_stall(NES *nes) {
+  nes->cpu.cycles += nes->apu.dmc_stall;
+  nes->apu.dmc_stall = 0;
+}
+
+static void run_apu(NES *nes, u64 cycle) {
+  apu_run_to(&nes->apu, cycle);
+  take_dmc_stall(nes);
+}
+
+void nes_sync(NES *nes) {
+  ppu_run_to(&nes->ppu, nes->cpu.cycles * 3);
+  run_apu(nes, nes->cpu.cycles);
+}
+
+// Handlers run before the dispatcher counts the instruction's cycles, so the
+// access lands base cycles - 1 after cpu->cycles: loads and stores touch their
+// operand on their last cycle, read-modify-writes write it on their last two.
+// Page-crossing penalties are already counted by then.
+static u64 access_cycle(const CPU *cpu) {
+  const u8 *mem = cpu->bus.read[cpu->PC >> 8];
+  if (!mem) {
+    return cpu->cycles; // Running from I/O, don't recurse into it
+  }
+  return cpu->cycles + INSTRUCTION_TABLE[mem[cpu->PC & 0xFF]].cycles - 1;
+}
+
+static void catch_up(NES *nes) {
+  ppu_run_to(&nes->ppu, access_cycle(&nes->cpu) * 3);
+}
+
+// Anything the CPU only observes by reading a register, like sprite 0 hits,
+// is caught up on that read instead of being scheduled.
+static void schedule_vblank(NES *nes) {
+  const PPU *ppu = &nes->ppu;
+  if (!(ppu->ctrl & PPU_CTRL_NMI)) {
+    sched_cancel(&nes->sched, EVENT_VBLANK);
+    return;
+  }
+  // The cycle whose dots include the one that raises vblank. The PPU may be
+  // a little ahead of the CPU after an access late in an instruction.
+  u64 cycle = (ppu->dots + ppu_dots_to_vblank(ppu)) / 3 + 1;
+  sched_set(&nes->sched, EVENT_VBLANK, cycle);
+}
+
+// The mapper's IRQ is predicted from the PPU's fetch pattern and checked when
+// it's due, rather than watched for on every dot. A prediction holds until the
+// counter is written or the PPU changes the tables it fetches from, the
+// sprite size or whether it renders.
+static void schedule_mapper_irq(NES *nes) {
+  u64 dots = mapper_dots_to_irq(&nes->mapper);
+  if (dots == UINT64_MAX) {
+    sched_cancel(&nes->sched, EVENT_MAPPER_IRQ);
+    return;
+  }
+  u64 cycle = (nes->ppu.dots + dots) / 3 + 1;
+  sched_set(&nes->sched, EVENT_MAPPER_IRQ, cycle);
+  if (cycle < nes->cpu.deadline) {
+    stop_run(&nes->cpu);
+  }
+}
+
+// Follows the mapper's and the APU's IRQ outputs onto the CPU's line. A
+// newly raised one ends the run, so it can be taken.
+static void update_irq(NES *nes) {
+  CPU *cpu = &nes->cpu;
+  u8 irq = 0;
+  if (nes->mapper.irq) {
+    irq |= IRQ_MAPPER;
+  }
+  if (nes->apu.status & (APU_STATUS_FRAME_IRQ | APU_STATUS_DMC_IRQ)) {
+    irq |= IRQ_APU;
+  }
+  if (irq & ~cpu->irq) {
+    stop_run(cpu);
+  }
+  cpu->irq = irq;
+}
+
+// Schedules the event to run the APU past cycle, where it changes something
+// the CPU sees.
+static void schedule_apu_event(NES *nes, u8 event, u64 cycle) {
+  if (cycle == UINT64_MAX) {
+    sched_cancel(&nes->sched, event);
+    return;
+  }
+  sched_set(&nes->sched, event, cycle + 1);
+  if (cycle + 1 < nes->cpu.deadline) {
+    stop_run(&nes->cpu);
+  }
+}
+
+// After the APU was run or written: the frame and DMC interrupts onto the
+// line, and when they and the next DMC fetch are due. Like the mapper's, they
+// are only looked at then, never per cycle.
+static void sync_apu(NES *nes) {
+  take_dmc_stall(nes); // Enabling the DMC fetches straight away
+  update_irq(nes);
+  schedule_apu_event(nes, EVENT_FRAME_IRQ, apu_next_frame_irq(&nes->apu));
+  schedule_apu_event(nes, EVENT_DMC_FETCH, apu_next_dmc_fetch(&nes->apu));
+}
+
+static void sync_mapper(NES *nes) {
+  mapper_sync(&nes->mapper);
+  update_irq(nes);
+  schedule_mapper_irq(nes);
+}
+
+static u8 ppu_port_read(void *ctx, u16 addr) {
+  NES *nes = ctx;
+  catch_up(nes);
+  u8 val = ppu_read_register(&nes->ppu, addr);
+  if (nes->ppu.nmi) {
+    stop_run(&nes->cpu);
+  }
+  return val;
+}
+
+static void ppu_port_write(void *ctx, u16 addr, u8 val) {
+  NES *nes = ctx;
+  u8 ctrl = nes->ppu.ctrl;
+  u8 mask = nes->ppu.mask;
+  catch_up(nes);
+  ppu_write_register(&nes->ppu, addr, val);
+  if ((ctrl ^ nes->ppu.ctrl) & (PPU_CTRL_SPRITE_TABLE |
+                                PPU_CTRL_BACKGROUND_TABLE |
+                                PPU_CTRL_SPRITE_SIZE) ||
+      (mask ^ nes->ppu.mask) & (PPU_MASK_BACKGROUND | PPU_MASK_SPRITES)) {
+    sync_mapper(nes);
+  }
+  // Turning NMIs on or off changes when the run has to stop.
+  if ((ctrl ^ nes->ppu.ctrl) & PPU_CTRL_NMI) {
+    schedule_vblank(nes);
+    stop_run(&nes->cpu);
+  }
+  if (nes->ppu.nmi) {
+    stop_run(&nes->cpu);
+  }
+}
+
+static u8 io_read(void *ctx, u16 addr) {
+  NES *nes = ctx;
+  if (addr == 0x4015) {
+    run_apu(nes, access_cycle(&nes->cpu));
+    u8 val = apu_read_status(&nes->apu);
+    sync_apu(nes);
+    return val;
+  }
+  return addr >> 8;
+}
+
+static void io_write(void *ctx, u16 addr, u8 val) {
+  NES *nes = ctx;
+  if (addr <= 0x4013 || addr == 0x4015 || addr == 0x4017) {
+    run_apu(nes, access_cycle(&nes->cpu));
+    apu_write(&nes->apu, addr, val);
+    sync_apu(nes);
+  } else if (addr == 0x4014) {
+    // OAM DMA: the CPU stalls for 513 cycles after the write, 514 if the
+    // write was on an odd one. OAM is copied in one go, then the PPU is
+    // brought to where the CPU resumes.
+    u64 write = access_cycle(&nes->cpu);
+    catch_up(nes);
+    for (u32 i = 0; i < 256; i++) {
+      u8 byte = read_byte(&nes->cpu, (val << 8) | i);
+      ppu_write_register(&nes->ppu, 0x2004, byte);
+    }
+    u32 stall = 513 + (write & 1);
+    nes->cpu.cycles += stall;
+    ppu_run_to(&nes->ppu, (write + 1 + stall) * 3);
+    if (nes->ppu.nmi) {
+      stop_run(&nes->cpu);
+    }
+  }
+}
+
+// Reads of $8000-$FFFF never get here: the mapper keeps ROM mapped there.
+static void cartridge_write(void *ctx, u16 addr, u8 val) {
+  NES *nes = ctx;
+  catch_up(nes);
+  mapper_write(&nes->mapper, addr, val);
+  if (addr >= 0xC000) {
+    sync_mapper(nes); // Where MMC3 keeps its IRQ registers
+  }
+}
+
+RomError nes_load(NES *nes, const char *path) {
+  RomError err = rom_load(&nes->rom, path);
+  if (err != ROM_OK) {
+    return err;
+  }
+
+  power_on(&nes->cpu);
+  ppu_power_on(&nes->ppu, &nes->rom);
+  // The mapper's banks go under the register writes.
+  bus_map_io(&nes->cpu.bus, 0x80, 0xFF, NULL, cartridge_write, nes);
+  if (mapper_init(&nes->mapper, &nes->rom, &nes->cpu.bus, &nes->ppu) != 0) {
+    err = ROM_ERR_MAPPER;
+  } else if (apu_power_on(&nes->apu, &nes->cpu.bus, APU_SAMPLE_RATE) != 0) {
+    err = ROM_ERR_MEMORY;
+  }
+  if (err != ROM_OK) {
+    // Leave nothing mapped onto the ROM that is about to go.
+    bus_map_io(&nes->cpu.bus, 0x80, 0xFF, NULL, NULL, NULL);
+    memset(&nes->mapper, 0, sizeof(nes->mapper));
+    rom_unload(&nes->rom);
+    return err;
+  }
+  sched_init(&nes->sched);
+  sync_apu(nes); // The frame interrupt is enabled from power on
+  bus_map_io(&nes->cpu.bus, 0x20, 0x3F, ppu_port_read, ppu_port_write, nes);
+  bus_map_io(&nes->cpu.bus, 0x40, 0x40, io_read, io_write, nes);
+  memset(nes->prg_ram, 0, sizeof(nes->prg_ram));
+  bus_map(&nes->cpu.bus, 0x60, 0x7F, nes->prg_ram, sizeof(nes->prg_ram), 1);
+  reset(&nes->cpu);
+  return ROM_OK;
+}
+
+void nes_unload(NES *nes) {
+  apu_free(&nes->apu);
+  rom_unload(&nes->rom);
+}
+
+void nes_reset(NES *nes) {
+  nes_sync(nes);
+  ppu_reset(&nes->ppu);
+  apu_reset(&nes->apu);
+  // Can't fail, the board was accepted by nes_load.
+  mapper_init(&nes->mapper, &nes->rom, &nes->cpu.bus, &nes->ppu);
+  reset(&nes->cpu);
+  sched_init(&nes->sched);
+  schedule_vblank(nes);
+  schedule_mapper_irq(nes);
+  sync_apu(nes);
+}
+
+static void handle_event(NES *nes, u8 event) {
+  switch (event) {
+  case EVENT_VBLANK:
+    // The PPU has been caught up past it and raised the NMI by now.
+    schedule_vblank(nes);
+    break;
+  case EVENT_MAPPER_IRQ:
+    sync_mapper(nes);
+    break;
+  case EVENT_FRAME_IRQ:
+  case EVENT_DMC_FETCH:
+    // nes_sync has run the APU past it and stalled the CPU for the fetch.
+    sync_apu(nes);
+    break;
+  }
+}
+
+void nes_run_until(NES *nes, u64 cycles) {
+  CPU *cpu = &nes->cpu;
+  while (!cpu->halted && cpu->cycles < cycles) {
+    nes_sync(nes);
+    u8 event;
+    while ((event = sched_pop(&nes->sched, cpu->cycles)) != SCHED_IDLE) {
+      handle_event(nes, event);
+    }
+    if (nes->ppu.nmi) {
+      nes->ppu.nmi = 0;
+      nmi(cpu);
+    } else if (cpu->irq && !(cpu->P & FLAG_INTERRUPT_DISABLE)) {
+      irq(cpu);
+    }
+    u64 next = sched_next(&nes->sched);
+    run_until(cpu, next < cycles ? next : cycles);
+  }
+  nes_sync(nes);
+}
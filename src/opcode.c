@@ -1,10 +1,44 @@
 #include "opcode.h"
+#include "block.h"
 
-u8 read_byte(CPU *cpu, u16 addr) { return cpu->mem[addr]; }
+u8 read_byte(CPU *cpu, u16 addr) {
+  u8 page = addr >> 8;
+  u8 *mem = cpu->bus.read[page];
+  if (mem) {
+    return mem[addr & 0xFF];
+  }
+  return cpu->bus.read_handler[page](cpu->bus.ctx[page], addr);
+}
+
+void write_byte(CPU *cpu, u16 addr, u8 val) {
+  u8 page = addr >> 8;
+  cpu->bus.dirty[page >> 6] |= 1ull << (page & 63);
+  u8 *mem = cpu->bus.write[page];
+  if (mem) {
+    mem[addr & 0xFF] = val;
+    if (cpu->bus.code[page]) {
+      block_invalidate_page(cpu, page);
+    }
+    return;
+  }
+  cpu->bus.write_handler[page](cpu->bus.ctx[page], addr, val);
+}
 
-void write_byte(CPU *cpu, u16 addr, u8 val) { cpu->mem[addr] = val; }
+// The byte or word after the opcode. The block cache decodes them ahead and
+// hands them over in cpu->operand, see block.h; everywhere else they are
+// fetched through the bus. For zero page and absolute modes the word is also
+// the effective address.
+static u8 operand_byte(CPU *cpu) {
+  if (cpu->operand) {
+    return (u8)cpu->operand;
+  }
+  return read_byte(cpu, cpu->PC + 1);
+}
 
 u16 absolute_addr(CPU *cpu) {
+  if (cpu->operand) {
+    return (u16)cpu->operand;
+  }
   u8 lb = read_byte(cpu, cpu->PC + 1);
   u8 rb = read_byte(cpu, cpu->PC + 2);
   return (rb << 8) | lb;
@@ -16,23 +50,33 @@ u16 absolute_addr_at(CPU *cpu, u16 at) {
   return (rb << 8) | lb;
 }
 
+u16 zeropage_addr(CPU *cpu) { return operand_byte(cpu); }
+
+u16 zeropage_offset_addr(CPU *cpu, u8 offset) {
+  return (u8)(operand_byte(cpu) + offset);
+}
+
+u16 absolute_offset_addr(CPU *cpu, u8 offset) {
+  return absolute_addr(cpu) + offset;
+}
+
 u8 zeropage_read(CPU *cpu) {
-  u8 addr = read_byte(cpu, (u16)cpu->PC + 1);
+  u8 addr = operand_byte(cpu);
   return read_byte(cpu, (u16)addr);
 }
 
 void zeropage_write(CPU *cpu, u8 val) {
-  u8 addr = read_byte(cpu, (u16)cpu->PC + 1);
+  u8 addr = operand_byte(cpu);
   write_byte(cpu, (u16)addr, val);
 }
 
 u8 zeropage_offset_read(CPU *cpu, u8 offset) {
-  u8 addr = read_byte(cpu, (u16)cpu->PC + 1) + offset;
+  u8 addr = operand_byte(cpu) + offset;
   return read_byte(cpu, (u16)addr);
 }
 
 void zeropage_offset_write(CPU *cpu, u8 offset, u8 val) {
-  u8 addr = read_byte(cpu, (u16)cpu->PC + 1) + offset;
+  u8 addr = operand_byte(cpu) + offset;
   write_byte(cpu, (u16)addr, val);
 }
 
@@ -46,8 +90,15 @@ void absolute_write(CPU *cpu, u8 val) {
   write_byte(cpu, addr, val);
 }
 
+// Indexed reads cost an extra cycle when the index carries into the high byte.
+static void page_cross_penalty(CPU *cpu, u16 base, u16 addr) {
+  cpu->cycles += (base ^ addr) > 0xFF;
+}
+
 u8 absolute_offset_read(CPU *cpu, u8 offset) {
-  u16 addr = absolute_addr(cpu) + offset;
+  u16 base = absolute_addr(cpu);
+  u16 addr = base + offset;
+  page_cross_penalty(cpu, base, addr);
   return read_byte(cpu, addr);
 }
 
@@ -56,31 +107,51 @@ void absolute_offset_write(CPU *cpu, u8 offset, u8 val) {
   write_byte(cpu, addr, val);
 }
 
+// Pointers in the zero page wrap within it, so ($FF) takes its high byte
+// from $00.
+static u16 zeropage_pointer(CPU *cpu, u8 at) {
+  u8 lb = read_byte(cpu, at);
+  u8 rb = read_byte(cpu, (u8)(at + 1));
+  return (rb << 8) | lb;
+}
+
 u8 indexed_indirect_read_x(CPU *cpu) {
-  u8 id_addr = read_byte(cpu, cpu->PC + 1) + cpu->X;
-  u16 addr = absolute_addr_at(cpu, id_addr);
+  u8 id_addr = operand_byte(cpu) + cpu->X;
+  u16 addr = zeropage_pointer(cpu, id_addr);
   return read_byte(cpu, addr);
 }
 
 void indexed_indirect_write_x(CPU *cpu, u8 val) {
-  u8 id_addr = read_byte(cpu, cpu->PC + 1) + cpu->X;
-  u16 addr = absolute_addr_at(cpu, id_addr);
+  u8 id_addr = operand_byte(cpu) + cpu->X;
+  u16 addr = zeropage_pointer(cpu, id_addr);
   write_byte(cpu, addr, val);
 }
 
 u8 indirect_indexed_read_y(CPU *cpu) {
-  u8 id_addr = read_byte(cpu, cpu->PC + 1);
-  u16 addr = absolute_addr_at(cpu, id_addr) + cpu->Y;
+  u8 id_addr = operand_byte(cpu);
+  u16 base = zeropage_pointer(cpu, id_addr);
+  u16 addr = base + cpu->Y;
+  page_cross_penalty(cpu, base, addr);
   return read_byte(cpu, addr);
 }
 
 void indirect_indexed_write_y(CPU *cpu, u8 val) {
-  u8 id_addr = read_byte(cpu, cpu->PC + 1);
-  u16 addr = absolute_addr_at(cpu, id_addr) + cpu->Y;
+  u8 id_addr = operand_byte(cpu);
+  u16 addr = zeropage_pointer(cpu, id_addr) + cpu->Y;
   write_byte(cpu, addr, val);
 }
 
 void set_flag(CPU *cpu, Flag flag, u8 val) {
+#ifdef LAZY_FLAGS
+  if (flag == FLAG_ZERO) {
+    cpu->z_result = !val;
+    return;
+  }
+  if (flag == FLAG_NEGATIVE) {
+    cpu->n_result = val ? 0x80 : 0;
+    return;
+  }
+#endif
   if (val) {
     cpu->P |= flag;
     return;
@@ -88,17 +159,57 @@ void set_flag(CPU *cpu, Flag flag, u8 val) {
   cpu->P &= ~flag;
 }
 
-u8 get_flag(CPU *cpu, Flag flag) { return cpu->P & flag; }
+u8 get_flag(CPU *cpu, Flag flag) {
+#ifdef LAZY_FLAGS
+  if (flag == FLAG_ZERO) {
+    return cpu->z_result ? 0 : FLAG_ZERO;
+  }
+  if (flag == FLAG_NEGATIVE) {
+    return cpu->n_result & FLAG_NEGATIVE;
+  }
+#endif
+  return cpu->P & flag;
+}
 
-void nop(CPU *cpu) {} // NOP
+// With LAZY_FLAGS, loads and ALU ops only record their result and N/Z are
+// derived from it when someone actually looks at them.
+void set_nz(CPU *cpu, u8 value) {
+#ifdef LAZY_FLAGS
+  cpu->n_result = value;
+  cpu->z_result = value;
+#else
+  cpu->P = (cpu->P & ~(FLAG_NEGATIVE | FLAG_ZERO)) | (value & FLAG_NEGATIVE) |
+           (value ? 0 : FLAG_ZERO);
+#endif
+}
+
+u8 get_status(CPU *cpu) {
+#ifdef LAZY_FLAGS
+  return (cpu->P & ~(FLAG_NEGATIVE | FLAG_ZERO)) |
+         (cpu->n_result & FLAG_NEGATIVE) | (cpu->z_result ? 0 : FLAG_ZERO);
+#else
+  return cpu->P;
+#endif
+}
+
+void set_status(CPU *cpu, u8 val) {
+  cpu->P = val;
+#ifdef LAZY_FLAGS
+  cpu->n_result = val;
+  cpu->z_result = !(val & FLAG_ZERO);
+#endif
+}
+
+void nop(CPU *cpu) { (void)cpu; } // NOP
+
+void jam(CPU *cpu) { cpu->halted = 1; } // Unofficial opcodes
 
 static void lda_common(CPU *cpu, u8 value) {
   cpu->A = value;
-  set_flag(cpu, FLAG_NEGATIVE, value & 0x80);
-  set_flag(cpu, FLAG_ZERO, value == 0);
+  set_nz(cpu, value);
 }
 void lda_immediate(CPU *cpu) {
-  u8 value = read_byte(cpu, (u16)cpu->PC + 1);
+  u8 value = operand_byte(cpu);
   lda_common(cpu, value);
 } // LDA #$nn
 void lda_zeropage(CPU *cpu) { lda_common(cpu, zeropage_read(cpu)); } // LDA $nn
@@ -123,11 +234,10 @@ void lda_indirect_y(CPU *cpu) {
 
 static void ldx_common(CPU *cpu, u8 value) {
   cpu->X = value;
-  set_flag(cpu, FLAG_NEGATIVE, value & 0x80);
-  set_flag(cpu, FLAG_ZERO, value == 0);
+  set_nz(cpu, value);
 }
 void ldx_immediate(CPU *cpu) {
-  u8 value = read_byte(cpu, (u16)cpu->PC + 1);
+  u8 value = operand_byte(cpu);
   ldx_common(cpu, value);
 } // LDX #$nn
 void ldx_zeropage(CPU *cpu) { ldx_common(cpu, zeropage_read(cpu)); } // LDX $nn
@@ -143,11 +253,10 @@ void ldx_absolute_y(CPU *cpu) {
 
 static void ldy_common(CPU *cpu, u8 value) {
   cpu->Y = value;
-  set_flag(cpu, FLAG_NEGATIVE, value & 0x80);
-  set_flag(cpu, FLAG_ZERO, value == 0);
+  set_nz(cpu, value);
 }
 void ldy_immediate(CPU *cpu) {
-  u8 value = read_byte(cpu, (u16)cpu->PC + 1);
+  u8 value = operand_byte(cpu);
   ldy_common(cpu, value);
 } // LDY #$nn
 void ldy_zeropage(CPU *cpu) { ldy_common(cpu, zeropage_read(cpu)); } // LDY $nn
@@ -193,64 +302,73 @@ void sty_absolute(CPU *cpu) { absolute_write(cpu, cpu->Y); } // STY $nnnn
 
 void tax(CPU *cpu) {
   cpu->X = cpu->A;
-  set_flag(cpu, FLAG_NEGATIVE, cpu->A & 0x80);
-  set_flag(cpu, FLAG_ZERO, cpu->A == 0);
+  set_nz(cpu, cpu->A);
 } // TAX
 void tay(CPU *cpu) {
   cpu->Y = cpu->A;
-  set_flag(cpu, FLAG_NEGATIVE, cpu->A & 0x80);
-  set_flag(cpu, FLAG_ZERO, cpu->A == 0);
+  set_nz(cpu, cpu->A);
 } // TAY
 void txa(CPU *cpu) {
   cpu->A = cpu->X;
-  set_flag(cpu, FLAG_NEGATIVE, cpu->X & 0x80);
-  set_flag(cpu, FLAG_ZERO, cpu->X == 0);
+  set_nz(cpu, cpu->X);
 } // TXA
 void tya(CPU *cpu) {
   cpu->A = cpu->Y;
-  set_flag(cpu, FLAG_NEGATIVE, cpu->Y & 0x80);
-  set_flag(cpu, FLAG_ZERO, cpu->Y == 0);
+  set_nz(cpu, cpu->Y);
 } // TYA
+void tsx(CPU *cpu) {
+  cpu->X = cpu->S;
+  set_nz(cpu, cpu->S);
+} // TSX
+void txs(CPU *cpu) { cpu->S = cpu->X; } // TXS
+
+// Taken branches cost one cycle, plus one more if the target is on a
+// different page than the next instruction.
+static void branch(CPU *cpu) {
+  u16 next = cpu->PC + 2;
+  cpu->PC += (s8)operand_byte(cpu);
+  cpu->cycles += 1 + (((u16)(cpu->PC + 2) ^ next) > 0xFF);
+}
 
 void bcc(CPU *cpu) {
   if (get_flag(cpu, FLAG_CARRY))
     return;
-  cpu->PC += (s8)read_byte(cpu, cpu->PC + 1);
+  branch(cpu);
 } // BCC $nn
 void bcs(CPU *cpu) {
   if (!get_flag(cpu, FLAG_CARRY))
     return;
-  cpu->PC += (s8)read_byte(cpu, cpu->PC + 1);
+  branch(cpu);
 } // BCS $nn
 void beq(CPU *cpu) {
   if (!get_flag(cpu, FLAG_ZERO))
     return;
-  cpu->PC += (s8)read_byte(cpu, cpu->PC + 1);
+  branch(cpu);
 } // BEQ $nn
 void bmi(CPU *cpu) {
   if (!get_flag(cpu, FLAG_NEGATIVE))
     return;
-  cpu->PC += (s8)read_byte(cpu, cpu->PC + 1);
+  branch(cpu);
 } // BMI $nn
 void bne(CPU *cpu) {
   if (get_flag(cpu, FLAG_ZERO))
     return;
-  cpu->PC += (s8)read_byte(cpu, cpu->PC + 1);
+  branch(cpu);
 } // BNE $nn
 void bpl(CPU *cpu) {
   if (get_flag(cpu, FLAG_NEGATIVE))
     return;
-  cpu->PC += (s8)read_byte(cpu, cpu->PC + 1);
+  branch(cpu);
 } // BPL $nn
 void bvc(CPU *cpu) {
   if (get_flag(cpu, FLAG_OVERFLOW))
     return;
-  cpu->PC += (s8)read_byte(cpu, cpu->PC + 1);
+  branch(cpu);
 } // BVC $nn
 void bvs(CPU *cpu) {
   if (!get_flag(cpu, FLAG_OVERFLOW))
     return;
-  cpu->PC += (s8)read_byte(cpu, cpu->PC + 1);
+  branch(cpu);
 } // BVS $nn
 
 void push_stack(CPU *cpu, u8 val) {
@@ -266,18 +384,50 @@ void pop_stack(CPU *cpu, u8 *to) {
   *to = value;
 }
 
+static void push_word(CPU *cpu, u16 val) {
+  push_stack(cpu, val >> 8);
+  push_stack(cpu, val & 0xFF);
+}
+
+static u16 pop_word(CPU *cpu) {
+  u8 lb, rb;
+  pop_stack(cpu, &lb);
+  pop_stack(cpu, &rb);
+  return (rb << 8) | lb;
+}
+
+// Clearing I while the IRQ line is held ends the run, so whoever runs the CPU
+// gets to take the interrupt.
+static void unmask_irq(CPU *cpu) {
+  if (cpu->irq && !(cpu->P & FLAG_INTERRUPT_DISABLE)) {
+    stop_run(cpu);
+  }
+}
+
+// Bit 5 is always set and B only exists in the copy of P pushed to the stack.
+static void pull_status(CPU *cpu) {
+  u8 value;
+  pop_stack(cpu, &value);
+  set_status(cpu, (value & ~FLAG_BREAK) | 0x20);
+  unmask_irq(cpu);
+}
+
 void pha(CPU *cpu) { push_stack(cpu, cpu->A); } // PHA
-void php(CPU *cpu) { push_stack(cpu, cpu->P); } // PHP
-void pla(CPU *cpu) { pop_stack(cpu, &cpu->A); } // PLA
-void plp(CPU *cpu) { pop_stack(cpu, &cpu->P); } // PLP
+void php(CPU *cpu) {
+  push_stack(cpu, get_status(cpu) | FLAG_BREAK | 0x20);
+} // PHP
+void pla(CPU *cpu) {
+  pop_stack(cpu, &cpu->A);
+  set_nz(cpu, cpu->A);
+} // PLA
+void plp(CPU *cpu) { pull_status(cpu); } // PLP
 
 static void and_common(CPU *cpu, u8 value) {
   cpu->A &= value;
-  set_flag(cpu, FLAG_NEGATIVE, cpu->A & 0x80);
-  set_flag(cpu, FLAG_ZERO, cpu->A == 0);
+  set_nz(cpu, cpu->A);
 }
 void and_immediate(CPU *cpu) {
-  and_common(cpu, read_byte(cpu, cpu->PC + 1));
+  and_common(cpu, operand_byte(cpu));
 } // AND #$nn
 void and_zeropage(CPU *cpu) { and_common(cpu, zeropage_read(cpu)); } // AND $nn
 void and_zeropage_x(CPU *cpu) {
@@ -301,11 +451,10 @@ void and_indirect_y(CPU *cpu) {
 
 static void ora_common(CPU *cpu, u8 value) {
   cpu->A |= value;
-  set_flag(cpu, FLAG_NEGATIVE, cpu->A & 0x80);
-  set_flag(cpu, FLAG_ZERO, cpu->A == 0);
+  set_nz(cpu, cpu->A);
 }
 void ora_immediate(CPU *cpu) {
-  ora_common(cpu, read_byte(cpu, cpu->PC + 1));
+  ora_common(cpu, operand_byte(cpu));
 } // ORA #$nn
 void ora_zeropage(CPU *cpu) { ora_common(cpu, zeropage_read(cpu)); } // ORA $nn
 void ora_zeropage_x(CPU *cpu) {
@@ -329,11 +478,10 @@ void ora_indirect_y(CPU *cpu) {
 
 static void eor_common(CPU *cpu, u8 value) {
   cpu->A ^= value;
-  set_flag(cpu, FLAG_NEGATIVE, cpu->A & 0x80);
-  set_flag(cpu, FLAG_ZERO, cpu->A == 0);
+  set_nz(cpu, cpu->A);
 }
 void eor_immediate(CPU *cpu) {
-  eor_common(cpu, read_byte(cpu, cpu->PC + 1));
+  eor_common(cpu, operand_byte(cpu));
 } // EOR #$nn
 void eor_zeropage(CPU *cpu) { eor_common(cpu, zeropage_read(cpu)); } // EOR $nn
 void eor_zeropage_x(CPU *cpu) {
@@ -373,13 +521,12 @@ void bit_absolute(CPU *cpu) {
 static void adc_common(CPU *cpu, u8 add) {
   u16 result = (u16)cpu->A + (u16)add + (u16)(cpu->P & FLAG_CARRY);
   set_flag(cpu, FLAG_CARRY, result > 0x00FF);
-  set_flag(cpu, FLAG_ZERO, !result);
   set_flag(cpu, FLAG_OVERFLOW, (result ^ cpu->A) & (result ^ add) & 0x0080);
-  set_flag(cpu, FLAG_NEGATIVE, result & 0x0080);
+  set_nz(cpu, result);
   cpu->A = (u8)result;
 }
 void adc_immediate(CPU *cpu) {
-  u8 mem = read_byte(cpu, cpu->PC + 1);
+  u8 mem = operand_byte(cpu);
   adc_common(cpu, mem);
 } // ADC #$nn
 void adc_zeropage(CPU *cpu) {
@@ -411,18 +558,286 @@ void adc_indirect_y(CPU *cpu) {
   adc_common(cpu, mem);
 } // ADC ($nn),Y
 
-static void sbc_common(CPU *cpu, u8 sub) {}
-void sbc_immediate(CPU *cpu);
-void sbc_zeropage(CPU *cpu);
-void sbc_zeropage_x(CPU *cpu);
-void sbc_absolute(CPU *cpu);
-void sbc_absolute_x(CPU *cpu);
-void sbc_absolute_y(CPU *cpu);
-void sbc_indirect_x(CPU *cpu);
-void sbc_indirect_y(CPU *cpu);
+// The 2A03 has no decimal mode, so SBC is ADC with the operand inverted.
+static void sbc_common(CPU *cpu, u8 sub) { adc_common(cpu, ~sub); }
+void sbc_immediate(CPU *cpu) {
+  u8 mem = operand_byte(cpu);
+  sbc_common(cpu, mem);
+} // SBC #$nn
+void sbc_zeropage(CPU *cpu) {
+  u8 mem = zeropage_read(cpu);
+  sbc_common(cpu, mem);
+} // SBC $nn
+void sbc_zeropage_x(CPU *cpu) {
+  u8 mem = zeropage_offset_read(cpu, cpu->X);
+  sbc_common(cpu, mem);
+} // SBC $nn,X
+void sbc_absolute(CPU *cpu) {
+  u8 mem = absolute_read(cpu);
+  sbc_common(cpu, mem);
+} // SBC $nnnn
+void sbc_absolute_x(CPU *cpu) {
+  u8 mem = absolute_offset_read(cpu, cpu->X);
+  sbc_common(cpu, mem);
+} // SBC $nnnn,X
+void sbc_absolute_y(CPU *cpu) {
+  u8 mem = absolute_offset_read(cpu, cpu->Y);
+  sbc_common(cpu, mem);
+} // SBC $nnnn,Y
+void sbc_indirect_x(CPU *cpu) {
+  u8 mem = indexed_indirect_read_x(cpu);
+  sbc_common(cpu, mem);
+} // SBC ($nn,X)
+void sbc_indirect_y(CPU *cpu) {
+  u8 mem = indirect_indexed_read_y(cpu);
+  sbc_common(cpu, mem);
+} // SBC ($nn),Y
+
+static void compare(CPU *cpu, u8 reg, u8 value) {
+  set_flag(cpu, FLAG_CARRY, reg >= value);
+  set_nz(cpu, reg - value);
+}
+void cmp_immediate(CPU *cpu) {
+  compare(cpu, cpu->A, operand_byte(cpu));
+} // CMP #$nn
+void cmp_zeropage(CPU *cpu) {
+  compare(cpu, cpu->A, zeropage_read(cpu));
+} // CMP $nn
+void cmp_zeropage_x(CPU *cpu) {
+  compare(cpu, cpu->A, zeropage_offset_read(cpu, cpu->X));
+} // CMP $nn,X
+void cmp_absolute(CPU *cpu) {
+  compare(cpu, cpu->A, absolute_read(cpu));
+} // CMP $nnnn
+void cmp_absolute_x(CPU *cpu) {
+  compare(cpu, cpu->A, absolute_offset_read(cpu, cpu->X));
+} // CMP $nnnn,X
+void cmp_absolute_y(CPU *cpu) {
+  compare(cpu, cpu->A, absolute_offset_read(cpu, cpu->Y));
+} // CMP $nnnn,Y
+void cmp_indirect_x(CPU *cpu) {
+  compare(cpu, cpu->A, indexed_indirect_read_x(cpu));
+} // CMP ($nn,X)
+void cmp_indirect_y(CPU *cpu) {
+  compare(cpu, cpu->A, indirect_indexed_read_y(cpu));
+} // CMP ($nn),Y
+
+void cpx_immediate(CPU *cpu) {
+  compare(cpu, cpu->X, operand_byte(cpu));
+} // CPX #$nn
+void cpx_zeropage(CPU *cpu) {
+  compare(cpu, cpu->X, zeropage_read(cpu));
+} // CPX $nn
+void cpx_absolute(CPU *cpu) {
+  compare(cpu, cpu->X, absolute_read(cpu));
+} // CPX $nnnn
+
+void cpy_immediate(CPU *cpu) {
+  compare(cpu, cpu->Y, operand_byte(cpu));
+} // CPY #$nn
+void cpy_zeropage(CPU *cpu) {
+  compare(cpu, cpu->Y, zeropage_read(cpu));
+} // CPY $nn
+void cpy_absolute(CPU *cpu) {
+  compare(cpu, cpu->Y, absolute_read(cpu));
+} // CPY $nnnn
+
+static u8 inc_common(CPU *cpu, u8 value) {
+  value++;
+  set_nz(cpu, value);
+  return value;
+}
+static u8 dec_common(CPU *cpu, u8 value) {
+  value--;
+  set_nz(cpu, value);
+  return value;
+}
+void inc_zeropage(CPU *cpu) {
+  u16 addr = zeropage_addr(cpu);
+  write_byte(cpu, addr, inc_common(cpu, read_byte(cpu, addr)));
+} // INC $nn
+void inc_zeropage_x(CPU *cpu) {
+  u16 addr = zeropage_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, inc_common(cpu, read_byte(cpu, addr)));
+} // INC $nn,X
+void inc_absolute(CPU *cpu) {
+  u16 addr = absolute_addr(cpu);
+  write_byte(cpu, addr, inc_common(cpu, read_byte(cpu, addr)));
+} // INC $nnnn
+void inc_absolute_x(CPU *cpu) {
+  u16 addr = absolute_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, inc_common(cpu, read_byte(cpu, addr)));
+} // INC $nnnn,X
+void inx(CPU *cpu) { cpu->X = inc_common(cpu, cpu->X); } // INX
+void iny(CPU *cpu) { cpu->Y = inc_common(cpu, cpu->Y); } // INY
+
+void dec_zeropage(CPU *cpu) {
+  u16 addr = zeropage_addr(cpu);
+  write_byte(cpu, addr, dec_common(cpu, read_byte(cpu, addr)));
+} // DEC $nn
+void dec_zeropage_x(CPU *cpu) {
+  u16 addr = zeropage_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, dec_common(cpu, read_byte(cpu, addr)));
+} // DEC $nn,X
+void dec_absolute(CPU *cpu) {
+  u16 addr = absolute_addr(cpu);
+  write_byte(cpu, addr, dec_common(cpu, read_byte(cpu, addr)));
+} // DEC $nnnn
+void dec_absolute_x(CPU *cpu) {
+  u16 addr = absolute_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, dec_common(cpu, read_byte(cpu, addr)));
+} // DEC $nnnn,X
+void dex(CPU *cpu) { cpu->X = dec_common(cpu, cpu->X); } // DEX
+void dey(CPU *cpu) { cpu->Y = dec_common(cpu, cpu->Y); } // DEY
+
+static u8 asl_common(CPU *cpu, u8 value) {
+  set_flag(cpu, FLAG_CARRY, value & 0x80);
+  value <<= 1;
+  set_nz(cpu, value);
+  return value;
+}
+void asl_accumulator(CPU *cpu) { cpu->A = asl_common(cpu, cpu->A); } // ASL A
+void asl_zeropage(CPU *cpu) {
+  u16 addr = zeropage_addr(cpu);
+  write_byte(cpu, addr, asl_common(cpu, read_byte(cpu, addr)));
+} // ASL $nn
+void asl_zeropage_x(CPU *cpu) {
+  u16 addr = zeropage_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, asl_common(cpu, read_byte(cpu, addr)));
+} // ASL $nn,X
+void asl_absolute(CPU *cpu) {
+  u16 addr = absolute_addr(cpu);
+  write_byte(cpu, addr, asl_common(cpu, read_byte(cpu, addr)));
+} // ASL $nnnn
+void asl_absolute_x(CPU *cpu) {
+  u16 addr = absolute_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, asl_common(cpu, read_byte(cpu, addr)));
+} // ASL $nnnn,X
+
+static u8 lsr_common(CPU *cpu, u8 value) {
+  set_flag(cpu, FLAG_CARRY, value & 0x01);
+  value >>= 1;
+  set_nz(cpu, value);
+  return value;
+}
+void lsr_accumulator(CPU *cpu) { cpu->A = lsr_common(cpu, cpu->A); } // LSR A
+void lsr_zeropage(CPU *cpu) {
+  u16 addr = zeropage_addr(cpu);
+  write_byte(cpu, addr, lsr_common(cpu, read_byte(cpu, addr)));
+} // LSR $nn
+void lsr_zeropage_x(CPU *cpu) {
+  u16 addr = zeropage_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, lsr_common(cpu, read_byte(cpu, addr)));
+} // LSR $nn,X
+void lsr_absolute(CPU *cpu) {
+  u16 addr = absolute_addr(cpu);
+  write_byte(cpu, addr, lsr_common(cpu, read_byte(cpu, addr)));
+} // LSR $nnnn
+void lsr_absolute_x(CPU *cpu) {
+  u16 addr = absolute_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, lsr_common(cpu, read_byte(cpu, addr)));
+} // LSR $nnnn,X
+
+static u8 rol_common(CPU *cpu, u8 value) {
+  u8 carry = cpu->P & FLAG_CARRY;
+  set_flag(cpu, FLAG_CARRY, value & 0x80);
+  value = (value << 1) | carry;
+  set_nz(cpu, value);
+  return value;
+}
+void rol_accumulator(CPU *cpu) { cpu->A = rol_common(cpu, cpu->A); } // ROL A
+void rol_zeropage(CPU *cpu) {
+  u16 addr = zeropage_addr(cpu);
+  write_byte(cpu, addr, rol_common(cpu, read_byte(cpu, addr)));
+} // ROL $nn
+void rol_zeropage_x(CPU *cpu) {
+  u16 addr = zeropage_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, rol_common(cpu, read_byte(cpu, addr)));
+} // ROL $nn,X
+void rol_absolute(CPU *cpu) {
+  u16 addr = absolute_addr(cpu);
+  write_byte(cpu, addr, rol_common(cpu, read_byte(cpu, addr)));
+} // ROL $nnnn
+void rol_absolute_x(CPU *cpu) {
+  u16 addr = absolute_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, rol_common(cpu, read_byte(cpu, addr)));
+} // ROL $nnnn,X
+
+static u8 ror_common(CPU *cpu, u8 value) {
+  u8 carry = cpu->P & FLAG_CARRY;
+  set_flag(cpu, FLAG_CARRY, value & 0x01);
+  value = (value >> 1) | (carry << 7);
+  set_nz(cpu, value);
+  return value;
+}
+void ror_accumulator(CPU *cpu) { cpu->A = ror_common(cpu, cpu->A); } // ROR A
+void ror_zeropage(CPU *cpu) {
+  u16 addr = zeropage_addr(cpu);
+  write_byte(cpu, addr, ror_common(cpu, read_byte(cpu, addr)));
+} // ROR $nn
+void ror_zeropage_x(CPU *cpu) {
+  u16 addr = zeropage_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, ror_common(cpu, read_byte(cpu, addr)));
+} // ROR $nn,X
+void ror_absolute(CPU *cpu) {
+  u16 addr = absolute_addr(cpu);
+  write_byte(cpu, addr, ror_common(cpu, read_byte(cpu, addr)));
+} // ROR $nnnn
+void ror_absolute_x(CPU *cpu) {
+  u16 addr = absolute_offset_addr(cpu, cpu->X);
+  write_byte(cpu, addr, ror_common(cpu, read_byte(cpu, addr)));
+} // ROR $nnnn,X
+
+void clc(CPU *cpu) { set_flag(cpu, FLAG_CARRY, 0); } // CLC
+void cld(CPU *cpu) { set_flag(cpu, FLAG_DECIMAL, 0); } // CLD
+void cli(CPU *cpu) {
+  set_flag(cpu, FLAG_INTERRUPT_DISABLE, 0);
+  unmask_irq(cpu);
+} // CLI
+void clv(CPU *cpu) { set_flag(cpu, FLAG_OVERFLOW, 0); } // CLV
+void sec(CPU *cpu) { set_flag(cpu, FLAG_CARRY, 1); } // SEC
+void sed(CPU *cpu) { set_flag(cpu, FLAG_DECIMAL, 1); } // SED
+void sei(CPU *cpu) { set_flag(cpu, FLAG_INTERRUPT_DISABLE, 1); } // SEI
+
+// Control flow instructions set PC themselves, so their table length is 0.
+void jmp_absolute(CPU *cpu) { cpu->PC = absolute_addr(cpu); } // JMP $nnnn
+void jmp_indirect(CPU *cpu) {
+  // The pointer's high byte is fetched without carrying into the page.
+  u16 ptr = absolute_addr(cpu);
+  u8 lb = read_byte(cpu, ptr);
+  u8 rb = read_byte(cpu, (ptr & 0xFF00) | (u8)(ptr + 1));
+  cpu->PC = (rb << 8) | lb;
+} // JMP ($nnnn)
+void jsr(CPU *cpu) {
+  push_word(cpu, cpu->PC + 2);
+  cpu->PC = absolute_addr(cpu);
+} // JSR $nnnn
+void rts(CPU *cpu) { cpu->PC = pop_word(cpu) + 1; } // RTS
+void rti(CPU *cpu) {
+  pull_status(cpu);
+  cpu->PC = pop_word(cpu);
+} // RTI
 
 void brk(CPU *cpu) {
-  push_stack(cpu, cpu->PC + 2);
-  push_stack(cpu, cpu->P);
-  cpu->PC = 0xFFFE;
+  push_word(cpu, cpu->PC + 2);
+  push_stack(cpu, get_status(cpu) | FLAG_BREAK | 0x20);
+  set_flag(cpu, FLAG_INTERRUPT_DISABLE, 1);
+  cpu->PC = absolute_addr_at(cpu, 0xFFFE);
 } // BRK
+
+// Taken between instructions, so unlike the handlers it counts its own cycles.
+void nmi(CPU *cpu) {
+  push_word(cpu, cpu->PC);
+  push_stack(cpu, (get_status(cpu) & ~FLAG_BREAK) | 0x20);
+  set_flag(cpu, FLAG_INTERRUPT_DISABLE, 1);
+  cpu->PC = absolute_addr_at(cpu, 0xFFFA);
+  cpu->cycles += 7;
+}
+
+void irq(CPU *cpu) {
+  push_word(cpu, cpu->PC);
+  push_stack(cpu, (get_status(cpu) & ~FLAG_BREAK) | 0x20);
+  set_flag(cpu, FLAG_INTERRUPT_DISABLE, 1);
+  cpu->PC = absolute_addr_at(cpu, 0xFFFE);
+  cpu->cycles += 7;
+}
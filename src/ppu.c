@@ -0,0 +1,603 @@
+#include "ppu.h"
+#include <string.h>
+
+// sprite_line holds 0 for no sprite, else the colour (bits 0-1) and palette
+// (bits 2-3) of the frontmost sprite pixel plus these flags.
+typedef enum : u8 {
+  SPRITE_BEHIND = 0x20, // Background priority
+  SPRITE_ZERO = 0x40,   // Drawn by OAM entry 0
+} SpritePixel;
+
+static int rendering(const PPU *ppu) {
+  return ppu->mask & (PPU_MASK_BACKGROUND | PPU_MASK_SPRITES);
+}
+
+void ppu_set_mirroring(PPU *ppu, Mirroring mirroring) {
+  static const u8 QUADRANTS[5][4] = {
+      [MIRROR_HORIZONTAL] = {0, 0, 1, 1},
+      [MIRROR_VERTICAL] = {0, 1, 0, 1},
+      [MIRROR_FOUR_SCREEN] = {0, 1, 2, 3},
+      [MIRROR_SINGLE_LOWER] = {0, 0, 0, 0},
+      [MIRROR_SINGLE_UPPER] = {1, 1, 1, 1},
+  };
+  for (u32 i = 0; i < 4; i++) {
+    ppu->nametable[i] = ppu->ciram + QUADRANTS[mirroring][i] * 0x400;
+  }
+}
+
+void ppu_map_chr(PPU *ppu, u8 window, u8 *chr, u8 *tiles) {
+  ppu->chr[window] = chr;
+  ppu->chr_tiles[window] = tiles;
+}
+
+void ppu_power_on(PPU *ppu, Rom *rom) {
+  memset(ppu, 0, sizeof(*ppu));
+  ppu->chr_writable = rom->chr == NULL;
+  chr_decode(ppu->chr_ram, sizeof(ppu->chr_ram), ppu->chr_ram_tiles);
+  for (u32 i = 0; i < 8; i++) {
+    if (rom->chr) {
+      ppu_map_chr(ppu, i, rom_chr_bank(rom, i, 0x400),
+                  rom_chr_tiles(rom, i, 0x400));
+    } else {
+      ppu_map_chr(ppu, i, ppu->chr_ram + i * 0x400,
+                  ppu->chr_ram_tiles + i * 0x1000);
+    }
+  }
+  ppu_set_mirroring(ppu, rom->mirroring);
+}
+
+void ppu_reset(PPU *ppu) {
+  ppu->ctrl = 0;
+  ppu->mask = 0;
+  ppu->t = 0;
+  ppu->x = 0;
+  ppu->w = 0;
+  ppu->read_buffer = 0;
+  ppu->nmi = 0;
+}
+
+// $3F10/$3F14/$3F18/$3F1C are the same entries as $3F00/$3F04/$3F08/$3F0C.
+static u8 palette_index(u16 addr) {
+  u8 i = addr & 0x1F;
+  return (i & 0x13) == 0x10 ? i & 0x0F : i;
+}
+
+static u8 chr_read(const PPU *ppu, u16 addr) {
+  return ppu->chr[(addr >> 10) & 7][addr & 0x3FF];
+}
+
+// The 8 decoded pixels of the pattern row at addr (a low plane address).
+static u8 *chr_row(const PPU *ppu, u16 addr) {
+  return ppu->chr_tiles[(addr >> 10) & 7] + ((addr & 0x3F0) << 2) +
+         (addr & 7) * 8;
+}
+
+u8 ppu_read(PPU *ppu, u16 addr) {
+  addr &= 0x3FFF;
+  if (addr < 0x2000) {
+    return chr_read(ppu, addr);
+  }
+  if (addr < 0x3F00) {
+    return ppu->nametable[(addr >> 10) & 3][addr & 0x3FF];
+  }
+  return ppu->palette[palette_index(addr)];
+}
+
+void ppu_write(PPU *ppu, u16 addr, u8 val) {
+  addr &= 0x3FFF;
+  if (addr < 0x2000) {
+    if (ppu->chr_writable) {
+      ppu->chr[addr >> 10][addr & 0x3FF] = val;
+      // Keep the decoded copy of the tile in step.
+      chr_decode(ppu->chr[addr >> 10] + (addr & 0x3F0), 16,
+                 chr_row(ppu, addr & 0x1FF0));
+    }
+  } else if (addr < 0x3F00) {
+    ppu->nametable[(addr >> 10) & 3][addr & 0x3FF] = val;
+  } else {
+    ppu->palette[palette_index(addr)] = val & 0x3F;
+  }
+}
+
+u8 ppu_read_register(PPU *ppu, u16 addr) {
+  switch (addr & 7) {
+  case 2: {
+    u8 val = ppu->status | (ppu->latch & 0x1F);
+    ppu->status &= ~PPU_STATUS_VBLANK;
+    ppu->w = 0;
+    ppu->latch = val;
+    return val;
+  }
+  case 4:
+    ppu->latch = ppu->oam[ppu->oam_addr];
+    return ppu->latch;
+  case 7: {
+    u16 v = ppu->v & 0x3FFF;
+    u8 val = ppu->read_buffer;
+    if (v >= 0x3F00) {
+      // Palette reads skip the buffer, which gets the nametable underneath.
+      val = (ppu_read(ppu, v) & 0x3F) | (ppu->latch & 0xC0);
+      ppu->read_buffer = ppu_read(ppu, v - 0x1000);
+    } else {
+      ppu->read_buffer = ppu_read(ppu, v);
+    }
+    ppu->v += ppu->ctrl & PPU_CTRL_INCREMENT ? 32 : 1;
+    ppu->latch = val;
+    return val;
+  }
+  }
+  return ppu->latch;
+}
+
+void ppu_write_register(PPU *ppu, u16 addr, u8 val) {
+  ppu->latch = val;
+  switch (addr & 7) {
+  case 0:
+    // Enabling NMI during vblank fires one straight away.
+    if (!(ppu->ctrl & PPU_CTRL_NMI) && (val & PPU_CTRL_NMI) &&
+        (ppu->status & PPU_STATUS_VBLANK)) {
+      ppu->nmi = 1;
+    }
+    ppu->ctrl = val;
+    ppu->t = (ppu->t & 0xF3FF) | ((val & 0x03) << 10);
+    break;
+  case 1:
+    ppu->mask = val;
+    break;
+  case 3:
+    ppu->oam_addr = val;
+    break;
+  case 4:
+    ppu->oam[ppu->oam_addr++] = val;
+    break;
+  case 5:
+    if (!ppu->w) {
+      ppu->t = (ppu->t & 0xFFE0) | (val >> 3);
+      ppu->x = val & 7;
+    } else {
+      ppu->t = (ppu->t & 0x8C1F) | ((val & 0x07) << 12) | ((val & 0xF8) << 2);
+    }
+    ppu->w ^= 1;
+    break;
+  case 6:
+    if (!ppu->w) {
+      ppu->t = (ppu->t & 0x00FF) | ((val & 0x3F) << 8);
+    } else {
+      ppu->t = (ppu->t & 0xFF00) | val;
+      ppu->v = ppu->t;
+    }
+    ppu->w ^= 1;
+    break;
+  case 7:
+    ppu_write(ppu, ppu->v, val);
+    ppu->v += ppu->ctrl & PPU_CTRL_INCREMENT ? 32 : 1;
+    break;
+  }
+}
+
+static void increment_x(PPU *ppu) {
+  if ((ppu->v & 0x001F) == 31) {
+    ppu->v = (ppu->v & ~0x001F) ^ 0x0400;
+  } else {
+    ppu->v++;
+  }
+}
+
+static void increment_y(PPU *ppu) {
+  if ((ppu->v & 0x7000) != 0x7000) {
+    ppu->v += 0x1000;
+    return;
+  }
+  ppu->v &= ~0x7000;
+  u16 y = (ppu->v & 0x03E0) >> 5;
+  if (y == 29) {
+    y = 0;
+    ppu->v ^= 0x0800;
+  } else if (y == 31) {
+    y = 0;
+  } else {
+    y++;
+  }
+  ppu->v = (ppu->v & ~0x03E0) | (y << 5);
+}
+
+static void copy_x(PPU *ppu) {
+  ppu->v = (ppu->v & ~0x041F) | (ppu->t & 0x041F);
+}
+
+static void copy_y(PPU *ppu) {
+  ppu->v = (ppu->v & ~0x7BE0) | (ppu->t & 0x7BE0);
+}
+
+// The nametable and attribute fetches for the tile under v: returns the
+// address of its pattern row, with its palette in palette.
+static u16 background_tile(const PPU *ppu, u8 *palette) {
+  u16 v = ppu->v;
+  const u8 *nametable = ppu->nametable[(v >> 10) & 3];
+  u8 tile = nametable[v & 0x3FF];
+  u8 attribute = nametable[0x3C0 | ((v >> 4) & 0x38) | ((v >> 2) & 0x07)];
+  *palette = (attribute >> (((v >> 4) & 4) | (v & 2))) & 3;
+  return (ppu->ctrl & PPU_CTRL_BACKGROUND_TABLE ? 0x1000 : 0) | (tile << 4) |
+         ((v >> 12) & 7);
+}
+
+// All four fetches of one tile, done at once on the last of their eight dots.
+static void fetch_tile(PPU *ppu) {
+  u16 addr = background_tile(ppu, &ppu->next_attribute);
+  ppu->next_pattern_lo = chr_read(ppu, addr);
+  ppu->next_pattern_hi = chr_read(ppu, addr + 8);
+  increment_x(ppu);
+}
+
+static void reload_shifters(PPU *ppu) {
+  ppu->pattern_lo = (ppu->pattern_lo & 0xFF00) | ppu->next_pattern_lo;
+  ppu->pattern_hi = (ppu->pattern_hi & 0xFF00) | ppu->next_pattern_hi;
+  ppu->attribute_lo =
+      (ppu->attribute_lo & 0xFF00) | (ppu->next_attribute & 1 ? 0xFF : 0);
+  ppu->attribute_hi =
+      (ppu->attribute_hi & 0xFF00) | (ppu->next_attribute & 2 ? 0xFF : 0);
+}
+
+static void shift(PPU *ppu) {
+  ppu->pattern_lo <<= 1;
+  ppu->pattern_hi <<= 1;
+  ppu->attribute_lo <<= 1;
+  ppu->attribute_hi <<= 1;
+}
+
+// Background pixel bit of the shifters: palette in bits 2-3, colour in 0-1.
+static u8 shifter_pixel(const PPU *ppu, u8 bit) {
+  return ((ppu->pattern_lo >> bit) & 1) |
+         (((ppu->pattern_hi >> bit) & 1) << 1) |
+         (((ppu->attribute_lo >> bit) & 1) << 2) |
+         (((ppu->attribute_hi >> bit) & 1) << 3);
+}
+
+// Draws the sprites that the finished line selects into sprite_next, for the
+// line after it. Lower OAM entries win where sprites overlap.
+static void evaluate_sprites(PPU *ppu, u16 line) {
+  u8 height = ppu->ctrl & PPU_CTRL_SPRITE_SIZE ? 16 : 8;
+  u8 count = 0;
+  u8 high = 0;
+  for (u32 i = 0; i < 64; i++) {
+    const u8 *sprite = &ppu->oam[i * 4];
+    u16 row = line - sprite[0];
+    if (row >= height) {
+      continue;
+    }
+    if (count == 8) {
+      ppu->status |= PPU_STATUS_OVERFLOW;
+      break;
+    }
+    count++;
+    ppu->sprite_next_count = count;
+
+    u8 tile = sprite[1];
+    u8 attributes = sprite[2];
+    if (attributes & 0x80) {
+      row = height - 1 - row;
+    }
+    u16 addr;
+    if (height == 16) {
+      high |= tile & 1;
+      addr = ((tile & 1) << 12) | ((tile & 0xFE) << 4);
+      if (row >= 8) {
+        addr += 16;
+        row -= 8;
+      }
+    } else {
+      addr = (ppu->ctrl & PPU_CTRL_SPRITE_TABLE ? 0x1000 : 0) | (tile << 4);
+    }
+    const u8 *pixels = chr_row(ppu, addr + row);
+
+    u8 flags = ((attributes & 3) << 2) |
+               (attributes & 0x20 ? SPRITE_BEHIND : 0) |
+               (i == 0 ? SPRITE_ZERO : 0);
+    for (u32 px = 0; px < 8 && sprite[3] + px < PPU_WIDTH; px++) {
+      u8 colour = pixels[attributes & 0x40 ? 7 - px : px];
+      u8 *out = &ppu->sprite_next[sprite[3] + px];
+      if (colour && !(*out & 3)) {
+        *out = colour | flags;
+      }
+    }
+  }
+  // Empty slots fetch tile $FF, which 8x16 sprites take from $1000.
+  ppu->sprite_next_high = high || count < 8;
+}
+
+// Combines a background pixel with the sprites and writes it out, shared by
+// both renderers so they can't disagree.
+static void put_pixel(PPU *ppu, u8 *out, u32 x, u8 background) {
+  u8 mask = ppu->mask;
+  u8 left = x < 8;
+  if (!(mask & PPU_MASK_BACKGROUND) ||
+      (left && !(mask & PPU_MASK_BACKGROUND_LEFT))) {
+    background = 0;
+  }
+  u8 sprite = ppu->sprite_line[x];
+  if (!(mask & PPU_MASK_SPRITES) || (left && !(mask & PPU_MASK_SPRITES_LEFT))) {
+    sprite = 0;
+  }
+
+  u8 colour = 0;
+  if ((sprite & 3) && (background & 3)) {
+    if ((sprite & SPRITE_ZERO) && x != 255) {
+      ppu->status |= PPU_STATUS_SPRITE0;
+    }
+    colour = sprite & SPRITE_BEHIND ? background : 0x10 | (sprite & 0x0F);
+  } else if (sprite & 3) {
+    colour = 0x10 | (sprite & 0x0F);
+  } else if (background & 3) {
+    colour = background;
+  }
+  *out = ppu->palette[colour] & (mask & PPU_MASK_GRAYSCALE ? 0x30 : 0x3F);
+}
+
+static u32 line_length(const PPU *ppu) {
+  // Odd frames skip the last dot of the pre-render line while rendering.
+  if (ppu->scanline == PPU_PRERENDER_LINE && ppu->odd_frame && rendering(ppu)) {
+    return PPU_DOTS_PER_LINE - 1;
+  }
+  return PPU_DOTS_PER_LINE;
+}
+
+// Whether the sprite fetches at the end of line reach $1000. With 8x16
+// sprites that's up to the sprites evaluated for the next line.
+static u8 sprites_high(const PPU *ppu, u16 line) {
+  if (!(ppu->ctrl & PPU_CTRL_SPRITE_SIZE)) {
+    return (ppu->ctrl & PPU_CTRL_SPRITE_TABLE) != 0;
+  }
+  return line == PPU_PRERENDER_LINE || ppu->sprite_next_high;
+}
+
+// The dot of a rendered line at which A12 rises through MMC3's filter, or 0.
+// It has to stay low for a few CPU cycles first, which only the long runs of
+// fetches from one table give it: with the background at $0000 and sprites at
+// $1000 it rises in the sprite fetches, the other way round in the
+// background fetches for the next line. With both at $1000 it only stays low
+// long enough over vblank.
+static u16 a12_dot(const PPU *ppu, u16 line, u8 sprites) {
+  u8 background = (ppu->ctrl & PPU_CTRL_BACKGROUND_TABLE) != 0;
+  if (sprites && !background) {
+    return 260;
+  }
+  if (background && !sprites) {
+    return 324;
+  }
+  if (background && line == PPU_PRERENDER_LINE) {
+    return 4;
+  }
+  return 0;
+}
+
+static void next_line(PPU *ppu) {
+  ppu->dot = 0;
+  if (ppu->sprite_line_count || ppu->sprite_next_count) {
+    memcpy(ppu->sprite_line, ppu->sprite_next, PPU_WIDTH);
+    memset(ppu->sprite_next, 0, PPU_WIDTH);
+    ppu->sprite_line_count = ppu->sprite_next_count;
+    ppu->sprite_next_count = 0;
+  }
+  if (++ppu->scanline == PPU_LINES_PER_FRAME) {
+    ppu->scanline = 0;
+    ppu->frame++;
+    ppu->odd_frame ^= 1;
+  }
+}
+
+static void line_events(PPU *ppu) {
+  if (ppu->scanline == PPU_VBLANK_LINE) {
+    ppu->status |= PPU_STATUS_VBLANK;
+    if (ppu->ctrl & PPU_CTRL_NMI) {
+      ppu->nmi = 1;
+    }
+  } else if (ppu->scanline == PPU_PRERENDER_LINE) {
+    ppu->status &=
+        ~(PPU_STATUS_VBLANK | PPU_STATUS_SPRITE0 | PPU_STATUS_OVERFLOW);
+  }
+}
+
+// One dot of a visible or pre-render line with rendering on. Shifting comes
+// before the pixel and fetches after it, so pixel x of a line is bit x + fine
+// X of the stream formed by the shifters at dot 0 followed by the tiles
+// fetched at dots 8, 16, ... 256; render_line relies on that.
+static void render_dot(PPU *ppu) {
+  u16 dot = ppu->dot;
+  if ((dot >= 2 && dot <= 257) || (dot >= 322 && dot <= 337)) {
+    shift(ppu);
+  }
+  if ((dot & 7) == 1 &&
+      ((dot >= 9 && dot <= 257) || dot == 329 || dot == 337)) {
+    reload_shifters(ppu);
+  }
+  if (ppu->scanline < PPU_HEIGHT && dot >= 1 && dot <= 256) {
+    u8 *out = &ppu->framebuffer[ppu->scanline * PPU_WIDTH + dot - 1];
+    put_pixel(ppu, out, dot - 1, shifter_pixel(ppu, 15 - ppu->x));
+  }
+  if ((dot & 7) == 0 &&
+      ((dot >= 8 && dot <= 256) || dot == 328 || dot == 336)) {
+    fetch_tile(ppu);
+  }
+  if (dot == 256) {
+    increment_y(ppu);
+  } else if (dot == 257) {
+    copy_x(ppu);
+    if (ppu->scanline < PPU_HEIGHT) {
+      evaluate_sprites(ppu, ppu->scanline);
+    }
+  } else if (ppu->scanline == PPU_PRERENDER_LINE && dot >= 280 && dot <= 304) {
+    copy_y(ppu);
+  }
+  if ((dot == 4 || dot == 260 || dot == 324) &&
+      dot == a12_dot(ppu, ppu->scanline, sprites_high(ppu, ppu->scanline))) {
+    ppu->a12_rises++;
+  }
+}
+
+static void step_dot(PPU *ppu) {
+  u16 line = ppu->scanline;
+  if (line < PPU_HEIGHT || line == PPU_PRERENDER_LINE) {
+    if (rendering(ppu)) {
+      render_dot(ppu);
+    } else if (line < PPU_HEIGHT && ppu->dot >= 1 && ppu->dot <= 256) {
+      ppu->framebuffer[line * PPU_WIDTH + ppu->dot - 1] = ppu->palette[0];
+    }
+  }
+  if (ppu->dot == 1) {
+    line_events(ppu);
+  }
+
+  u32 length = line_length(ppu);
+  ppu->dots++;
+  if (++ppu->dot == length) {
+    next_line(ppu);
+  }
+}
+
+// Writes out a visible line from its background pixels. Pixels without a
+// sprite only need the palette, the rest go through put_pixel.
+static void draw_line(PPU *ppu, const u8 *background) {
+  u8 *out = &ppu->framebuffer[ppu->scanline * PPU_WIDTH];
+  u8 grayscale = ppu->mask & PPU_MASK_GRAYSCALE ? 0x30 : 0x3F;
+  u8 colours[16];
+  for (u32 i = 0; i < 16; i++) {
+    colours[i] = ppu->palette[i & 3 ? i : 0] & grayscale;
+  }
+
+  u32 x = 0;
+  if (!(ppu->mask & PPU_MASK_BACKGROUND)) {
+    memset(out, colours[0], PPU_WIDTH);
+    x = PPU_WIDTH;
+  } else if (!(ppu->mask & PPU_MASK_BACKGROUND_LEFT)) {
+    memset(out, colours[0], 8);
+    x = 8;
+  }
+  for (; x < PPU_WIDTH; x++) {
+    out[x] = colours[background[x]];
+  }
+
+  if (ppu->sprite_line_count && (ppu->mask & PPU_MASK_SPRITES)) {
+    for (x = 0; x < PPU_WIDTH; x++) {
+      if (ppu->sprite_line[x]) {
+        put_pixel(ppu, &out[x], x, background[x]);
+      }
+    }
+  }
+}
+
+// A whole visible or pre-render line with rendering on, with the same result
+// as its 341 dots through render_dot.
+static void render_line(PPU *ppu) {
+  u8 stream[16 + 32 * 8];
+  for (u32 i = 0; i < 16; i++) {
+    stream[i] = shifter_pixel(ppu, 15 - i);
+  }
+  u8 visible = ppu->scanline < PPU_HEIGHT;
+  for (u32 tile = 0; tile < 32; tile++) {
+    if (visible) {
+      u8 palette;
+      u64 pixels;
+      memcpy(&pixels, chr_row(ppu, background_tile(ppu, &palette)), 8);
+      pixels |= (palette << 2) * 0x0101010101010101ull;
+      memcpy(&stream[16 + tile * 8], &pixels, 8);
+    }
+    increment_x(ppu);
+  }
+  if (visible) {
+    draw_line(ppu, &stream[ppu->x]);
+  }
+
+  increment_y(ppu);
+  copy_x(ppu);
+  if (visible) {
+    evaluate_sprites(ppu, ppu->scanline);
+  } else {
+    copy_y(ppu);
+  }
+  if (a12_dot(ppu, ppu->scanline, sprites_high(ppu, ppu->scanline))) {
+    ppu->a12_rises++;
+  }
+
+  // The first two tiles of the next line, exactly as dots 321-337 leave them.
+  fetch_tile(ppu);
+  u8 first_lo = ppu->next_pattern_lo;
+  u8 first_hi = ppu->next_pattern_hi;
+  u8 first_attribute = ppu->next_attribute;
+  fetch_tile(ppu);
+  ppu->pattern_lo = first_lo << 8 | ppu->next_pattern_lo;
+  ppu->pattern_hi = first_hi << 8 | ppu->next_pattern_hi;
+  ppu->attribute_lo = (first_attribute & 1 ? 0xFF00 : 0) |
+                      (ppu->next_attribute & 1 ? 0x00FF : 0);
+  ppu->attribute_hi = (first_attribute & 2 ? 0xFF00 : 0) |
+                      (ppu->next_attribute & 2 ? 0x00FF : 0);
+}
+
+// A whole line from dot 0.
+static void run_line(PPU *ppu) {
+  u16 line = ppu->scanline;
+  u32 length = line_length(ppu);
+  line_events(ppu);
+  if (line < PPU_HEIGHT || line == PPU_PRERENDER_LINE) {
+    if (rendering(ppu)) {
+      render_line(ppu);
+    } else if (line < PPU_HEIGHT) {
+      memset(&ppu->framebuffer[line * PPU_WIDTH], ppu->palette[0], PPU_WIDTH);
+    }
+  }
+  ppu->fast_lines++;
+  ppu->dots += length;
+  next_line(ppu);
+}
+
+void ppu_run_to(PPU *ppu, u64 dots) {
+  while (ppu->dots < dots) {
+    if (ppu->dot == 0 && ppu->dots + line_length(ppu) <= dots) {
+      run_line(ppu);
+    } else {
+      step_dot(ppu);
+    }
+  }
+}
+
+u32 ppu_dots_to_vblank(const PPU *ppu) {
+  u32 position = ppu->scanline * PPU_DOTS_PER_LINE + ppu->dot;
+  u32 vblank = PPU_VBLANK_LINE * PPU_DOTS_PER_LINE + 1;
+  if (position <= vblank) {
+    return vblank - position;
+  }
+  return PPU_LINES_PER_FRAME * PPU_DOTS_PER_LINE - position + vblank;
+}
+
+u64 ppu_dots_to_a12_rises(const PPU *ppu, u32 count) {
+  u8 ctrl = ppu->ctrl;
+  u8 tall = ctrl & PPU_CTRL_SPRITE_SIZE;
+  u8 background = (ctrl & PPU_CTRL_BACKGROUND_TABLE) != 0;
+  if (!rendering(ppu) || count == 0 ||
+      (!tall && !background && !(ctrl & PPU_CTRL_SPRITE_TABLE))) {
+    return UINT64_MAX;
+  }
+  u16 line = ppu->scanline;
+  u16 dot = ppu->dot;
+  u8 odd = ppu->odd_frame;
+  u64 dots = 0;
+  for (;;) {
+    if (line < PPU_HEIGHT || line == PPU_PRERENDER_LINE) {
+      // 8x16 sprites not evaluated yet are taken to rise wherever they can.
+      u8 sprites = tall && line != PPU_PRERENDER_LINE &&
+                           !(dots == 0 && dot > 257)
+                       ? !background
+                       : sprites_high(ppu, line);
+      u16 rise = a12_dot(ppu, line, sprites);
+      if (rise && rise >= dot && --count == 0) {
+        return dots + rise - dot;
+      }
+    }
+    u8 short_line = line == PPU_PRERENDER_LINE && odd;
+    dots += PPU_DOTS_PER_LINE - short_line - dot;
+    dot = 0;
+    if (++line == PPU_LINES_PER_FRAME) {
+      line = 0;
+      odd ^= 1;
+    }
+  }
+}
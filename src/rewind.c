@@ -0,0 +1,243 @@
+#include "rewind.h"
+#include "state.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define WRAP UINT32_MAX   // Entry size marking the rest of the arena unused
+#define MIN_ZERO_RUN 8    // Shorter runs of zeros stay inside literal runs
+// Worst case: MIN_ZERO_RUN zeros between single changed bytes, costing two
+// 5-byte varints each.
+#define ENCODED_MAX(n) ((n) + ((n) / MIN_ZERO_RUN + 1) * 10)
+
+typedef struct {
+  u32 size;     // Encoded bytes that follow, or WRAP
+  u32 prev;     // The entry before this one
+  u32 keyframe; // The bytes are a whole state rather than a delta
+} Entry;
+
+static Entry entry_at(const Rewind *rw, u32 offset) {
+  Entry entry;
+  memcpy(&entry, rw->arena + offset, sizeof(entry));
+  return entry;
+}
+
+// The offset of the entry after the one at offset, following wraps.
+static u32 entry_after(const Rewind *rw, u32 offset) {
+  u32 next = offset + sizeof(Entry) + entry_at(rw, offset).size;
+  if (rw->size - next < sizeof(Entry) || entry_at(rw, next).size == WRAP) {
+    return 0;
+  }
+  return next;
+}
+
+int rewind_init(Rewind *rw, u32 arena_size, u32 keyframe_interval) {
+  memset(rw, 0, sizeof(*rw));
+  u32 n = state_size();
+  if (keyframe_interval == 0 ||
+      keyframe_interval > REWIND_MAX_KEYFRAME_INTERVAL ||
+      arena_size < 2 * (sizeof(Entry) + ENCODED_MAX(n))) {
+    return -1;
+  }
+  rw->arena = malloc(arena_size);
+  rw->last = calloc(1, n);
+  rw->next = malloc(n);
+  rw->encoded = malloc(ENCODED_MAX(n));
+  if (!rw->arena || !rw->last || !rw->next || !rw->encoded) {
+    rewind_free(rw);
+    return -1;
+  }
+  rw->size = arena_size;
+  rw->keyframe_interval = keyframe_interval;
+  return 0;
+}
+
+void rewind_free(Rewind *rw) {
+  free(rw->arena);
+  free(rw->last);
+  free(rw->next);
+  free(rw->encoded);
+  memset(rw, 0, sizeof(*rw));
+}
+
+static u8 *put_varint(u8 *out, u32 value) {
+  while (value >= 0x80) {
+    *out++ = value | 0x80;
+    value >>= 7;
+  }
+  *out++ = value;
+  return out;
+}
+
+static u32 get_varint(const u8 **in) {
+  u32 value = 0;
+  for (u32 shift = 0;; shift += 7) {
+    u8 byte = *(*in)++;
+    value |= (u32)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+}
+
+static u8 changed(const u8 *state, const u8 *base, u32 i) {
+  return state[i] ^ (base ? base[i] : 0);
+}
+
+static u64 word_changed(const u8 *state, const u8 *base, u32 i) {
+  u64 a, b = 0;
+  memcpy(&a, state + i, 8);
+  if (base) {
+    memcpy(&b, base + i, 8);
+  }
+  return a ^ b;
+}
+
+// Run-length encodes state XOR base, or state itself when base is NULL, as
+// pairs of varints: bytes that didn't change, then bytes that did followed by
+// their XOR. Returns the encoded size.
+static u32 encode(const u8 *state, const u8 *base, u32 n, u8 *out) {
+  u8 *start = out;
+  u32 pos = 0;
+  while (pos < n) {
+    u32 zeros = pos;
+    while (n - pos >= 8 && !word_changed(state, base, pos)) {
+      pos += 8;
+    }
+    while (pos < n && !changed(state, base, pos)) {
+      pos++;
+    }
+    out = put_varint(out, pos - zeros);
+
+    u32 literal = pos;
+    u32 end = pos;
+    while (pos < n && pos - end < MIN_ZERO_RUN) {
+      if (changed(state, base, pos)) {
+        end = pos + 1;
+      }
+      pos++;
+    }
+    pos = end;
+    out = put_varint(out, end - literal);
+    for (u32 i = literal; i < end; i++) {
+      *out++ = changed(state, base, i);
+    }
+  }
+  return out - start;
+}
+
+// XORs an encoded entry into state.
+static void decode(const u8 *in, u32 n, u8 *state) {
+  u32 pos = 0;
+  while (pos < n) {
+    pos += get_varint(&in);
+    u32 count = get_varint(&in);
+    for (u32 i = 0; i < count; i++) {
+      state[pos + i] ^= in[i];
+    }
+    in += count;
+    pos += count;
+  }
+}
+
+static void drop_oldest(Rewind *rw) {
+  rw->tail = entry_after(rw, rw->tail);
+  rw->frames--;
+}
+
+// Moves head to somewhere size bytes fit, dropping the oldest entries until
+// they do.
+static void make_room(Rewind *rw, u32 size) {
+  for (;;) {
+    if (rw->frames == 0) {
+      rw->head = rw->tail = 0;
+      return;
+    }
+    if (rw->tail < rw->head) {
+      if (rw->size - rw->head >= size) {
+        return;
+      }
+      if (rw->size - rw->head >= sizeof(Entry)) {
+        Entry wrap = {.size = WRAP};
+        memcpy(rw->arena + rw->head, &wrap, sizeof(wrap));
+      }
+      rw->head = 0;
+      continue;
+    }
+    if (rw->tail - rw->head >= size) {
+      return;
+    }
+    drop_oldest(rw);
+  }
+}
+
+void rewind_push(Rewind *rw, NES *nes) {
+  u32 n = state_size();
+  // next still holds the last push, or the frame seeked to, whose pages
+  // state_load marked dirty.
+  if (rw->frames == 0) {
+    state_save(nes, rw->next);
+  } else {
+    state_update(nes, rw->next);
+  }
+  u32 keyframe =
+      rw->frames == 0 || rw->since_keyframe + 1 >= rw->keyframe_interval;
+  u32 size = encode(rw->next, keyframe ? NULL : rw->last, n, rw->encoded);
+
+  make_room(rw, sizeof(Entry) + size);
+  // Deltas are no use without the keyframe they build on.
+  while (rw->frames && !entry_at(rw, rw->tail).keyframe) {
+    drop_oldest(rw);
+  }
+  if (rw->frames == 0 && !keyframe) {
+    keyframe = 1;
+    size = encode(rw->next, NULL, n, rw->encoded);
+    make_room(rw, sizeof(Entry) + size);
+  }
+
+  Entry entry = {.size = size, .prev = rw->newest, .keyframe = keyframe};
+  memcpy(rw->arena + rw->head, &entry, sizeof(entry));
+  memcpy(rw->arena + rw->head + sizeof(entry), rw->encoded, size);
+  rw->newest = rw->head;
+  rw->head += sizeof(entry) + size;
+  rw->frames++;
+  rw->since_keyframe = keyframe ? 0 : rw->since_keyframe + 1;
+
+  // next stays where it is for the next update, and the delta, only as long
+  // as what changed, brings last up to it.
+  if (keyframe) {
+    memcpy(rw->last, rw->next, n);
+  } else {
+    decode(rw->encoded, n, rw->last);
+  }
+}
+
+int rewind_seek(Rewind *rw, NES *nes, u32 back) {
+  if (back >= rw->frames) {
+    return -1;
+  }
+  u32 target = rw->newest;
+  for (u32 i = 0; i < back; i++) {
+    target = entry_at(rw, target).prev;
+  }
+
+  // Back to the keyframe, then forwards through the deltas after it.
+  u32 chain[REWIND_MAX_KEYFRAME_INTERVAL];
+  u32 length = 0;
+  u32 offset = target;
+  while (!entry_at(rw, offset).keyframe) {
+    chain[length++] = offset;
+    offset = entry_at(rw, offset).prev;
+  }
+  u32 n = state_size();
+  memset(rw->last, 0, n);
+  decode(rw->arena + offset + sizeof(Entry), n, rw->last);
+  for (u32 i = length; i-- > 0;) {
+    decode(rw->arena + chain[i] + sizeof(Entry), n, rw->last);
+  }
+
+  rw->newest = target;
+  rw->head = target + sizeof(Entry) + entry_at(rw, target).size;
+  rw->frames -= back;
+  rw->since_keyframe = length;
+  return state_load(nes, rw->last, n) == STATE_OK ? 0 : -1;
+}
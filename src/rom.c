@@ -0,0 +1,208 @@
+#include "rom.h"
+#include "tile.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HEADER_SIZE 16
+#define TRAINER_SIZE 512
+#define CHR_DECODE_BANK 0x400 // What rom_chr_tiles decodes at once
+
+// 1 KiB banks of CHR, counting a shorter one at the end.
+static u32 chr_banks(const Rom *rom) {
+  return (rom->chr_size + CHR_DECODE_BANK - 1) / CHR_DECODE_BANK;
+}
+
+// NES 2.0 ROM sizes are either a count of units (with the high nibble from
+// byte 9), or when that nibble is $F, an exponent-multiplier pair. The
+// exponent goes up to 63, so the result is only bounded by the file size.
+static u64 nes2_rom_size(u8 lsb, u8 msb, u32 unit) {
+  if (msb == 0xF) {
+    u8 exponent = lsb >> 2;
+    u8 multiplier = (lsb & 0x03) * 2 + 1;
+    if (exponent > 60) {
+      return UINT64_MAX;
+    }
+    return ((u64)1 << exponent) * multiplier;
+  }
+  return (((u64)msb << 8) | lsb) * unit;
+}
+
+// NES 2.0 RAM sizes are stored as a shift count, 0 meaning no RAM.
+static u32 nes2_ram_size(u8 shift) { return shift ? 64u << shift : 0; }
+
+RomError rom_parse(Rom *rom, u8 *data, size_t size) {
+  memset(rom, 0, sizeof(*rom));
+  if (size < HEADER_SIZE || memcmp(data, "NES\x1A", 4) != 0) {
+    return ROM_ERR_FORMAT;
+  }
+
+  u8 flags6 = data[6];
+  u8 flags7 = data[7];
+  u64 prg_size;
+  u64 chr_size;
+  rom->nes2 = (flags7 & 0x0C) == 0x08;
+  rom->battery = (flags6 & 0x02) != 0;
+  if (flags6 & 0x08) {
+    rom->mirroring = MIRROR_FOUR_SCREEN;
+  } else {
+    rom->mirroring = (flags6 & 0x01) ? MIRROR_VERTICAL : MIRROR_HORIZONTAL;
+  }
+
+  if (rom->nes2) {
+    rom->mapper = ((data[8] & 0x0F) << 8) | (flags7 & 0xF0) | (flags6 >> 4);
+    rom->submapper = data[8] >> 4;
+    prg_size = nes2_rom_size(data[4], data[9] & 0x0F, 0x4000);
+    chr_size = nes2_rom_size(data[5], data[9] >> 4, 0x2000);
+    rom->prg_ram_size =
+        nes2_ram_size(data[10] & 0x0F) + nes2_ram_size(data[10] >> 4);
+    rom->chr_ram_size =
+        nes2_ram_size(data[11] & 0x0F) + nes2_ram_size(data[11] >> 4);
+  } else {
+    // Old dumping tools wrote their name over bytes 7-15; when the padding
+    // isn't clear the upper mapper nibble can't be trusted either.
+    u8 dirty = data[12] | data[13] | data[14] | data[15];
+    rom->mapper = (dirty ? 0 : (flags7 & 0xF0)) | (flags6 >> 4);
+    prg_size = data[4] * 0x4000;
+    chr_size = data[5] * 0x2000;
+    rom->prg_ram_size = (data[8] ? data[8] : 1) * 0x2000;
+    rom->chr_ram_size = chr_size ? 0 : 0x2000;
+  }
+
+  // Compared piece by piece, so sizes near UINT64_MAX can't wrap the sum.
+  // Banks are addressed in 32 bits, which no real board comes close to.
+  u64 offset = HEADER_SIZE + ((flags6 & 0x04) ? TRAINER_SIZE : 0);
+  if (prg_size == 0 || size < offset || prg_size > size - offset ||
+      chr_size > size - offset - prg_size || prg_size > UINT32_MAX / 4 ||
+      chr_size > UINT32_MAX / 4) {
+    return ROM_ERR_SIZE;
+  }
+  // Banks are handed out as whole 16 KiB PRG and 1 KiB CHR windows, so odd
+  // sizes would let reads run past the end of the image.
+  if (prg_size % 0x4000 || chr_size % 0x400) {
+    return ROM_ERR_FORMAT;
+  }
+  rom->prg_size = prg_size;
+  rom->chr_size = chr_size;
+  rom->data = data;
+  rom->size = size;
+  rom->prg = data + offset;
+  rom->chr = rom->chr_size ? rom->prg + rom->prg_size : NULL;
+  return ROM_OK;
+}
+
+RomError rom_load(Rom *rom, const char *path) {
+  memset(rom, 0, sizeof(*rom));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return ROM_ERR_OPEN;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return ROM_ERR_OPEN;
+  }
+  if (st.st_size < HEADER_SIZE) {
+    close(fd);
+    return ROM_ERR_FORMAT;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return ROM_ERR_OPEN;
+  }
+
+  RomError err = rom_parse(rom, data, st.st_size);
+  if (err != ROM_OK) {
+    munmap(data, st.st_size);
+    return err;
+  }
+  if (rom->chr) {
+    // Anonymous pages cost nothing until a bank is decoded into them, so
+    // loading doesn't grow with the size of CHR.
+    void *tiles = mmap(NULL, (size_t)rom->chr_size * 4, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    rom->chr_decoded = calloc(chr_banks(rom) / 8 + 1, 1);
+    if (tiles == MAP_FAILED || rom->chr_decoded == NULL) {
+      if (tiles != MAP_FAILED) {
+        munmap(tiles, (size_t)rom->chr_size * 4);
+      }
+      rom_unload(rom);
+      return ROM_ERR_OPEN;
+    }
+    rom->chr_tiles = tiles;
+  }
+  return ROM_OK;
+}
+
+void rom_unload(Rom *rom) {
+  if (rom->data) {
+    munmap(rom->data, rom->size);
+  }
+  if (rom->chr_tiles) {
+    munmap(rom->chr_tiles, (size_t)rom->chr_size * 4);
+  }
+  free(rom->chr_decoded);
+  memset(rom, 0, sizeof(*rom));
+}
+
+const char *rom_error_str(RomError err) {
+  switch (err) {
+  case ROM_OK:
+    return "ok";
+  case ROM_ERR_OPEN:
+    return "error opening file. the file may not exist";
+  case ROM_ERR_FORMAT:
+    return "not an iNES file";
+  case ROM_ERR_SIZE:
+    return "file is smaller than its header says";
+  case ROM_ERR_MAPPER:
+    return "mapper not supported";
+  case ROM_ERR_MEMORY:
+    return "out of memory";
+  }
+  return "unknown error";
+}
+
+u8 *rom_prg_bank(const Rom *rom, u32 bank, u32 bank_size) {
+  return rom->prg + (bank * bank_size) % rom->prg_size;
+}
+
+u8 *rom_chr_bank(const Rom *rom, u32 bank, u32 bank_size) {
+  if (!rom->chr) {
+    return NULL;
+  }
+  return rom->chr + (bank * bank_size) % rom->chr_size;
+}
+
+u8 *rom_chr_tiles(Rom *rom, u32 bank, u32 bank_size) {
+  if (!rom->chr_tiles) {
+    return NULL;
+  }
+  u32 offset = (bank * bank_size) % rom->chr_size;
+  u32 end = offset + bank_size < rom->chr_size ? offset + bank_size
+                                               : rom->chr_size;
+  for (u32 i = offset / CHR_DECODE_BANK; i * CHR_DECODE_BANK < end; i++) {
+    u8 bit = 1 << (i & 7);
+    if (!(rom->chr_decoded[i >> 3] & bit)) {
+      u32 start = i * CHR_DECODE_BANK;
+      u32 size = rom->chr_size - start < CHR_DECODE_BANK ? rom->chr_size - start
+                                                         : CHR_DECODE_BANK;
+      chr_decode(rom->chr + start, size, rom->chr_tiles + start * 4);
+      rom->chr_decoded[i >> 3] |= bit;
+    }
+  }
+  return rom->chr_tiles + offset * 4;
+}
+
+void chr_decode(const u8 *chr, u32 size, u8 *tiles) {
+  static const u8 NO_PALETTE[8];
+  TileDecodeFunc decode = tile_decoder();
+  for (u32 tile = 0; tile < size / 16; tile++) {
+    decode(chr + tile * 16, chr + tile * 16 + 8, NO_PALETTE, 8,
+           tiles + tile * 64);
+  }
+}
@@ -0,0 +1,206 @@
+#include "runner.h"
+#include "block.h"
+#include "emu.h"
+#include "opcode.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+int runner_parse_until(RunConfig *config, const char *arg) {
+  if (strcmp(arg, "blargg") == 0) {
+    config->blargg = 1;
+    return 0;
+  }
+  char *end;
+  unsigned long addr = strtoul(arg, &end, 16);
+  u8 not_equal = 0;
+  if (end == arg || addr > 0xFFFF) {
+    return -1;
+  }
+  if (*end == '!') {
+    not_equal = 1;
+    end++;
+  }
+  if (*end != '=') {
+    return -1;
+  }
+  const char *val_str = end + 1;
+  unsigned long value = strtoul(val_str, &end, 16);
+  if (end == val_str || *end != '\0' || value > 0xFF) {
+    return -1;
+  }
+  config->has_until = 1;
+  config->until_not_equal = not_equal;
+  config->until_addr = addr;
+  config->until_value = value;
+  return 0;
+}
+
+static int until_met(NES *nes, const RunConfig *config) {
+  u8 value = read_byte(&nes->cpu, config->until_addr);
+  return (value == config->until_value) != config->until_not_equal;
+}
+
+// Blargg's test ROMs keep their status at $6000 once $6001-$6003 hold the
+// signature: $80 while running, $81 when they want the console reset and the
+// result code, 0 for a pass, once done. Their text output is a C string at
+// $6004.
+#define BLARGG_STATUS 0x6000
+#define BLARGG_TEXT 0x6004
+#define BLARGG_RUNNING 0x80
+#define BLARGG_RESET 0x81
+// The ROMs ask for the reset button to be held at least 100 ms.
+#define BLARGG_RESET_DELAY FRAMES_TO_CPU_CYCLES(6)
+
+static int blargg_valid(CPU *cpu) {
+  return read_byte(cpu, BLARGG_STATUS + 1) == 0xDE &&
+         read_byte(cpu, BLARGG_STATUS + 2) == 0xB0 &&
+         read_byte(cpu, BLARGG_STATUS + 3) == 0x61;
+}
+
+// Returns 1 once the ROM has reported its result, pressing reset for it on
+// the way. reset_at is when a requested reset is due, 0 if none is.
+static int blargg_done(NES *nes, u64 *reset_at) {
+  CPU *cpu = &nes->cpu;
+  if (!blargg_valid(cpu)) {
+    return 0;
+  }
+  u8 status = read_byte(cpu, BLARGG_STATUS);
+  if (status == BLARGG_RESET) {
+    if (*reset_at == 0) {
+      *reset_at = cpu->cycles + BLARGG_RESET_DELAY;
+    } else if (cpu->cycles >= *reset_at) {
+      *reset_at = 0;
+      nes_reset(nes);
+    }
+    return 0;
+  }
+  return status < BLARGG_RUNNING;
+}
+
+// Copies the text output, with line breaks flattened so it fits on one line.
+static void blargg_message(CPU *cpu, char *message) {
+  u32 len = 0;
+  for (u16 addr = BLARGG_TEXT; len < RUNNER_MESSAGE_SIZE - 1; addr++) {
+    char c = read_byte(cpu, addr);
+    if (c == '\0') {
+      break;
+    }
+    message[len++] = c == '\n' ? ' ' : c;
+  }
+  while (len > 0 && message[len - 1] == ' ') {
+    len--;
+  }
+  message[len] = '\0';
+}
+
+static void write_audio(NES *nes, FILE *out) {
+  s16 samples[1024];
+  u32 count;
+  while ((count = apu_read_samples(&nes->apu, samples, 1024)) > 0) {
+    fwrite(samples, sizeof(s16), count, out);
+  }
+}
+
+RunResult runner_run(NES *nes, const RunConfig *config) {
+  RunResult result = {0};
+  u64 reset_at = 0;
+  CPU *cpu = &nes->cpu;
+  u64 interval = config->check_interval ? config->check_interval
+                                        : FRAMES_TO_CPU_CYCLES(1);
+  u64 budget = config->max_cycles ? config->max_cycles : UINT64_MAX;
+  // Nobody is listening, so only what the CPU sees of the APU is kept up.
+  apu_set_audio(&nes->apu, config->audio ? config->audio_mode : APU_AUDIO_OFF);
+  if (config->engine == ENGINE_BLOCKS) {
+    block_cache_attach(cpu);
+  } else if (config->engine == ENGINE_JIT) {
+    block_cache_attach_jit(cpu);
+  }
+
+  // Checking the condition between slices instead of per instruction keeps
+  // the dispatch loop free of anything but emulation.
+  result.status = RUN_TIMEOUT;
+  while (cpu->cycles < budget) {
+    u64 slice_end = cpu->cycles + interval;
+    nes_run_until(nes, slice_end < budget ? slice_end : budget);
+    if (config->audio) {
+      write_audio(nes, config->audio);
+    }
+    if (config->has_until && until_met(nes, config)) {
+      result.status = RUN_PASS;
+      break;
+    }
+    if (config->blargg && blargg_done(nes, &reset_at)) {
+      result.status = read_byte(cpu, BLARGG_STATUS) ? RUN_FAIL : RUN_PASS;
+      break;
+    }
+    if (cpu->halted) {
+      result.status = RUN_JAM;
+      break;
+    }
+  }
+
+  block_cache_detach(cpu);
+  result.cycles = cpu->cycles;
+  result.pc = cpu->PC;
+  if (config->has_until) {
+    result.value = read_byte(cpu, config->until_addr);
+  }
+  if (config->blargg && blargg_valid(cpu)) {
+    result.value = read_byte(cpu, BLARGG_STATUS);
+    blargg_message(cpu, result.message);
+  }
+  return result;
+}
+
+const char *run_status_str(RunStatus status) {
+  switch (status) {
+  case RUN_PASS:
+    return "pass";
+  case RUN_TIMEOUT:
+    return "timeout";
+  case RUN_JAM:
+    return "jam";
+  case RUN_FAIL:
+    return "fail";
+  case RUN_ERROR:
+    return "error";
+  }
+  return "unknown";
+}
+
+void runner_print(FILE *out, const char *rom, const RunResult *result) {
+  if (result->status == RUN_ERROR) {
+    fprintf(out, "result=error rom=%s reason=\"%s\"\n", rom,
+            rom_error_str(result->error));
+    return;
+  }
+  fprintf(out,
+          "result=%s rom=%s cycles=%" PRIu64 " frames=%" PRIu64
+          " pc=%04X value=%02X\n",
+          run_status_str(result->status), rom, result->cycles,
+          CPU_CYCLES_TO_FRAMES(result->cycles), result->pc, result->value);
+  if (result->message[0] != '\0') {
+    fprintf(out, "message rom=%s text=\"%s\"\n", rom, result->message);
+  }
+}
+
+void runner_print_unity(FILE *out, const char *rom, const RunResult *result,
+                        RunStatus expect) {
+  if (result->status == expect) {
+    fprintf(out, "%s:0:romtest:PASS\n", rom);
+    return;
+  }
+  fprintf(out, "%s:0:romtest:FAIL: expected %s, got %s", rom,
+          run_status_str(expect), run_status_str(result->status));
+  if (result->status == RUN_ERROR) {
+    fprintf(out, " (%s)", rom_error_str(result->error));
+  } else {
+    fprintf(out, " at cycle %" PRIu64 " pc=%04X value=%02X", result->cycles,
+            result->pc, result->value);
+  }
+  if (result->message[0] != '\0') {
+    fprintf(out, ": %s", result->message);
+  }
+  fputc('\n', out);
+}
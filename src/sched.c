@@ -0,0 +1,87 @@
+#include "sched.h"
+#include <stdint.h>
+#include <string.h>
+
+void sched_init(Scheduler *sched) {
+  memset(sched->slot, SCHED_IDLE, sizeof(sched->slot));
+  sched->count = 0;
+}
+
+static void place(Scheduler *sched, u8 index, u8 id) {
+  sched->heap[index] = id;
+  sched->slot[id] = index;
+}
+
+static void sift_up(Scheduler *sched, u8 index) {
+  u8 id = sched->heap[index];
+  while (index > 0) {
+    u8 parent = (index - 1) / 2;
+    if (sched->time[sched->heap[parent]] <= sched->time[id]) {
+      break;
+    }
+    place(sched, index, sched->heap[parent]);
+    index = parent;
+  }
+  place(sched, index, id);
+}
+
+static void sift_down(Scheduler *sched, u8 index) {
+  u8 id = sched->heap[index];
+  for (;;) {
+    u8 child = 2 * index + 1;
+    if (child >= sched->count) {
+      break;
+    }
+    if (child + 1 < sched->count &&
+        sched->time[sched->heap[child + 1]] < sched->time[sched->heap[child]]) {
+      child++;
+    }
+    if (sched->time[id] <= sched->time[sched->heap[child]]) {
+      break;
+    }
+    place(sched, index, sched->heap[child]);
+    index = child;
+  }
+  place(sched, index, id);
+}
+
+void sched_set(Scheduler *sched, u8 id, u64 time) {
+  u8 index = sched->slot[id];
+  if (index == SCHED_IDLE) {
+    index = sched->count++;
+    place(sched, index, id);
+  }
+  sched->time[id] = time;
+  // Only one of these moves it, whichever way restores the order.
+  sift_up(sched, index);
+  sift_down(sched, sched->slot[id]);
+}
+
+void sched_cancel(Scheduler *sched, u8 id) {
+  u8 index = sched->slot[id];
+  if (index == SCHED_IDLE) {
+    return;
+  }
+  sched->slot[id] = SCHED_IDLE;
+  u8 last = sched->heap[--sched->count];
+  if (last == id) {
+    return;
+  }
+  // The last event fills the hole and moves up or down from there.
+  place(sched, index, last);
+  sift_up(sched, index);
+  sift_down(sched, sched->slot[last]);
+}
+
+u64 sched_next(const Scheduler *sched) {
+  return sched->count ? sched->time[sched->heap[0]] : UINT64_MAX;
+}
+
+u8 sched_pop(Scheduler *sched, u64 now) {
+  if (!sched->count || sched->time[sched->heap[0]] > now) {
+    return SCHED_IDLE;
+  }
+  u8 id = sched->heap[0];
+  sched_cancel(sched, id);
+  return id;
+}
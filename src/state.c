@@ -0,0 +1,328 @@
+#include "state.h"
+#include "block.h"
+#include "bus.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHUNK_ALIGN 8
+#define CHR_RAM_WINDOW 0x80000000u // Saved windows with this set are CHR RAM
+
+typedef struct {
+  char magic[4];
+  u32 version;
+  u32 size; // Header and chunks
+  // The cartridge it was saved with, as far as the state depends on it.
+  u32 prg_size;
+  u32 chr_size;
+  u16 mapper;
+} Header;
+
+typedef struct {
+  char tag[4];
+  u32 size;
+} Chunk;
+
+// Where the PPU's windows point, as offsets into the memory behind them.
+typedef struct {
+  u32 chr[8];       // Into the cartridge's CHR, or CHR RAM with CHR_RAM_WINDOW
+  u32 nametable[4]; // Into ciram
+} Windows;
+
+// The parts of NES saved exactly as they are in memory.
+typedef struct {
+  char tag[4];
+  u32 offset;
+  u32 size;
+  u8 paged; // Only ever written through write_byte, see state_update
+} Region;
+
+#define FIELD(tag, field, paged)                                               \
+  {tag, offsetof(NES, field), sizeof(((NES *)0)->field), paged}
+#define RANGE(tag, first, end)                                                 \
+  {tag, offsetof(NES, first), offsetof(NES, end) - offsetof(NES, first), 0}
+
+static const Region REGIONS[] = {
+    RANGE("CPU ", cpu.A, cpu.deadline), // Registers and the cycle count
+    FIELD("RAM ", cpu.ram, 1),
+    RANGE("PPU ", ppu.ctrl, ppu.chr_ram_tiles),
+    RANGE("APU ", apu.pulse, apu.bus),
+    RANGE("MAPR", mapper.bank, mapper.write), // Banks are mapped from these
+    FIELD("SCHD", sched, 0),
+    FIELD("PRAM", prg_ram, 1),
+};
+#define REGION_COUNT (sizeof(REGIONS) / sizeof(REGIONS[0]))
+
+static const char MAGIC[4] = {'M', 'N', 'S', 'T'};
+static const char WINDOWS_TAG[4] = {'P', 'W', 'I', 'N'};
+
+static u32 chunk_size(u32 size) {
+  return sizeof(Chunk) + ((size + CHUNK_ALIGN - 1) & ~(CHUNK_ALIGN - 1));
+}
+
+u32 state_size(void) {
+  u32 size = sizeof(Header) + chunk_size(sizeof(Windows));
+  for (u32 i = 0; i < REGION_COUNT; i++) {
+    size += chunk_size(REGIONS[i].size);
+  }
+  return size;
+}
+
+static u8 *put_chunk(u8 *out, const char *tag, const void *data, u32 size) {
+  Chunk chunk = {.size = size};
+  memcpy(chunk.tag, tag, sizeof(chunk.tag));
+  memcpy(out, &chunk, sizeof(chunk));
+  memcpy(out + sizeof(chunk), data, size);
+  u32 end = chunk_size(size);
+  memset(out + sizeof(chunk) + size, 0, end - sizeof(chunk) - size);
+  return out + end;
+}
+
+static void save_windows(const NES *nes, Windows *windows) {
+  const PPU *ppu = &nes->ppu;
+  for (u32 i = 0; i < 8; i++) {
+    if (ppu->chr[i] >= ppu->chr_ram &&
+        ppu->chr[i] < ppu->chr_ram + sizeof(ppu->chr_ram)) {
+      windows->chr[i] = CHR_RAM_WINDOW | (ppu->chr[i] - ppu->chr_ram);
+    } else {
+      windows->chr[i] = ppu->chr[i] - nes->rom.chr;
+    }
+  }
+  for (u32 i = 0; i < 4; i++) {
+    windows->nametable[i] = ppu->nametable[i] - ppu->ciram;
+  }
+}
+
+void state_save(const NES *nes, u8 *buf) {
+  Header header = {
+      .version = STATE_VERSION,
+      .size = state_size(),
+      .prg_size = nes->rom.prg_size,
+      .chr_size = nes->rom.chr_size,
+      .mapper = nes->rom.mapper,
+  };
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  memcpy(buf, &header, sizeof(header));
+  u8 *out = buf + sizeof(header);
+
+  for (u32 i = 0; i < REGION_COUNT; i++) {
+    out = put_chunk(out, REGIONS[i].tag, (const u8 *)nes + REGIONS[i].offset,
+                    REGIONS[i].size);
+  }
+
+  Windows windows;
+  save_windows(nes, &windows);
+  put_chunk(out, WINDOWS_TAG, &windows, sizeof(windows));
+}
+
+// Copies the pages of a paged region that the CPU has written to into its
+// saved copy. Pages are found through the bus, whatever is mapped where.
+static void update_pages(const NES *nes, const Region *region, u8 *saved) {
+  const Bus *bus = &nes->cpu.bus;
+  const u8 *data = (const u8 *)nes + region->offset;
+  for (u32 word = 0; word < 4; word++) {
+    for (u64 bits = bus->dirty[word]; bits; bits &= bits - 1) {
+      const u8 *mem = bus->write[word * 64 + __builtin_ctzll(bits)];
+      if (mem >= data && mem < data + region->size) {
+        memcpy(saved + (mem - data), mem, 256);
+      }
+    }
+  }
+}
+
+void state_update(NES *nes, u8 *buf) {
+  u8 *out = buf + sizeof(Header);
+  for (u32 i = 0; i < REGION_COUNT; i++) {
+    const Region *region = &REGIONS[i];
+    if (region->paged) {
+      update_pages(nes, region, out + sizeof(Chunk));
+    } else {
+      memcpy(out + sizeof(Chunk), (const u8 *)nes + region->offset,
+             region->size);
+    }
+    out += chunk_size(region->size);
+  }
+  Windows windows;
+  save_windows(nes, &windows);
+  memcpy(out + sizeof(Chunk), &windows, sizeof(windows));
+  bus_clear_dirty(&nes->cpu.bus);
+}
+
+static int windows_valid(const NES *nes, const Windows *windows) {
+  for (u32 i = 0; i < 8; i++) {
+    u32 offset = windows->chr[i] & ~CHR_RAM_WINDOW;
+    u32 size = windows->chr[i] & CHR_RAM_WINDOW ? sizeof(nes->ppu.chr_ram)
+                                                : nes->rom.chr_size;
+    // Tiles are decoded in whole 1 KiB banks, so windows can't start
+    // partway into one.
+    if ((offset & 0x3FF) || offset > size || size - offset < 0x400) {
+      return 0;
+    }
+  }
+  for (u32 i = 0; i < 4; i++) {
+    if (windows->nametable[i] > sizeof(nes->ppu.ciram) - 0x400) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void restore_windows(NES *nes, const Windows *windows) {
+  PPU *ppu = &nes->ppu;
+  for (u8 i = 0; i < 8; i++) {
+    u32 offset = windows->chr[i] & ~CHR_RAM_WINDOW;
+    if (windows->chr[i] & CHR_RAM_WINDOW) {
+      ppu_map_chr(ppu, i, ppu->chr_ram + offset,
+                  ppu->chr_ram_tiles + offset * 4);
+    } else {
+      ppu_map_chr(ppu, i, nes->rom.chr + offset,
+                  rom_chr_tiles(&nes->rom, offset / 0x400, 0x400));
+    }
+  }
+  for (u32 i = 0; i < 4; i++) {
+    ppu->nametable[i] = ppu->ciram + windows->nametable[i];
+  }
+}
+
+StateError state_load(NES *nes, const u8 *buf, u32 size) {
+  Header header;
+  if (size < sizeof(header)) {
+    return STATE_ERR_FORMAT;
+  }
+  memcpy(&header, buf, sizeof(header));
+  if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.size > size) {
+    return STATE_ERR_FORMAT;
+  }
+  if (header.version != STATE_VERSION) {
+    return STATE_ERR_VERSION;
+  }
+  const Rom *rom = &nes->rom;
+  if (header.prg_size != rom->prg_size || header.chr_size != rom->chr_size ||
+      header.mapper != rom->mapper) {
+    return STATE_ERR_ROM;
+  }
+
+  // Find every chunk before touching nes, so a bad state changes nothing.
+  const u8 *regions[REGION_COUNT] = {0};
+  Windows windows;
+  u8 have_windows = 0;
+  u32 at = sizeof(header);
+  while (header.size - at >= sizeof(Chunk)) {
+    Chunk chunk;
+    memcpy(&chunk, buf + at, sizeof(chunk));
+    if (chunk.size > header.size - at - sizeof(chunk)) {
+      return STATE_ERR_FORMAT;
+    }
+    const u8 *data = buf + at + sizeof(chunk);
+    for (u32 i = 0; i < REGION_COUNT; i++) {
+      if (memcmp(chunk.tag, REGIONS[i].tag, sizeof(chunk.tag)) == 0) {
+        if (chunk.size != REGIONS[i].size) {
+          return STATE_ERR_FORMAT;
+        }
+        regions[i] = data;
+      }
+    }
+    if (memcmp(chunk.tag, WINDOWS_TAG, sizeof(chunk.tag)) == 0) {
+      if (chunk.size != sizeof(windows)) {
+        return STATE_ERR_FORMAT;
+      }
+      memcpy(&windows, data, sizeof(windows));
+      have_windows = 1;
+    }
+    at += chunk_size(chunk.size);
+  }
+  for (u32 i = 0; i < REGION_COUNT; i++) {
+    if (!regions[i]) {
+      return STATE_ERR_FORMAT;
+    }
+  }
+  if (!have_windows || !windows_valid(nes, &windows)) {
+    return STATE_ERR_FORMAT;
+  }
+
+  for (u32 i = 0; i < REGION_COUNT; i++) {
+    memcpy((u8 *)nes + REGIONS[i].offset, regions[i], REGIONS[i].size);
+  }
+  restore_windows(nes, &windows);
+  mapper_map(&nes->mapper);
+  // Samples already made belong to the run being left.
+  blip_clear(&nes->apu.blip);
+  PPU *ppu = &nes->ppu;
+  if (ppu->chr_writable) {
+    chr_decode(ppu->chr_ram, sizeof(ppu->chr_ram), ppu->chr_ram_tiles);
+  }
+  // RAM changed behind write_byte's back, so blocks decoded from it are stale
+  // and the next checkpoint has to take every page.
+  CPU *cpu = &nes->cpu;
+  memset(cpu->bus.dirty, 0xFF, sizeof(cpu->bus.dirty));
+  for (u32 page = 0; page < 256; page++) {
+    if (cpu->bus.code[page]) {
+      block_invalidate_page(cpu, page);
+    }
+  }
+  return STATE_OK;
+}
+
+StateError state_save_file(const NES *nes, const char *path) {
+  u32 size = state_size();
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return STATE_ERR_OPEN;
+  }
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    return STATE_ERR_OPEN;
+  }
+  u8 *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return STATE_ERR_OPEN;
+  }
+  state_save(nes, map);
+  munmap(map, size);
+  return STATE_OK;
+}
+
+StateError state_load_file(NES *nes, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return STATE_ERR_OPEN;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return STATE_ERR_OPEN;
+  }
+  if (st.st_size == 0 || st.st_size > UINT32_MAX) {
+    close(fd);
+    return STATE_ERR_FORMAT;
+  }
+  u8 *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return STATE_ERR_OPEN;
+  }
+  StateError err = state_load(nes, map, st.st_size);
+  munmap(map, st.st_size);
+  return err;
+}
+
+const char *state_error_str(StateError err) {
+  switch (err) {
+  case STATE_OK:
+    return "ok";
+  case STATE_ERR_OPEN:
+    return "error opening or mapping the file";
+  case STATE_ERR_FORMAT:
+    return "not a save state, or a damaged one";
+  case STATE_ERR_VERSION:
+    return "saved by an incompatible version";
+  case STATE_ERR_ROM:
+    return "saved with a different cartridge";
+  }
+  return "unknown";
+}
@@ -0,0 +1,129 @@
+#include "tile.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Spreads the bits of a bitplane byte into one byte per pixel, the leftmost
+// (most significant) pixel in the lowest byte. The multiply places bit 7 - i
+// at the top of byte i without carries since the copies never overlap.
+static u64 spread(u8 plane) {
+  return ((plane * 0x8040201008040201ull) & 0x8080808080808080ull) >> 7;
+}
+
+static void decode_scalar(const u8 *lo, const u8 *hi, const u8 *palette,
+                          u32 count, u8 *out) {
+  for (u32 i = 0; i < count; i++) {
+    u64 pixels = spread(lo[i]) | spread(hi[i]) << 1 |
+                 (palette[i] << 2) * 0x0101010101010101ull;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(out + i * 8, &pixels, 8);
+#else
+    for (u32 px = 0; px < 8; px++) {
+      out[i * 8 + px] = pixels >> (px * 8);
+    }
+#endif
+  }
+}
+
+#ifdef __SSE2__
+// Spreads eight bytes into four registers of two rows each, every byte
+// repeated across its row's eight lanes.
+static void splat8_sse2(const u8 *in, __m128i out[4]) {
+  __m128i x = _mm_loadl_epi64((const __m128i *)in);
+  __m128i pairs = _mm_unpacklo_epi8(x, x);
+  __m128i quads_lo = _mm_unpacklo_epi16(pairs, pairs);
+  __m128i quads_hi = _mm_unpackhi_epi16(pairs, pairs);
+  out[0] = _mm_unpacklo_epi32(quads_lo, quads_lo);
+  out[1] = _mm_unpackhi_epi32(quads_lo, quads_lo);
+  out[2] = _mm_unpacklo_epi32(quads_hi, quads_hi);
+  out[3] = _mm_unpackhi_epi32(quads_hi, quads_hi);
+}
+
+// Eight rows per iteration: each plane byte is spread across its row and
+// tested against a one-bit-per-lane mask.
+static void decode_sse2(const u8 *lo, const u8 *hi, const u8 *palette,
+                        u32 count, u8 *out) {
+  const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8,
+                                    16, 32, 64, -128);
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i two = _mm_set1_epi8(2);
+  u32 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i l[4], h[4], p[4];
+    splat8_sse2(lo + i, l);
+    splat8_sse2(hi + i, h);
+    splat8_sse2(palette + i, p);
+    for (u32 r = 0; r < 4; r++) {
+      __m128i cl = _mm_cmpeq_epi8(_mm_and_si128(l[r], bits), bits);
+      __m128i ch = _mm_cmpeq_epi8(_mm_and_si128(h[r], bits), bits);
+      __m128i pixels = _mm_or_si128(_mm_and_si128(cl, one),
+                                    _mm_and_si128(ch, two));
+      pixels = _mm_or_si128(pixels, _mm_slli_epi16(p[r], 2));
+      _mm_storeu_si128((__m128i *)(out + (i + r * 2) * 8), pixels);
+    }
+  }
+  decode_scalar(lo + i, hi + i, palette + i, count - i, out + i * 8);
+}
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+// Four rows per register: the four bytes of each input are broadcast to both
+// lanes and shuffled out to eight copies each.
+__attribute__((target("avx2"))) static void
+decode_avx2(const u8 *lo, const u8 *hi, const u8 *palette, u32 count,
+            u8 *out) {
+  const __m256i rows = _mm256_set_epi8(
+      3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 0,
+      0, 0, 0, 0, 0, 0, 0);
+  const __m256i bits = _mm256_set1_epi64x(0x0102040810204080ll);
+  const __m256i one = _mm256_set1_epi8(1);
+  const __m256i two = _mm256_set1_epi8(2);
+  u32 i = 0;
+  for (; i + 4 <= count; i += 4) {
+    u32 l4, h4, p4;
+    memcpy(&l4, lo + i, 4);
+    memcpy(&h4, hi + i, 4);
+    memcpy(&p4, palette + i, 4);
+    __m256i l = _mm256_shuffle_epi8(_mm256_set1_epi32(l4), rows);
+    __m256i h = _mm256_shuffle_epi8(_mm256_set1_epi32(h4), rows);
+    __m256i p = _mm256_slli_epi16(
+        _mm256_shuffle_epi8(_mm256_set1_epi32(p4), rows), 2);
+    l = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(l, bits), bits),
+                         one);
+    h = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(h, bits), bits),
+                         two);
+    _mm256_storeu_si256((__m256i *)(out + i * 8),
+                        _mm256_or_si256(_mm256_or_si256(l, h), p));
+  }
+  decode_scalar(lo + i, hi + i, palette + i, count - i, out + i * 8);
+}
+#endif
+
+static const TileDecoder DECODERS[] = {
+    {"scalar", decode_scalar},
+#ifdef __SSE2__
+    {"sse2", decode_sse2},
+#endif
+#if defined(__x86_64__) && defined(__GNUC__)
+    {"avx2", decode_avx2},
+#endif
+};
+
+u32 tile_decoders(const TileDecoder **list) {
+  u32 count = sizeof(DECODERS) / sizeof(DECODERS[0]);
+#if defined(__x86_64__) && defined(__GNUC__)
+  if (!__builtin_cpu_supports("avx2")) {
+    count--;
+  }
+#endif
+  *list = DECODERS;
+  return count;
+}
+
+TileDecodeFunc tile_decoder(void) {
+  const TileDecoder *list;
+  u32 count = tile_decoders(&list);
+  return list[count - 1].decode;
+}
@@ -0,0 +1,137 @@
+#include "trace.h"
+#include "instructions.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAME_ENTRY(op, func, length, cycles) [op] = #op,
+// Opcode names as the enum spells them, mnemonic then addressing mode.
+static const char *const NAMES[256] = {INSTRUCTION_LIST(NAME_ENTRY)};
+#undef NAME_ENTRY
+
+static const char MAGIC[4] = {'M', 'N', 'T', 'R'};
+
+int trace_init(Trace *trace, u32 capacity) {
+  trace->entries = NULL;
+  if (capacity > TRACE_MAX_CAPACITY) {
+    return -1; // Rounding up would overflow
+  }
+  u32 size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  trace->entries = malloc(size * sizeof(TraceEntry));
+  trace->mask = size - 1;
+  trace->count = 0;
+  return trace->entries ? 0 : -1;
+}
+
+void trace_free(Trace *trace) {
+  free(trace->entries);
+  trace->entries = NULL;
+}
+
+int trace_save(const Trace *trace, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return -1;
+  }
+  u64 held = trace->count < trace->mask + 1ull ? trace->count
+                                               : trace->mask + 1ull;
+  fwrite(MAGIC, 1, sizeof(MAGIC), file);
+  fwrite(&held, sizeof(held), 1, file);
+  for (u64 i = trace->count - held; i < trace->count; i++) {
+    fwrite(&trace->entries[i & trace->mask], sizeof(TraceEntry), 1, file);
+  }
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+int trace_print(FILE *out, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return -1;
+  }
+  char magic[4];
+  u64 held;
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+      memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      fread(&held, sizeof(held), 1, file) != 1) {
+    fclose(file);
+    return -1;
+  }
+  TraceEntry entry;
+  char line[TRACE_LINE_SIZE];
+  for (u64 i = 0; i < held && fread(&entry, sizeof(entry), 1, file) == 1;
+       i++) {
+    trace_format(line, &entry);
+    fprintf(out, "%s\n", line);
+  }
+  fclose(file);
+  return 0;
+}
+
+// Writes the operand as nestest.log shows it and returns the instruction's
+// length in bytes.
+static u32 format_operand(char *out, const char *mode, const TraceEntry *e) {
+  u8 lo = e->bytes[1];
+  u16 word = e->bytes[2] << 8 | lo;
+  out[0] = '\0';
+  if (strcmp(mode, "IMP") == 0) {
+    return 1;
+  } else if (strcmp(mode, "ACC") == 0) {
+    strcpy(out, "A");
+    return 1;
+  } else if (strcmp(mode, "IMM") == 0) {
+    sprintf(out, "#$%02X", lo);
+  } else if (strcmp(mode, "ZP") == 0) {
+    sprintf(out, "$%02X", lo);
+  } else if (strcmp(mode, "ZPX") == 0) {
+    sprintf(out, "$%02X,X", lo);
+  } else if (strcmp(mode, "ZPY") == 0) {
+    sprintf(out, "$%02X,Y", lo);
+  } else if (strcmp(mode, "INDX") == 0) {
+    sprintf(out, "($%02X,X)", lo);
+  } else if (strcmp(mode, "INDY") == 0) {
+    sprintf(out, "($%02X),Y", lo);
+  } else if (strcmp(mode, "REL") == 0) {
+    sprintf(out, "$%04X", (u16)(e->pc + 2 + (s8)lo));
+  } else if (strcmp(mode, "ABS") == 0) {
+    sprintf(out, "$%04X", word);
+    return 3;
+  } else if (strcmp(mode, "ABSX") == 0) {
+    sprintf(out, "$%04X,X", word);
+    return 3;
+  } else if (strcmp(mode, "ABSY") == 0) {
+    sprintf(out, "$%04X,Y", word);
+    return 3;
+  } else if (strcmp(mode, "IND") == 0) {
+    sprintf(out, "($%04X)", word);
+    return 3;
+  }
+  return 2;
+}
+
+void trace_format(char *line, const TraceEntry *entry) {
+  const char *name = NAMES[entry->bytes[0]];
+  char bytes[9] = "";
+  char text[33] = "???";
+  u32 length = 1;
+  if (name) {
+    char operand[16];
+    length = format_operand(operand, name + 4, entry);
+    snprintf(text, sizeof(text), "%.3s%s%s", name, operand[0] ? " " : "",
+             operand);
+  }
+  char *out = bytes;
+  for (u32 i = 0; i < length; i++) {
+    out += sprintf(out, "%s%02X", i ? " " : "", entry->bytes[i]);
+  }
+
+  u64 cycles = (u64)entry->cycles_hi << 32 | entry->cycles;
+  u64 dots = cycles * 3;
+  snprintf(line, TRACE_LINE_SIZE,
+           "%04X  %-8s  %-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X "
+           "PPU:%3u,%3u CYC:%" PRIu64,
+           entry->pc, bytes, text, entry->a, entry->x, entry->y, entry->p,
+           entry->s, (u32)(dots / 341 % 262), (u32)(dots % 341), cycles);
+}
@@ -0,0 +1,160 @@
+#include "apu.h"
+#include "bus.h"
+#include "unity.h"
+#include <string.h>
+
+#define SECOND APU_CLOCK_RATE
+
+Apu apu;
+Bus bus;
+u8 prg[0x4000];
+s16 samples[APU_SAMPLE_RATE];
+
+void setUp(void) {
+  memset(prg, 0, sizeof(prg));
+  bus_init(&bus);
+  bus_map(&bus, 0xC0, 0xFF, prg, sizeof(prg), 0);
+  TEST_ASSERT_EQUAL_INT(0, apu_power_on(&apu, &bus, APU_SAMPLE_RATE));
+}
+
+void tearDown(void) { apu_free(&apu); }
+
+static void test_length_counters(void) {
+  apu_write(&apu, 0x4015, APU_STATUS_PULSE1 | APU_STATUS_NOISE);
+  apu_write(&apu, 0x4000, 0x10); // Constant volume 0, counting down
+  apu_write(&apu, 0x4003, 0x18); // Length 2
+  apu_write(&apu, 0x400F, 0x18); // Also 2, but halted below
+  apu_write(&apu, 0x400C, 0x20);
+  apu_write(&apu, 0x4007, 0x18); // Pulse 2 is off, so it doesn't load
+  TEST_ASSERT_EQUAL_HEX8(APU_STATUS_PULSE1 | APU_STATUS_NOISE,
+                         apu_read_status(&apu));
+
+  // Two half frames, at the second and fourth steps.
+  apu_run_to(&apu, 29830);
+  TEST_ASSERT_EQUAL_HEX8(APU_STATUS_NOISE, apu_read_status(&apu) & 0x1F);
+  apu_write(&apu, 0x4015, 0);
+  TEST_ASSERT_EQUAL_HEX8(0, apu_read_status(&apu) & 0x1F);
+}
+
+static void test_frame_interrupt(void) {
+  apu_run_to(&apu, 29829);
+  TEST_ASSERT_EQUAL_HEX8(0, apu_read_status(&apu));
+  apu_run_to(&apu, 29830);
+  TEST_ASSERT_EQUAL_HEX8(APU_STATUS_FRAME_IRQ, apu_read_status(&apu));
+  TEST_ASSERT_EQUAL_HEX8(0, apu_read_status(&apu)); // Reading acknowledges
+
+  apu_write(&apu, 0x4017, 0x40); // Inhibited
+  apu_run_to(&apu, 4 * 29830);
+  TEST_ASSERT_EQUAL_HEX8(0, apu_read_status(&apu));
+  apu_write(&apu, 0x4017, 0x80); // The 5-step sequence never raises it
+  apu_run_to(&apu, 8 * 29830);
+  TEST_ASSERT_EQUAL_HEX8(0, apu_read_status(&apu));
+}
+
+static u32 rising_edges(const s16 *wave, u32 count) {
+  u32 edges = 0;
+  for (u32 i = 1; i < count; i++) {
+    edges += wave[i - 1] < 0 && wave[i] >= 0;
+  }
+  return edges;
+}
+
+static void test_pulse_plays_its_pitch(void) {
+  apu_write(&apu, 0x4015, APU_STATUS_PULSE1);
+  apu_write(&apu, 0x4000, 0xBF); // 50% duty, constant volume 15
+  apu_write(&apu, 0x4002, 0xFD); // 1789773 / (16 * 254) = 440 Hz
+  apu_write(&apu, 0x4003, 0x08); // Length 254, long enough
+  apu_run_to(&apu, SECOND);
+
+  u32 count = apu_read_samples(&apu, samples, APU_SAMPLE_RATE);
+  // Whole blocks only, and no more than the buffer keeps.
+  u32 block = APU_SAMPLE_RATE * APU_BLOCK_CYCLES / APU_CLOCK_RATE;
+  TEST_ASSERT_UINT32_WITHIN(APU_BUFFER_BLOCKS, APU_BUFFER_BLOCKS * block,
+                            count);
+  u32 seconds_kept = 1000 * count / APU_SAMPLE_RATE;
+  TEST_ASSERT_UINT32_WITHIN(2, 440 * seconds_kept / 1000,
+                            rising_edges(samples, count));
+  s16 low = 0;
+  s16 high = 0;
+  for (u32 i = count / 2; i < count; i++) {
+    low = samples[i] < low ? samples[i] : low;
+    high = samples[i] > high ? samples[i] : high;
+  }
+  // Band-limited, so only a little ringing past the 15 * 247 swing.
+  TEST_ASSERT_INT32_WITHIN(15 * 247 / 4, 15 * 247, high - low);
+}
+
+static void test_dmc_plays_a_sample(void) {
+  memset(prg, 0xFF, 2); // Every bit up, from $C000
+  apu_write(&apu, 0x4010, 0x8F); // IRQ at the end, the fastest rate
+  apu_write(&apu, 0x4011, 0x10);
+  apu_write(&apu, 0x4012, 0x00);
+  apu_write(&apu, 0x4013, 0x00); // 1 byte
+  apu_write(&apu, 0x4015, APU_STATUS_DMC);
+  // The byte is fetched straight away, so the bytes run out at once.
+  TEST_ASSERT_EQUAL_HEX8(APU_STATUS_DMC_IRQ, apu_read_status(&apu));
+
+  apu_run_to(&apu, 54 * 20);
+  TEST_ASSERT_EQUAL_UINT8(0x10 + 2 * 8, apu.dmc.level);
+  apu_write(&apu, 0x4015, 0);
+  TEST_ASSERT_EQUAL_HEX8(0, apu_read_status(&apu));
+}
+
+static void write_song(Apu *target) {
+  static const u16 WRITES[][2] = {
+      {0x4015, 0x1F}, {0x4000, 0x9F}, {0x4001, 0xA1}, {0x4002, 0x40},
+      {0x4003, 0x50}, {0x4004, 0x58}, {0x4006, 0x20}, {0x4007, 0x01},
+      {0x4008, 0x20}, {0x400A, 0x90}, {0x400B, 0x30}, {0x400C, 0x14},
+      {0x400E, 0x83}, {0x400F, 0x40}, {0x4010, 0x8E}, {0x4013, 0x02},
+      {0x4015, 0x1F},
+  };
+  for (u32 i = 0; i < sizeof(WRITES) / sizeof(WRITES[0]); i++) {
+    apu_write(target, WRITES[i][0], WRITES[i][1]);
+  }
+}
+
+static void test_audio_off_keeps_what_the_cpu_sees(void) {
+  static Apu quiet;
+  TEST_ASSERT_EQUAL_INT(0, apu_power_on(&quiet, &bus, APU_SAMPLE_RATE));
+  TEST_ASSERT_EQUAL_INT(0, apu_set_audio(&quiet, APU_AUDIO_OFF));
+  write_song(&apu);
+  write_song(&quiet);
+
+  for (u64 cycle = 1000; cycle < SECOND / 2; cycle += 1000 + cycle % 777) {
+    apu_run_to(&apu, cycle);
+    apu_run_to(&quiet, cycle);
+    TEST_ASSERT_EQUAL_HEX8(apu_read_status(&apu), apu_read_status(&quiet));
+    TEST_ASSERT_EQUAL_UINT16(apu.pulse[0].period, quiet.pulse[0].period);
+    TEST_ASSERT_EQUAL_UINT16(apu.dmc.addr, quiet.dmc.addr);
+    TEST_ASSERT_EQUAL_UINT64(apu.dmc.next, quiet.dmc.next);
+    if (cycle % 7 == 0) {
+      apu_write(&apu, 0x4015, 0x1F); // Restarts the DMC once it's done
+      apu_write(&quiet, 0x4015, 0x1F);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, apu_read_samples(&quiet, samples, 1));
+
+  // Sound comes back from the next block, at a quarter of the rate when
+  // decimated.
+  TEST_ASSERT_EQUAL_INT(0, apu_set_audio(&quiet, APU_AUDIO_DECIMATED));
+  apu_run_to(&quiet, quiet.block_start + 2 * APU_BLOCK_CYCLES);
+  u32 block = APU_SAMPLE_RATE / APU_DECIMATION * APU_BLOCK_CYCLES /
+              APU_CLOCK_RATE;
+  u32 count = apu_read_samples(&quiet, samples, 4 * block);
+  TEST_ASSERT_UINT32_WITHIN(2, 2 * block, count);
+  apu_free(&quiet);
+
+  // Switching the sound off drops what wasn't read yet too.
+  TEST_ASSERT_EQUAL_INT(0, apu_set_audio(&apu, APU_AUDIO_OFF));
+  TEST_ASSERT_EQUAL_UINT32(0, apu_read_samples(&apu, samples, 1));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_length_counters);
+  RUN_TEST(test_frame_interrupt);
+  RUN_TEST(test_pulse_plays_its_pitch);
+  RUN_TEST(test_dmc_plays_a_sample);
+  RUN_TEST(test_audio_off_keeps_what_the_cpu_sees);
+  return UNITY_END();
+}
@@ -0,0 +1,74 @@
+#include "blip.h"
+#include "unity.h"
+
+#define CLOCKS 1000
+#define RATE 100 // A sample every 10 clocks at 1000 clocks a second
+
+Blip blip;
+s16 samples[256];
+
+void setUp(void) {
+  TEST_ASSERT_EQUAL_INT(0, blip_init(&blip, CLOCKS, RATE, 256));
+}
+
+void tearDown(void) { blip_free(&blip); }
+
+static void test_step_settles_at_its_delta(void) {
+  blip_add_delta(&blip, 305, 1000);
+  TEST_ASSERT_EQUAL_UINT32(0, blip_read(&blip, samples, 256));
+  blip_end_block(&blip, CLOCKS);
+  TEST_ASSERT_EQUAL_UINT32(RATE, blip_read(&blip, samples, 256));
+
+  // Nothing before the step and the kernel's delay, then a band-limited
+  // edge that overshoots a little and settles.
+  for (u32 i = 0; i < 30; i++) {
+    TEST_ASSERT_EQUAL_INT16(0, samples[i]);
+  }
+  s16 peak = 0;
+  for (u32 i = 30; i < 60; i++) {
+    peak = samples[i] > peak ? samples[i] : peak;
+  }
+  TEST_ASSERT_INT16_WITHIN(150, 1000, peak);
+  TEST_ASSERT_INT16_WITHIN(30, 1000, samples[50]);
+  // The high-pass filter then pulls it back towards 0.
+  TEST_ASSERT_TRUE(samples[99] < samples[50]);
+}
+
+static void test_blocks_resample_evenly(void) {
+  // A square wave with a period of 40 clocks, 4 samples, over blocks of odd
+  // sizes.
+  u32 total = 0;
+  u32 read = 0;
+  u32 time = 0;
+  s32 level = 0;
+  s16 low = 0;
+  s16 high = 0;
+  for (u32 block = 0; block < 20; block++) {
+    u32 clocks = 97 + block * 13;
+    for (; time < clocks; time += 20) {
+      s32 next = level ? 0 : 2000;
+      blip_add_delta(&blip, time, next - level);
+      level = next;
+    }
+    time -= clocks;
+    blip_end_block(&blip, clocks);
+    total += clocks;
+    u32 count = blip_read(&blip, samples, 256);
+    read += count;
+    for (u32 i = 0; i < count && block > 2; i++) {
+      low = samples[i] < low ? samples[i] : low;
+      high = samples[i] > high ? samples[i] : high;
+    }
+  }
+  // Every clock ends up in exactly one sample, whatever the block sizes.
+  TEST_ASSERT_UINT32_WITHIN(1, total / 10, read);
+  TEST_ASSERT_TRUE(high - low > 1500);
+  TEST_ASSERT_TRUE(high - low < 2500);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_step_settles_at_its_delta);
+  RUN_TEST(test_blocks_resample_evenly);
+  return UNITY_END();
+}
@@ -0,0 +1,184 @@
+#include "block.h"
+#include "bus.h"
+#include "emu.h"
+#include "opcode.h"
+#include "unity.h"
+
+CPU cpu;
+u8 mem[0x10000];
+
+#define JAM 0x02
+
+void setUp(void) {
+  set_status(&cpu, 0b00100000);
+  cpu.A = 0;
+  cpu.X = 0;
+  cpu.Y = 0;
+  cpu.S = 0xFF;
+  cpu.PC = 0x0200;
+  cpu.halted = 0;
+  cpu.cycles = 0;
+  for (int i = 0; i < 0x10000; i++) {
+    mem[i] = 0;
+  }
+  bus_init(&cpu.bus);
+  bus_map(&cpu.bus, 0x00, 0xFF, mem, sizeof(mem), 1);
+  block_cache_attach(&cpu);
+}
+
+void tearDown(void) { block_cache_detach(&cpu); }
+
+// LDX #$00; loop: TXA; ADC $10; STA $10; STA $0300,X; INX; BNE loop; INC $11;
+// JMP $0200
+static const u8 SUM_LOOP[] = {0xA2, 0x00, 0x8A, 0x65, 0x10, 0x85, 0x10,
+                              0x9D, 0x00, 0x03, 0xE8, 0xD0, 0xF5, 0xE6,
+                              0x11, 0x4C, 0x00, 0x02};
+
+static void load(const u8 *code, u32 size) {
+  for (u32 i = 0; i < size; i++) {
+    mem[0x0200 + i] = code[i];
+  }
+}
+
+static void test_matches_interpreter(void) {
+  load(SUM_LOOP, sizeof(SUM_LOOP));
+  run_until(&cpu, 123457);
+  CPU blocks = cpu;
+  u8 sum = mem[0x10];
+  u8 carries = mem[0x11];
+
+  setUp();
+  block_cache_detach(&cpu);
+  load(SUM_LOOP, sizeof(SUM_LOOP));
+  run_until(&cpu, 123457);
+  TEST_ASSERT_EQUAL_HEX16(cpu.PC, blocks.PC);
+  TEST_ASSERT_EQUAL_HEX8(cpu.A, blocks.A);
+  TEST_ASSERT_EQUAL_HEX8(cpu.X, blocks.X);
+  TEST_ASSERT_EQUAL_HEX8(get_status(&cpu), get_status(&blocks));
+  TEST_ASSERT_EQUAL_UINT64(cpu.cycles, blocks.cycles);
+  TEST_ASSERT_EQUAL_HEX8(mem[0x10], sum);
+  TEST_ASSERT_EQUAL_HEX8(mem[0x11], carries);
+}
+
+static void test_store_into_running_block(void) {
+  // LDA #INX; STA $0206; NOP; NOP; JAM -- the second NOP becomes INX after
+  // the block holding it has already been decoded.
+  const u8 code[] = {0xA9, INX_IMP, 0x8D, 0x06, 0x02, 0xEA, 0xEA, JAM};
+  load(code, sizeof(code));
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x01, cpu.X);
+  TEST_ASSERT_EQUAL_HEX16(0x0207, cpu.PC);
+}
+
+static void test_patch_between_runs(void) {
+  const u8 code[] = {0xE8, JAM}; // INX; JAM
+  load(code, sizeof(code));
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x01, cpu.X);
+
+  write_byte(&cpu, 0x0200, INY_IMP);
+  cpu.PC = 0x0200;
+  cpu.halted = 0;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x01, cpu.X);
+  TEST_ASSERT_EQUAL_HEX8(0x01, cpu.Y);
+}
+
+static void test_patch_through_mirror(void) {
+  // Work RAM repeats every $800 bytes; code run at $0A00 is patched at $0200.
+  u8 ram[0x800] = {0};
+  bus_map(&cpu.bus, 0x00, 0x1F, ram, sizeof(ram), 1);
+  ram[0x200] = 0xE8; // INX
+  ram[0x201] = JAM;
+  cpu.PC = 0x0A00;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x01, cpu.X);
+
+  write_byte(&cpu, 0x0200, INY_IMP);
+  cpu.PC = 0x0A00;
+  cpu.halted = 0;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x01, cpu.Y);
+}
+
+static void test_store_into_running_operand(void) {
+  // LDA #$05; STA $0206; LDX #$00; JAM -- the LDX's operand is decoded along
+  // with the block, then patched before it runs.
+  const u8 code[] = {0xA9, 0x05, 0x8D, 0x06, 0x02, 0xA2, 0x00, JAM};
+  load(code, sizeof(code));
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x05, cpu.X);
+
+  write_byte(&cpu, 0x0206, 0x07);
+  cpu.PC = 0x0205;
+  cpu.halted = 0;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x07, cpu.X);
+}
+
+static void test_operand_on_next_page(void) {
+  // JMP $0400 at $02FE, whose high byte is on the next page, away from the
+  // block's generation.
+  mem[0x02FE] = 0x4C;
+  mem[0x02FF] = 0x00;
+  mem[0x0300] = 0x04;
+  mem[0x0400] = JAM;
+  mem[0x0500] = JAM;
+  cpu.PC = 0x02FE;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0x0400, cpu.PC);
+
+  write_byte(&cpu, 0x0300, 0x05);
+  cpu.PC = 0x02FE;
+  cpu.halted = 0;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0x0500, cpu.PC);
+}
+
+static u8 bank_a[0x100], bank_b[0x100];
+
+static void switch_bank(void *ctx, u16 addr, u8 val) {
+  (void)addr;
+  bus_map_rom(ctx, 0x80, 0x80, val ? bank_b : bank_a, 0x100);
+}
+
+static void test_switch_own_bank(void) {
+  // STA $8000; INX; JAM -- the store swaps in a bank that has INY where the
+  // INX was, partway through the block.
+  const u8 code[] = {0x8D, 0x00, 0x80, 0xE8, JAM};
+  for (u32 i = 0; i < sizeof(code); i++) {
+    bank_a[i] = bank_b[i] = code[i];
+  }
+  bank_b[3] = INY_IMP;
+  bus_map_io(&cpu.bus, 0x80, 0x80, NULL, switch_bank, &cpu.bus);
+  bus_map_rom(&cpu.bus, 0x80, 0x80, bank_a, sizeof(bank_a));
+  cpu.A = 1;
+  cpu.PC = 0x8000;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x00, cpu.X);
+  TEST_ASSERT_EQUAL_HEX8(0x01, cpu.Y);
+}
+
+static void test_stops_at_deadline(void) {
+  const u8 code[] = {0xE8, 0xE8, 0xE8, 0xE8, JAM}; // INX x4; JAM
+  load(code, sizeof(code));
+  run_until(&cpu, 3);
+  TEST_ASSERT_EQUAL_HEX8(0x02, cpu.X);
+  TEST_ASSERT_EQUAL_UINT64(4, cpu.cycles);
+  run_until(&cpu, 100);
+  TEST_ASSERT_EQUAL_HEX8(0x04, cpu.X);
+  TEST_ASSERT_TRUE(cpu.halted);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_interpreter);
+  RUN_TEST(test_store_into_running_block);
+  RUN_TEST(test_patch_between_runs);
+  RUN_TEST(test_patch_through_mirror);
+  RUN_TEST(test_store_into_running_operand);
+  RUN_TEST(test_operand_on_next_page);
+  RUN_TEST(test_switch_own_bank);
+  RUN_TEST(test_stops_at_deadline);
+  return UNITY_END();
+}
@@ -0,0 +1,89 @@
+#include "bus.h"
+#include "emu.h"
+#include "opcode.h"
+#include "unity.h"
+
+CPU cpu;
+u8 rom[0x4000];
+
+static u16 last_io_addr;
+static u8 last_io_val;
+
+static u8 io_read(void *ctx, u16 addr) {
+  last_io_addr = addr;
+  return *(u8 *)ctx;
+}
+
+static void io_write(void *ctx, u16 addr, u8 val) {
+  (void)ctx;
+  last_io_addr = addr;
+  last_io_val = val;
+}
+
+void setUp(void) {
+  for (int i = 0; i < 0x4000; i++) {
+    rom[i] = i & 0xFF;
+  }
+  last_io_addr = 0;
+  last_io_val = 0;
+  power_on(&cpu);
+}
+
+void tearDown(void) {
+  // Clean up if needed
+}
+
+static void test_ram_is_mirrored(void) {
+  write_byte(&cpu, 0x0012, 0x42);
+  TEST_ASSERT_EQUAL_HEX8(0x42, read_byte(&cpu, 0x0812));
+  TEST_ASSERT_EQUAL_HEX8(0x42, read_byte(&cpu, 0x1012));
+  TEST_ASSERT_EQUAL_HEX8(0x42, read_byte(&cpu, 0x1812));
+  write_byte(&cpu, 0x1FFF, 0x99);
+  TEST_ASSERT_EQUAL_HEX8(0x99, cpu.ram[0x7FF]);
+}
+
+static void test_rom_is_read_only_and_mirrored(void) {
+  bus_map(&cpu.bus, 0x80, 0xFF, rom, sizeof(rom), 0);
+  TEST_ASSERT_EQUAL_HEX8(0x34, read_byte(&cpu, 0x8034));
+  TEST_ASSERT_EQUAL_HEX8(0x34, read_byte(&cpu, 0xC034));
+  write_byte(&cpu, 0x8034, 0x00);
+  TEST_ASSERT_EQUAL_HEX8(0x34, rom[0x34]);
+}
+
+static void test_io_pages_trap_to_handlers(void) {
+  u8 reg = 0x5A;
+  bus_map_io(&cpu.bus, 0x20, 0x3F, &io_read, &io_write, &reg);
+  TEST_ASSERT_EQUAL_HEX8(0x5A, read_byte(&cpu, 0x2002));
+  TEST_ASSERT_EQUAL_HEX16(0x2002, last_io_addr);
+  write_byte(&cpu, 0x3FF9, 0x77);
+  TEST_ASSERT_EQUAL_HEX16(0x3FF9, last_io_addr);
+  TEST_ASSERT_EQUAL_HEX8(0x77, last_io_val);
+}
+
+static void test_unmapped_reads_open_bus(void) {
+  TEST_ASSERT_EQUAL_HEX8(0x50, read_byte(&cpu, 0x5000));
+  write_byte(&cpu, 0x5000, 0x12);
+  TEST_ASSERT_EQUAL_HEX8(0x50, read_byte(&cpu, 0x5000));
+}
+
+static void test_writes_mark_pages_dirty(void) {
+  write_byte(&cpu, 0x0812, 0x42);
+  write_byte(&cpu, 0x5000, 0x12); // Dropped, but marked all the same
+  write_byte(&cpu, 0xFFFF, 0x00);
+  for (u32 page = 0; page < 256; page++) {
+    u8 expected = page == 0x08 || page == 0x50 || page == 0xFF;
+    TEST_ASSERT_EQUAL_HEX8(expected, bus_page_dirty(&cpu.bus, page));
+  }
+  bus_clear_dirty(&cpu.bus);
+  TEST_ASSERT_FALSE(bus_page_dirty(&cpu.bus, 0x08));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ram_is_mirrored);
+  RUN_TEST(test_rom_is_read_only_and_mirrored);
+  RUN_TEST(test_io_pages_trap_to_handlers);
+  RUN_TEST(test_unmapped_reads_open_bus);
+  RUN_TEST(test_writes_mark_pages_dirty);
+  return UNITY_END();
+}
@@ -0,0 +1,33 @@
+#ifndef COUNTER_ROM_H
+#define COUNTER_ROM_H
+
+#include "nes.h"
+#include "unity.h"
+#include <string.h>
+#include <unistd.h>
+
+// The cartridge the save state and rewind tests run: 16 KiB of NROM with CHR
+// RAM that counts in RAM and scrolls the PPU every NMI. It is written to a
+// new file made from path, a mkstemp template, and loaded into nes.
+static void load_counter_rom(NES *nes, char *path) {
+  // LDA #$80; STA $2000; loop: INC $0300; INX; JMP loop
+  const u8 code[] = {0xA9, 0x80, 0x8D, 0x00, 0x20, 0xEE,
+                     0x00, 0x03, 0xE8, 0x4C, 0x05, 0xC0};
+  // INC $10; LDA $10; STA $2005; STA $2005; RTI
+  const u8 handler[] = {0xE6, 0x10, 0xA5, 0x10, 0x8D, 0x05,
+                        0x20, 0x8D, 0x05, 0x20, 0x40};
+  static u8 image[16 + 0x4000];
+  memset(image, 0, sizeof(image));
+  memcpy(image, "NES\x1A\x01\x00", 6);
+  memcpy(image + 16, code, sizeof(code));
+  memcpy(image + 16 + 0x100, handler, sizeof(handler));
+  image[16 + 0x3FFB] = 0xC1;
+  image[16 + 0x3FFD] = 0xC0;
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  TEST_ASSERT_EQUAL(sizeof(image), write(fd, image, sizeof(image)));
+  close(fd);
+  TEST_ASSERT_EQUAL(ROM_OK, nes_load(nes, path));
+}
+
+#endif // COUNTER_ROM_H
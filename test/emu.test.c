@@ -0,0 +1,203 @@
+#include "bus.h"
+#include "emu.h"
+#include "opcode.h"
+#include "unity.h"
+
+CPU cpu;
+u8 mem[0x10000];
+
+void setUp(void) {
+  set_status(&cpu, 0b00100000);
+  cpu.A = 0;
+  cpu.X = 0;
+  cpu.Y = 0;
+  cpu.S = 0xFF;
+  cpu.PC = 0;
+  cpu.halted = 0;
+  cpu.cycles = 0;
+  for (int i = 0; i < 0x10000; i++) {
+    mem[i] = 0;
+  }
+  bus_init(&cpu.bus);
+  bus_map(&cpu.bus, 0x00, 0xFF, mem, sizeof(mem), 1);
+}
+
+void tearDown(void) {
+  // Clean up if needed
+}
+
+static void test_reset_reads_vector(void) {
+  mem[0xFFFC] = 0x00;
+  mem[0xFFFD] = 0xC0;
+  reset(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0xC000, cpu.PC);
+  TEST_ASSERT_EQUAL_HEX8(0xFD, cpu.S);
+  TEST_ASSERT_TRUE(get_flag(&cpu, FLAG_INTERRUPT_DISABLE));
+}
+
+static void test_execute_advances_by_length(void) {
+  mem[0] = LDA_IMM;
+  mem[1] = 0x42;
+  mem[2] = LDA_ABS;
+  mem[3] = 0x34;
+  mem[4] = 0x12;
+  mem[5] = TAX_IMP;
+  mem[0x1234] = 0x99;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x42, cpu.A);
+  TEST_ASSERT_EQUAL_HEX16(0x0002, cpu.PC);
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x99, cpu.A);
+  TEST_ASSERT_EQUAL_HEX16(0x0005, cpu.PC);
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x99, cpu.X);
+  TEST_ASSERT_EQUAL_HEX16(0x0006, cpu.PC);
+}
+
+static void test_execute_branch_taken(void) {
+  cpu.PC = 0x1000;
+  mem[0x1000] = BNE_REL;
+  mem[0x1001] = 0xFC; // -4
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0x0FFE, cpu.PC);
+}
+
+static void test_execute_jsr_rts(void) {
+  cpu.PC = 0x0200;
+  mem[0x0200] = JSR_ABS;
+  mem[0x0201] = 0x00;
+  mem[0x0202] = 0x03;
+  mem[0x0300] = RTS_IMP;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0x0300, cpu.PC);
+  TEST_ASSERT_EQUAL_HEX8(0xFD, cpu.S);
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0x0203, cpu.PC);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, cpu.S);
+}
+
+static void test_execute_jmp_indirect_page_wrap(void) {
+  mem[0] = JMP_IND;
+  mem[1] = 0xFF;
+  mem[2] = 0x10;
+  mem[0x10FF] = 0x34;
+  mem[0x1000] = 0x12;
+  mem[0x1100] = 0x56;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0x1234, cpu.PC);
+}
+
+static void test_run_loop_counts_down(void) {
+  // LDX #$05; loop: DEX; BNE loop; then an unofficial opcode halts.
+  mem[0] = LDX_IMM;
+  mem[1] = 0x05;
+  mem[2] = DEX_IMP;
+  mem[3] = BNE_REL;
+  mem[4] = 0xFD;
+  mem[5] = 0x02;
+  run_loop(&cpu);
+  TEST_ASSERT_TRUE(cpu.halted);
+  TEST_ASSERT_EQUAL_HEX8(0x00, cpu.X);
+  TEST_ASSERT_EQUAL_HEX16(0x0005, cpu.PC);
+  TEST_ASSERT_TRUE(get_flag(&cpu, FLAG_ZERO));
+}
+
+static void test_sbc_borrow(void) {
+  mem[0] = SEC_IMP;
+  mem[1] = LDA_IMM;
+  mem[2] = 0x10;
+  mem[3] = SBC_IMM;
+  mem[4] = 0x20;
+  mem[5] = 0x02;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0xF0, cpu.A);
+  TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_CARRY));
+  TEST_ASSERT_TRUE(get_flag(&cpu, FLAG_NEGATIVE));
+}
+
+static void test_cycles_base(void) {
+  mem[0] = LDA_IMM;
+  mem[1] = 0x01;
+  mem[2] = STA_ABS;
+  mem[3] = 0x00;
+  mem[4] = 0x02;
+  mem[5] = JSR_ABS;
+  mem[6] = 0x00;
+  mem[7] = 0x03;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_UINT64(2, cpu.cycles);
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_UINT64(6, cpu.cycles);
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_UINT64(12, cpu.cycles);
+}
+
+static void test_cycles_page_cross(void) {
+  cpu.X = 0x01;
+  mem[0] = LDA_ABSX;
+  mem[1] = 0xFE;
+  mem[2] = 0x12;
+  mem[3] = LDA_ABSX;
+  mem[4] = 0xFF;
+  mem[5] = 0x12;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_UINT64(4, cpu.cycles);
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_UINT64(9, cpu.cycles);
+}
+
+static void test_cycles_indirect_y_page_cross(void) {
+  cpu.Y = 0x10;
+  mem[0] = LDA_INDY;
+  mem[1] = 0x20;
+  mem[0x20] = 0xF8;
+  mem[0x21] = 0x12;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_UINT64(6, cpu.cycles);
+}
+
+static void test_cycles_store_no_penalty(void) {
+  cpu.X = 0x01;
+  mem[0] = STA_ABSX;
+  mem[1] = 0xFF;
+  mem[2] = 0x12;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_UINT64(5, cpu.cycles);
+}
+
+static void test_cycles_branch(void) {
+  // Not taken, taken on the same page, taken across a page.
+  cpu.PC = 0x10F0;
+  set_flag(&cpu, FLAG_ZERO, 1);
+  mem[0x10F0] = BNE_REL;
+  mem[0x10F1] = 0x10;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_UINT64(2, cpu.cycles);
+  mem[0x10F2] = BEQ_REL;
+  mem[0x10F3] = 0x02;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0x10F6, cpu.PC);
+  TEST_ASSERT_EQUAL_UINT64(5, cpu.cycles);
+  mem[0x10F6] = BEQ_REL;
+  mem[0x10F7] = 0x10;
+  execute(&cpu);
+  TEST_ASSERT_EQUAL_HEX16(0x1108, cpu.PC);
+  TEST_ASSERT_EQUAL_UINT64(9, cpu.cycles);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_reset_reads_vector);
+  RUN_TEST(test_execute_advances_by_length);
+  RUN_TEST(test_execute_branch_taken);
+  RUN_TEST(test_execute_jsr_rts);
+  RUN_TEST(test_execute_jmp_indirect_page_wrap);
+  RUN_TEST(test_run_loop_counts_down);
+  RUN_TEST(test_sbc_borrow);
+  RUN_TEST(test_cycles_base);
+  RUN_TEST(test_cycles_page_cross);
+  RUN_TEST(test_cycles_indirect_y_page_cross);
+  RUN_TEST(test_cycles_store_no_penalty);
+  RUN_TEST(test_cycles_branch);
+  return UNITY_END();
+}
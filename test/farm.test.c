@@ -0,0 +1,97 @@
+#include "farm.h"
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char dir[] = "/tmp/melnes_farm_XXXXXX";
+static char list_path[64];
+
+// A 16 KiB NROM image running code at $C000.
+static void write_rom(const char *name, const u8 *code, u32 size) {
+  static u8 image[16 + 0x4000];
+  char path[96];
+  memset(image, 0, sizeof(image));
+  memcpy(image, "NES\x1A\x01\x00", 6);
+  memcpy(image + 16, code, size);
+  image[16 + 0x3FFD] = 0xC0;
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE *file = fopen(path, "wb");
+  fwrite(image, 1, sizeof(image), file);
+  fclose(file);
+}
+
+static void write_list(const char *contents) {
+  FILE *file = fopen(list_path, "w");
+  fputs(contents, file);
+  fclose(file);
+}
+
+void setUp(void) {
+  // INC $6000; JMP $C000
+  const u8 counter[] = {0xEE, 0x00, 0x60, 0x4C, 0x00, 0xC0};
+  // NOP; jam
+  const u8 jam[] = {0xEA, 0x02};
+  write_rom("counter.nes", counter, sizeof(counter));
+  write_rom("jam.nes", jam, sizeof(jam));
+}
+
+void tearDown(void) {
+  char path[96];
+  snprintf(path, sizeof(path), "%s/counter.nes", dir);
+  unlink(path);
+  snprintf(path, sizeof(path), "%s/jam.nes", dir);
+  unlink(path);
+  unlink(list_path);
+}
+
+static void test_load_rejects_bad_lines(void) {
+  FarmJobList list;
+  write_list("# comment\n\ncounter.nes 10 6000=05 pass\njam.nes ten - jam\n");
+  TEST_ASSERT_EQUAL_INT(4, farm_load(&list, list_path));
+  TEST_ASSERT_EQUAL_UINT(0, list.count);
+  write_list("counter.nes 10 - maybe\n");
+  TEST_ASSERT_EQUAL_INT(1, farm_load(&list, list_path));
+}
+
+static void test_runs_jobs_in_parallel(void) {
+  FarmJobList list;
+  char contents[2048] = "";
+  for (int i = 0; i < 24; i++) {
+    strcat(contents, i % 3 == 0   ? "counter.nes 10 6000!=00 pass\n"
+                     : i % 3 == 1 ? "counter.nes 2 0000=01 timeout\n"
+                                  : "jam.nes 10 - jam\n");
+  }
+  strcat(contents, "missing.nes 1 - pass\n");
+  write_list(contents);
+  TEST_ASSERT_EQUAL_INT(0, farm_load(&list, list_path));
+  TEST_ASSERT_EQUAL_UINT(25, list.count);
+
+  farm_run(&list, 4);
+  for (u32 i = 0; i < 24; i++) {
+    TEST_ASSERT_EQUAL(list.jobs[i].expect, list.jobs[i].result.status);
+  }
+  TEST_ASSERT_EQUAL(RUN_ERROR, list.jobs[24].result.status);
+  TEST_ASSERT_NOT_EQUAL(0, list.jobs[0].result.value);
+  TEST_ASSERT_TRUE(list.jobs[1].result.cycles >= FRAMES_TO_CPU_CYCLES(2));
+
+  FILE *null = fopen("/dev/null", "w");
+  TEST_ASSERT_EQUAL_UINT(1, farm_report(null, &list));
+  fclose(null);
+  farm_free(&list);
+}
+
+int main(void) {
+  if (mkdtemp(dir) == NULL) {
+    perror("mkdtemp");
+    return 1;
+  }
+  snprintf(list_path, sizeof(list_path), "%s/jobs.txt", dir);
+  UNITY_BEGIN();
+  RUN_TEST(test_load_rejects_bad_lines);
+  RUN_TEST(test_runs_jobs_in_parallel);
+  int failures = UNITY_END();
+  rmdir(dir);
+  return failures;
+}
@@ -0,0 +1,219 @@
+#include "block.h"
+#include "bus.h"
+#include "emu.h"
+#include "jit.h"
+#include "opcode.h"
+#include "unity.h"
+
+CPU cpu;
+u8 mem[0x10000];
+
+#define JAM 0x02
+
+void setUp(void) {
+  set_status(&cpu, 0b00100000);
+  cpu.A = 0;
+  cpu.X = 0;
+  cpu.Y = 0;
+  cpu.S = 0xFF;
+  cpu.PC = 0x0200;
+  cpu.halted = 0;
+  cpu.cycles = 0;
+  for (int i = 0; i < 0x10000; i++) {
+    mem[i] = 0;
+  }
+  bus_init(&cpu.bus);
+  bus_map(&cpu.bus, 0x00, 0xFF, mem, sizeof(mem), 1);
+  block_cache_attach_jit(&cpu);
+  if (cpu.blocks->jit == NULL) {
+    TEST_IGNORE_MESSAGE("no JIT on this host");
+  }
+}
+
+void tearDown(void) { block_cache_detach(&cpu); }
+
+// Every inlined instruction mixed with handler calls, looping through a
+// counter so blocks get hot:
+// loop: LDA #$80; TAX; LDY #$00; TAY; TXA; TYA; INX; INY; DEX; DEY; TSX;
+//       TXS; SEC; CLC; SED; CLD; SEI; CLI; CLV; NOP; LDX #$7F; INX; ADC $10;
+//       STA $10; ROL $11; PHP; PLA; STA $0300,Y; DEC $12; BNE loop; INC $13;
+//       JMP loop
+static const u8 EVERY_INLINE[] = {
+    0xA9, 0x80, 0xAA, 0xA0, 0x00, 0xA8, 0x8A, 0x98, 0xE8, 0xC8, 0xCA,
+    0x88, 0xBA, 0x9A, 0x38, 0x18, 0xF8, 0xD8, 0x78, 0x58, 0xB8, 0xEA,
+    0xA2, 0x7F, 0xE8, 0x65, 0x10, 0x85, 0x10, 0x26, 0x11, 0x08, 0x68,
+    0x99, 0x00, 0x03, 0xC6, 0x12, 0xD0, 0xDA, 0xE6, 0x13, 0x4C, 0x00,
+    0x02};
+
+static void load(const u8 *code, u32 size) {
+  for (u32 i = 0; i < size; i++) {
+    mem[0x0200 + i] = code[i];
+  }
+}
+
+static void assert_matches_interpreter(u64 cycles) {
+  static u8 jit_mem[0x10000];
+  run_until(&cpu, cycles);
+  u32 native = 0;
+  for (u32 i = 0; i < BLOCK_CACHE_SIZE; i++) {
+    native += cpu.blocks->blocks[i].native != NULL;
+  }
+  TEST_ASSERT_TRUE(native > 0);
+  CPU jit = cpu;
+  for (int i = 0; i < 0x10000; i++) {
+    jit_mem[i] = mem[i];
+  }
+
+  block_cache_detach(&cpu);
+  cpu.A = 0;
+  cpu.X = 0;
+  cpu.Y = 0;
+  cpu.S = 0xFF;
+  cpu.PC = 0x0200;
+  cpu.cycles = 0;
+  set_status(&cpu, 0b00100000);
+  for (int i = 0; i < 0x10000; i++) {
+    mem[i] = 0;
+  }
+  load(EVERY_INLINE, sizeof(EVERY_INLINE));
+  run_until(&cpu, cycles);
+
+  TEST_ASSERT_EQUAL_HEX16(cpu.PC, jit.PC);
+  TEST_ASSERT_EQUAL_HEX8(cpu.A, jit.A);
+  TEST_ASSERT_EQUAL_HEX8(cpu.X, jit.X);
+  TEST_ASSERT_EQUAL_HEX8(cpu.Y, jit.Y);
+  TEST_ASSERT_EQUAL_HEX8(cpu.S, jit.S);
+  TEST_ASSERT_EQUAL_HEX8(get_status(&cpu), get_status(&jit));
+  TEST_ASSERT_EQUAL_UINT64(cpu.cycles, jit.cycles);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(mem, jit_mem, 0x10000);
+}
+
+static void test_matches_interpreter(void) {
+  load(EVERY_INLINE, sizeof(EVERY_INLINE));
+  assert_matches_interpreter(1000003);
+}
+
+static void test_matches_interpreter_at_every_deadline(void) {
+  // Deadlines falling inside translated blocks must stop where the
+  // interpreter does.
+  for (u64 cycles = 20000; cycles < 20100; cycles++) {
+    setUp();
+    load(EVERY_INLINE, sizeof(EVERY_INLINE));
+    assert_matches_interpreter(cycles);
+  }
+}
+
+static void test_store_into_translated_block(void) {
+  // loop: INX; LDA $20; STA ($30),Y; NOP; DEC $10; BNE loop; JMP $0300
+  const u8 code[] = {0xE8, 0xA5, 0x20, 0x91, 0x30, 0xEA, 0xC6,
+                     0x10, 0xD0, 0xF6, 0x4C, 0x00, 0x03};
+  // Points the store at the NOP and runs the loop once more:
+  // LDA #$05; STA $30; LDA #$02; STA $31; LDA #100; STA $10; DEC $11;
+  // BEQ +3; JMP $0200; JAM
+  const u8 patch[] = {0xA9, 0x05, 0x85, 0x30, 0xA9, 0x02, 0x85,
+                      0x31, 0xA9, 0x64, 0x85, 0x10, 0xC6, 0x11,
+                      0xF0, 0x03, 0x4C, 0x00, 0x02, JAM};
+  load(code, sizeof(code));
+  for (u32 i = 0; i < sizeof(patch); i++) {
+    mem[0x0300 + i] = patch[i];
+  }
+  mem[0x10] = 100;
+  mem[0x11] = 2;
+  mem[0x20] = INX_IMP;
+  mem[0x31] = 0x04; // Harmless data page until patched
+  run_loop(&cpu);
+  // 100 passes, then 100 more where the translated block overwrote its own
+  // NOP with a second INX before reaching it.
+  TEST_ASSERT_EQUAL_HEX8(INX_IMP, mem[0x0205]);
+  TEST_ASSERT_EQUAL_HEX8((100 + 200) & 0xFF, cpu.X);
+  TEST_ASSERT_TRUE(cpu.halted);
+}
+
+static void test_rewritten_page_stays_interpreted(void) {
+  // loop: STA $0280; DEX; BNE loop; JAM -- rewrites its own page every pass.
+  const u8 code[] = {0x8D, 0x80, 0x02, 0xCA, 0xD0, 0xFA, JAM};
+  load(code, sizeof(code));
+  cpu.X = 0xFF;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x00, cpu.X);
+  TEST_ASSERT_TRUE(cpu.blocks->generation[0x02] >= JIT_SMC_LIMIT);
+  for (u32 i = 0; i < BLOCK_CACHE_SIZE; i++) {
+    TEST_ASSERT_NULL(cpu.blocks->blocks[i].native);
+  }
+}
+
+static JitCode native_at(u16 pc) {
+  return cpu.blocks->blocks[(pc ^ (pc >> 5)) & (BLOCK_CACHE_SIZE - 1)].native;
+}
+
+static u8 bank_a[0x100], bank_b[0x100];
+
+static void switch_bank(void *ctx, u16 addr, u8 val) {
+  (void)addr;
+  bus_map_rom(ctx, 0x80, 0x80, val ? bank_b : bank_a, 0x100);
+}
+
+static void test_switch_own_bank(void) {
+  // loop: STA $8000; INX; DEY; BNE loop; JAM -- storing 0 keeps this bank
+  // until the block is translated, then storing 1 swaps in one with a JAM
+  // where the INX was.
+  const u8 code[] = {0x8D, 0x00, 0x80, 0xE8, 0x88, 0xD0, 0xF9, JAM};
+  for (u32 i = 0; i < sizeof(code); i++) {
+    bank_a[i] = bank_b[i] = code[i];
+  }
+  bank_b[3] = JAM;
+  bus_map_io(&cpu.bus, 0x80, 0x80, NULL, switch_bank, &cpu.bus);
+  bus_map_rom(&cpu.bus, 0x80, 0x80, bank_a, sizeof(bank_a));
+  cpu.PC = 0x8000;
+  cpu.Y = 100;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(100, cpu.X);
+  TEST_ASSERT_NOT_NULL(native_at(0x8000));
+
+  cpu.A = 1;
+  cpu.Y = 1;
+  cpu.PC = 0x8000;
+  cpu.halted = 0;
+  run_loop(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(100, cpu.X);
+  TEST_ASSERT_EQUAL_HEX16(0x8003, cpu.PC);
+}
+
+static void test_retranslates_after_flush(void) {
+  // $0200: DEX; BNE $0200; JAM and $0400: DEY; BNE $0400; JAM
+  const u8 code[] = {0xCA, 0xD0, 0xFD, JAM};
+  load(code, sizeof(code));
+  mem[0x0400] = 0x88;
+  mem[0x0401] = 0xD0;
+  mem[0x0402] = 0xFD;
+  mem[0x0403] = JAM;
+  cpu.X = 100;
+  run_loop(&cpu);
+  TEST_ASSERT_NOT_NULL(native_at(0x0200));
+
+  // Translating the second loop finds the arena full and drops the first.
+  cpu.blocks->jit->used = JIT_ARENA_SIZE;
+  cpu.Y = 100;
+  cpu.PC = 0x0400;
+  cpu.halted = 0;
+  run_loop(&cpu);
+  TEST_ASSERT_NOT_NULL(native_at(0x0400));
+  TEST_ASSERT_NULL(native_at(0x0200));
+
+  cpu.X = 100;
+  cpu.PC = 0x0200;
+  cpu.halted = 0;
+  run_loop(&cpu);
+  TEST_ASSERT_NOT_NULL(native_at(0x0200));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_interpreter);
+  RUN_TEST(test_matches_interpreter_at_every_deadline);
+  RUN_TEST(test_store_into_translated_block);
+  RUN_TEST(test_rewritten_page_stays_interpreted);
+  RUN_TEST(test_switch_own_bank);
+  RUN_TEST(test_retranslates_after_flush);
+  return UNITY_END();
+}
@@ -0,0 +1,192 @@
+#include "bus.h"
+#include "mapper.h"
+#include "unity.h"
+#include <string.h>
+
+Bus bus;
+PPU ppu;
+Rom rom;
+Mapper mapper;
+// Up to 512 KiB of PRG and 128 KiB of CHR. Every 8 KiB of PRG and every
+// 1 KiB of CHR starts with its own number, so banks can be told apart.
+static u8 image[16 + 0x80000 + 0x20000];
+
+void setUp(void) { bus_init(&bus); }
+
+void tearDown(void) {}
+
+static void load(u8 number, u8 prg_banks, u8 chr_banks, u8 flags6) {
+  memset(image, 0, sizeof(image));
+  memcpy(image, "NES\x1A", 4);
+  image[4] = prg_banks;
+  image[5] = chr_banks;
+  image[6] = (number << 4) | flags6;
+  image[7] = number & 0xF0;
+  u8 *prg = image + 16;
+  for (u32 bank = 0; bank < prg_banks * 2u; bank++) {
+    prg[bank * 0x2000] = bank;
+  }
+  u8 *chr = prg + prg_banks * 0x4000;
+  for (u32 bank = 0; bank < chr_banks * 8u; bank++) {
+    chr[bank * 0x400] = bank;
+  }
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, sizeof(image)));
+  ppu_power_on(&ppu, &rom);
+  TEST_ASSERT_EQUAL_INT(0, mapper_init(&mapper, &rom, &bus, &ppu));
+}
+
+// The 8 KiB PRG bank at addr and the 1 KiB CHR bank in window.
+static u8 prg_at(u16 addr) { return bus.read[addr >> 8][0]; }
+static u8 chr_at(u8 window) { return ppu.chr[window][0]; }
+
+// MMC1 registers take five writes, low bit first.
+static void mmc1_write_reg(u16 addr, u8 val) {
+  for (u32 i = 0; i < 5; i++) {
+    mapper_write(&mapper, addr, val >> i);
+  }
+}
+
+static void test_nrom_mirrors_16k(void) {
+  load(MAPPER_NROM, 1, 1, 0);
+  TEST_ASSERT_TRUE(bus.read[0x80] == bus.read[0xC0]);
+  TEST_ASSERT_TRUE(bus.read[0xBF] == bus.read[0xFF]);
+  TEST_ASSERT_NULL(bus.write[0x80]);
+}
+
+static void test_unknown_board_is_refused(void) {
+  memcpy(image, "NES\x1A\x01\x01\x50\x00", 8); // Mapper 5
+  memset(image + 8, 0, 8);
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, sizeof(image)));
+  TEST_ASSERT_EQUAL_INT(-1, mapper_init(&mapper, &rom, &bus, &ppu));
+}
+
+static void test_uxrom_switches_the_low_bank(void) {
+  load(MAPPER_UXROM, 8, 0, 0);
+  TEST_ASSERT_EQUAL_UINT8(0, prg_at(0x8000));
+  TEST_ASSERT_EQUAL_UINT8(14, prg_at(0xC000));
+  mapper_write(&mapper, 0xFFF0, 3);
+  TEST_ASSERT_EQUAL_UINT8(6, prg_at(0x8000));
+  TEST_ASSERT_EQUAL_UINT8(7, prg_at(0xA000));
+  TEST_ASSERT_EQUAL_UINT8(14, prg_at(0xC000));
+  // Banks past the end wrap like the address lines do.
+  mapper_write(&mapper, 0x8000, 9);
+  TEST_ASSERT_EQUAL_UINT8(2, prg_at(0x8000));
+  // CHR RAM stays where it was.
+  TEST_ASSERT_TRUE(ppu.chr[0] == ppu.chr_ram);
+}
+
+static void test_cnrom_switches_chr(void) {
+  load(MAPPER_CNROM, 2, 4, 0);
+  mapper_write(&mapper, 0x8000, 2);
+  TEST_ASSERT_EQUAL_UINT8(16, chr_at(0));
+  TEST_ASSERT_EQUAL_UINT8(23, chr_at(7));
+  TEST_ASSERT_EQUAL_UINT8(0, prg_at(0x8000));
+  TEST_ASSERT_EQUAL_UINT8(2, prg_at(0xC000));
+}
+
+static void test_mmc1_loads_registers_serially(void) {
+  load(MAPPER_MMC1, 16, 4, 0);
+  // Powers on with the last bank fixed at $C000.
+  TEST_ASSERT_EQUAL_UINT8(30, prg_at(0xC000));
+  mmc1_write_reg(0xE000, 5);
+  TEST_ASSERT_EQUAL_UINT8(10, prg_at(0x8000));
+  TEST_ASSERT_EQUAL_UINT8(30, prg_at(0xC000));
+
+  // A write with bit 7 set throws away the bits so far.
+  mapper_write(&mapper, 0xE000, 1);
+  mapper_write(&mapper, 0xE000, 0x80);
+  mmc1_write_reg(0xE000, 2);
+  TEST_ASSERT_EQUAL_UINT8(4, prg_at(0x8000));
+
+  // 32 KiB PRG, 4 KiB CHR and one-screen mirroring from the upper nametable.
+  mmc1_write_reg(0x8000, 0x11);
+  TEST_ASSERT_EQUAL_UINT8(4, prg_at(0x8000));
+  TEST_ASSERT_EQUAL_UINT8(7, prg_at(0xE000));
+  TEST_ASSERT_TRUE(ppu.nametable[0] == ppu.ciram + 0x400);
+  TEST_ASSERT_TRUE(ppu.nametable[3] == ppu.ciram + 0x400);
+  mmc1_write_reg(0xA000, 3);
+  mmc1_write_reg(0xC000, 6);
+  TEST_ASSERT_EQUAL_UINT8(12, chr_at(0));
+  TEST_ASSERT_EQUAL_UINT8(24, chr_at(4));
+}
+
+static void test_mmc3_banks_and_modes(void) {
+  load(MAPPER_MMC3, 16, 16, 0);
+  TEST_ASSERT_EQUAL_UINT8(30, prg_at(0xC000));
+  TEST_ASSERT_EQUAL_UINT8(31, prg_at(0xE000));
+  mapper_write(&mapper, 0x8000, 6);
+  mapper_write(&mapper, 0x8001, 3);
+  TEST_ASSERT_EQUAL_UINT8(3, prg_at(0x8000));
+  // Swapped PRG mode: R6 moves to $C000.
+  mapper_write(&mapper, 0x8000, 0x47);
+  mapper_write(&mapper, 0x8001, 9);
+  TEST_ASSERT_EQUAL_UINT8(30, prg_at(0x8000));
+  TEST_ASSERT_EQUAL_UINT8(9, prg_at(0xA000));
+  TEST_ASSERT_EQUAL_UINT8(3, prg_at(0xC000));
+  TEST_ASSERT_EQUAL_UINT8(31, prg_at(0xE000));
+
+  // R0 is a 2 KiB bank, ignoring its low bit; R2 a 1 KiB one.
+  mapper_write(&mapper, 0x8000, 0);
+  mapper_write(&mapper, 0x8001, 5);
+  mapper_write(&mapper, 0x8000, 2);
+  mapper_write(&mapper, 0x8001, 9);
+  TEST_ASSERT_EQUAL_UINT8(4, chr_at(0));
+  TEST_ASSERT_EQUAL_UINT8(5, chr_at(1));
+  TEST_ASSERT_EQUAL_UINT8(9, chr_at(4));
+  // Inverted CHR swaps the halves of the pattern tables.
+  mapper_write(&mapper, 0x8000, 0x80);
+  TEST_ASSERT_EQUAL_UINT8(9, chr_at(0));
+  TEST_ASSERT_EQUAL_UINT8(4, chr_at(4));
+
+  mapper_write(&mapper, 0xA000, 1);
+  TEST_ASSERT_TRUE(ppu.nametable[1] == ppu.ciram);
+  TEST_ASSERT_TRUE(ppu.nametable[2] == ppu.ciram + 0x400);
+}
+
+static void test_mmc3_irq_counts_a12_rises(void) {
+  load(MAPPER_MMC3, 2, 1, 0);
+  mapper_write(&mapper, 0xC000, 2);
+  mapper_write(&mapper, 0xC001, 0);
+  mapper_write(&mapper, 0xE001, 0);
+  ppu.ctrl = PPU_CTRL_SPRITE_TABLE;
+  ppu.mask = PPU_MASK_BACKGROUND;
+  // Reloaded on the first rise, then counted down to 0 on the third.
+  TEST_ASSERT_EQUAL_UINT64(ppu_dots_to_a12_rises(&ppu, 3),
+                           mapper_dots_to_irq(&mapper));
+  ppu.a12_rises += 2;
+  mapper_sync(&mapper);
+  TEST_ASSERT_EQUAL_UINT8(0, mapper.irq);
+  ppu.a12_rises++;
+  mapper_sync(&mapper);
+  TEST_ASSERT_EQUAL_UINT8(1, mapper.irq);
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, mapper_dots_to_irq(&mapper));
+
+  // $E000 acknowledges and disables, $E001 enables again; the counter
+  // reloads from the latch and carries on.
+  mapper_write(&mapper, 0xE000, 0);
+  TEST_ASSERT_EQUAL_UINT8(0, mapper.irq);
+  mapper_write(&mapper, 0xE001, 0);
+  TEST_ASSERT_EQUAL_UINT64(ppu_dots_to_a12_rises(&ppu, 3),
+                           mapper_dots_to_irq(&mapper));
+  ppu.a12_rises += 3;
+  mapper_write(&mapper, 0x8000, 0); // Bank writes sync too
+  TEST_ASSERT_EQUAL_UINT8(1, mapper.irq);
+
+  // Nothing to predict while the PPU doesn't render.
+  mapper_write(&mapper, 0xE000, 0);
+  mapper_write(&mapper, 0xE001, 0);
+  ppu.mask = 0;
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, mapper_dots_to_irq(&mapper));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_nrom_mirrors_16k);
+  RUN_TEST(test_unknown_board_is_refused);
+  RUN_TEST(test_uxrom_switches_the_low_bank);
+  RUN_TEST(test_cnrom_switches_chr);
+  RUN_TEST(test_mmc1_loads_registers_serially);
+  RUN_TEST(test_mmc3_banks_and_modes);
+  RUN_TEST(test_mmc3_irq_counts_a12_rises);
+  return UNITY_END();
+}
@@ -0,0 +1,238 @@
+#include "nes.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+NES nes;
+static char path[] = "/tmp/melnes_nes_XXXXXX";
+static u8 image[16 + 0x4000 + 0x2000];
+
+void setUp(void) {
+  memset(image, 0, sizeof(image));
+  memcpy(image, "NES\x1A\x01\x01", 6);
+  image[16 + 0x3FFB] = 0xC1; // NMI at $C100
+  image[16 + 0x3FFD] = 0xC0; // Reset at $C000
+}
+
+void tearDown(void) {
+  nes_unload(&nes);
+  unlink(path);
+}
+
+static void load_image(const u8 *data, u32 size) {
+  strcpy(path, "/tmp/melnes_nes_XXXXXX");
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  TEST_ASSERT_EQUAL(size, write(fd, data, size));
+  close(fd);
+  TEST_ASSERT_EQUAL(ROM_OK, nes_load(&nes, path));
+}
+
+static void load(const u8 *code, u32 size, const u8 *handler,
+                 u32 handler_size) {
+  memcpy(image + 16, code, size);
+  if (handler) {
+    memcpy(image + 16 + 0x100, handler, handler_size);
+  }
+  load_image(image, sizeof(image));
+}
+
+static void test_enabling_nmi_reschedules(void) {
+  // LDA #$80; STA $2000; JMP $C005
+  const u8 code[] = {0xA9, 0x80, 0x8D, 0x00, 0x20, 0x4C, 0x05, 0xC0};
+  // INC $10; RTI
+  const u8 handler[] = {0xE6, 0x10, 0x40};
+  load(code, sizeof(code), handler, sizeof(handler));
+  // Nothing was due when the run started, so only the write to $2000 can
+  // make it stop for the NMIs.
+  nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(3));
+  TEST_ASSERT_EQUAL_HEX8(3, nes.cpu.ram[0x10]);
+}
+
+static void test_accesses_are_timed_on_their_last_cycle(void) {
+  // LDA $2002; STA $10
+  const u8 code[] = {0xAD, 0x02, 0x20, 0x85, 0x10};
+  load(code, sizeof(code), NULL, 0);
+  // Vblank is raised on dot 1 of its line, during CPU cycle 27394. The read
+  // happens on the LDA's fourth cycle.
+  u64 start = (PPU_VBLANK_LINE * PPU_DOTS_PER_LINE + 1) / 3 - 2;
+  nes.cpu.cycles = start;
+  nes_run_until(&nes, start + 4 + 3);
+  TEST_ASSERT_EQUAL_HEX8(PPU_STATUS_VBLANK, nes.cpu.ram[0x10] & 0xE0);
+  TEST_ASSERT_EQUAL_HEX8(0, nes.ppu.status & PPU_STATUS_VBLANK);
+}
+
+static void test_oam_dma_stall_follows_the_write_cycle(void) {
+  // LDA #$02; STA $4014; JMP $C005
+  const u8 code[] = {0xA9, 0x02, 0x8D, 0x14, 0x40, 0x4C, 0x05, 0xC0};
+  load(code, sizeof(code), NULL, 0);
+  nes.cpu.ram[0x200] = 0x5A;
+  nes.cpu.ram[0x2FF] = 0xA5;
+  // The write is on the STA's last cycle: 105 is odd, so one more.
+  nes.cpu.cycles = 100;
+  nes_run_until(&nes, 106);
+  TEST_ASSERT_EQUAL_UINT64(106 + 514, nes.cpu.cycles);
+  TEST_ASSERT_EQUAL_HEX8(0x5A, nes.ppu.oam[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xA5, nes.ppu.oam[255]);
+  nes_unload(&nes);
+  unlink(path);
+
+  load(code, sizeof(code), NULL, 0);
+  nes.cpu.cycles = 101;
+  nes_run_until(&nes, 107);
+  TEST_ASSERT_EQUAL_UINT64(107 + 513, nes.cpu.cycles);
+}
+
+static void test_frame_irq_interrupts_the_cpu(void) {
+  // CLI; JMP $C001
+  const u8 code[] = {0x58, 0x4C, 0x01, 0xC0};
+  // LDA $4015; INC $10; RTI
+  const u8 handler[] = {0xAD, 0x15, 0x40, 0xE6, 0x10, 0x40};
+  image[16 + 0x3FFF] = 0xC1; // IRQ at $C100
+  load(code, sizeof(code), handler, sizeof(handler));
+  // Raised by the fourth step of the frame counter, at cycle 29829.
+  nes_run_until(&nes, 29829);
+  TEST_ASSERT_EQUAL_HEX8(0, nes.cpu.ram[0x10]);
+  TEST_ASSERT_EQUAL_HEX8(0, nes.cpu.irq);
+  nes_run_until(&nes, 29830 + 3 + 7 + 4);
+  TEST_ASSERT_EQUAL_HEX8(1, nes.cpu.ram[0x10]);
+  TEST_ASSERT_EQUAL_HEX8(0, nes.cpu.irq); // Acknowledged by the read
+  nes_run_until(&nes, 10 * 29830 + 20);
+  TEST_ASSERT_EQUAL_HEX8(10, nes.cpu.ram[0x10]);
+}
+
+// LDA #$8F; STA $4010 (DMC IRQ, fastest rate); LDA #$01; STA $4013
+// (17 bytes); LDA #enable; STA $4015; INC $10; JMP $C00C
+static void load_dmc(u8 enable) {
+  const u8 code[] = {0xA9, 0x8F, 0x8D, 0x10, 0x40, 0xA9, 0x01, 0x8D,
+                     0x13, 0x40, 0xA9, enable, 0x8D, 0x15, 0x40, 0xE6,
+                     0x10, 0x4C, 0x0F, 0xC0};
+  load(code, sizeof(code), NULL, 0);
+}
+
+static void test_dmc_fetches_stall_the_cpu(void) {
+  // All 17 fetches are over by cycle 8000, before the frame interrupt.
+  load_dmc(0x00);
+  nes_run_until(&nes, 8000);
+  u8 loops = nes.cpu.ram[0x10];
+  TEST_ASSERT_EQUAL_HEX8(0, nes.cpu.irq);
+  nes_unload(&nes);
+  unlink(path);
+
+  load_dmc(APU_STATUS_DMC);
+  nes_run_until(&nes, 8000);
+  // 4 cycles each out of the 8-cycle loop.
+  u8 lost = loops - nes.cpu.ram[0x10];
+  TEST_ASSERT_TRUE(lost == 17 * 4 / 8 || lost == 17 * 4 / 8 + 1);
+  TEST_ASSERT_EQUAL_HEX8(IRQ_APU, nes.cpu.irq);
+  TEST_ASSERT_EQUAL_HEX8(APU_STATUS_DMC_IRQ,
+                         nes.apu.status & APU_STATUS_DMC_IRQ);
+}
+
+// The cycle the IRQ line first goes up on, checked one cycle at a time. With
+// the DMC left off, that's the frame interrupt.
+static u64 irq_cycle(ApuAudio audio, u8 enable) {
+  load_dmc(enable);
+  TEST_ASSERT_EQUAL_INT(0, apu_set_audio(&nes.apu, audio));
+  for (u64 cycle = 1; !nes.cpu.irq; cycle++) {
+    nes_run_until(&nes, cycle);
+  }
+  u64 at = nes.cpu.cycles;
+  nes_unload(&nes);
+  unlink(path);
+  return at;
+}
+
+static void test_headless_audio_keeps_irq_timing(void) {
+  u64 frame = irq_cycle(APU_AUDIO_FULL, 0);
+  u64 dmc = irq_cycle(APU_AUDIO_FULL, APU_STATUS_DMC);
+  TEST_ASSERT_UINT64_WITHIN(8, 29830, frame);
+  TEST_ASSERT_TRUE(dmc < frame);
+  TEST_ASSERT_EQUAL_UINT64(frame, irq_cycle(APU_AUDIO_DECIMATED, 0));
+  TEST_ASSERT_EQUAL_UINT64(frame, irq_cycle(APU_AUDIO_OFF, 0));
+  TEST_ASSERT_EQUAL_UINT64(dmc, irq_cycle(APU_AUDIO_DECIMATED, APU_STATUS_DMC));
+  TEST_ASSERT_EQUAL_UINT64(dmc, irq_cycle(APU_AUDIO_OFF, APU_STATUS_DMC));
+}
+
+static void test_mmc3_irq_fires_on_its_scanline(void) {
+  // 32 KiB of MMC3 PRG, running from the fixed bank at $E000.
+  static u8 mmc3[16 + 0x8000 + 0x2000];
+  memcpy(mmc3, "NES\x1A\x02\x01\x40", 7);
+  // LDA #$40; STA $4017 (no frame interrupts); LDA #$08; STA $2000;
+  // LDA #$18; STA $2001; LDA #$0F; STA $C000; STA $C001; STA $E001; CLI;
+  // JMP *
+  const u8 code[] = {0xA9, 0x40, 0x8D, 0x17, 0x40, 0xA9, 0x08, 0x8D, 0x00,
+                     0x20, 0xA9, 0x18, 0x8D, 0x01, 0x20, 0xA9, 0x0F, 0x8D,
+                     0x00, 0xC0, 0x8D, 0x01, 0xC0, 0x8D, 0x01, 0xE0, 0x58,
+                     0x4C, 0x1B, 0xE0};
+  // STA $E000; STA $E001; INC $10; RTI
+  const u8 handler[] = {0x8D, 0x00, 0xE0, 0x8D, 0x01, 0xE0, 0xE6, 0x10, 0x40};
+  u8 *last = mmc3 + 16 + 0x6000;
+  memcpy(last, code, sizeof(code));
+  memcpy(last + 0x100, handler, sizeof(handler));
+  last[0x1FFC] = 0x00; // Reset at $E000
+  last[0x1FFD] = 0xE0;
+  last[0x1FFE] = 0x00; // IRQ at $E100
+  last[0x1FFF] = 0xE1;
+  load_image(mmc3, sizeof(mmc3));
+
+  // Sprites at $1000 raise A12 at dot 260 of every rendered line, so the
+  // 16th rise, the first IRQ, is on line 15, during CPU cycle 1792.
+  nes_run_until(&nes, 1785);
+  TEST_ASSERT_EQUAL_HEX8(0, nes.cpu.ram[0x10]);
+  nes_run_until(&nes, 1792 + 7 + 20);
+  TEST_ASSERT_EQUAL_HEX8(1, nes.cpu.ram[0x10]);
+  // 241 rises a frame: every line drawn and the pre-render line.
+  nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(2));
+  TEST_ASSERT_EQUAL_HEX8(2 * 241 / 16, nes.cpu.ram[0x10]);
+}
+
+static void test_reset_clears_the_registers(void) {
+  // INC $11; LDX $11; DEX; BNE +5; LDA #$80; STA $2000; JMP $C00C -- NMIs are
+  // only turned on the first time through.
+  const u8 code[] = {0xE6, 0x11, 0xA6, 0x11, 0xCA, 0xD0, 0x05, 0xA9,
+                     0x80, 0x8D, 0x00, 0x20, 0x4C, 0x0C, 0xC0};
+  // INC $10; RTI
+  const u8 handler[] = {0xE6, 0x10, 0x40};
+  load(code, sizeof(code), handler, sizeof(handler));
+  nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(3));
+  TEST_ASSERT_EQUAL_HEX8(3, nes.cpu.ram[0x10]);
+
+  u64 cycles = nes.cpu.cycles;
+  nes_reset(&nes);
+  TEST_ASSERT_EQUAL_HEX16(0xC000, nes.cpu.PC);
+  TEST_ASSERT_EQUAL_UINT64(cycles + 7, nes.cpu.cycles);
+  TEST_ASSERT_EQUAL_HEX8(0, nes.ppu.ctrl);
+  nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(6));
+  TEST_ASSERT_EQUAL_HEX8(2, nes.cpu.ram[0x11]);
+  TEST_ASSERT_EQUAL_HEX8(3, nes.cpu.ram[0x10]);
+}
+
+static void test_failed_load_unmaps_the_cartridge(void) {
+  image[6] = 0x51; // MMC5
+  strcpy(path, "/tmp/melnes_nes_XXXXXX");
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  TEST_ASSERT_EQUAL(sizeof(image), write(fd, image, sizeof(image)));
+  close(fd);
+  TEST_ASSERT_EQUAL(ROM_ERR_MAPPER, nes_load(&nes, path));
+  for (u32 page = 0x80; page <= 0xFF; page++) {
+    TEST_ASSERT_NULL(nes.cpu.bus.read[page]);
+    TEST_ASSERT_NULL(nes.cpu.bus.ctx[page]);
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_enabling_nmi_reschedules);
+  RUN_TEST(test_accesses_are_timed_on_their_last_cycle);
+  RUN_TEST(test_oam_dma_stall_follows_the_write_cycle);
+  RUN_TEST(test_frame_irq_interrupts_the_cpu);
+  RUN_TEST(test_dmc_fetches_stall_the_cpu);
+  RUN_TEST(test_headless_audio_keeps_irq_timing);
+  RUN_TEST(test_mmc3_irq_fires_on_its_scanline);
+  RUN_TEST(test_reset_clears_the_registers);
+  RUN_TEST(test_failed_load_unmaps_the_cartridge);
+  return UNITY_END();
+}
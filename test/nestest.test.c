@@ -0,0 +1,90 @@
+#include "emu.h"
+#include "nes.h"
+#include "trace.h"
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Runs nestest.nes in automation mode and diffs every instruction against
+// the golden log. Neither file ships with the repo; put them in test/roms or
+// point NESTEST_ROM and NESTEST_LOG at them, otherwise the test is ignored.
+#define NESTEST_ENTRIES 4096
+
+NES nes;
+Trace trace;
+FILE *log_file;
+
+static const char *path_or(const char *var, const char *fallback) {
+  const char *path = getenv(var);
+  return path ? path : fallback;
+}
+
+void setUp(void) {
+  const char *rom = path_or("NESTEST_ROM", "./test/roms/nestest.nes");
+  const char *log = path_or("NESTEST_LOG", "./test/roms/nestest.log");
+  log_file = fopen(log, "r");
+  if (!log_file || nes_load(&nes, rom) != ROM_OK) {
+    TEST_IGNORE_MESSAGE("nestest.nes or nestest.log not found");
+  }
+  TEST_ASSERT_EQUAL_INT(0, trace_init(&trace, NESTEST_ENTRIES));
+  nes.cpu.trace = &trace;
+  nes.cpu.PC = 0xC000; // Automation mode, no PPU needed
+}
+
+void tearDown(void) {
+  if (log_file) {
+    fclose(log_file);
+    log_file = NULL;
+  }
+  trace_free(&trace);
+  nes_unload(&nes);
+}
+
+// nestest.log also prints the memory an instruction touches, which the trace
+// doesn't record, so only the address, the opcode bytes, the mnemonic and
+// everything from the registers on are compared.
+static int lines_match(const char *expected, const char *actual) {
+  const char *expected_regs = strstr(expected, "A:");
+  const char *actual_regs = strstr(actual, "A:");
+  return expected_regs && actual_regs &&
+         strncmp(expected, actual, 15) == 0 &&
+         strncmp(expected + 16, actual + 16, 3) == 0 &&
+         strcmp(expected_regs, actual_regs) == 0;
+}
+
+static void test_official_opcodes_match_log(void) {
+  char expected[TRACE_LINE_SIZE];
+  char actual[TRACE_LINE_SIZE];
+  u64 line = 0;
+  while (fgets(expected, sizeof(expected), log_file)) {
+    expected[strcspn(expected, "\r\n")] = '\0';
+    // Unofficial opcodes, marked with a *, come last and aren't emulated.
+    if (expected[15] == '*') {
+      break;
+    }
+    if (line == trace.count) {
+      TEST_ASSERT_FALSE_MESSAGE(nes.cpu.halted, "CPU halted early");
+      // Two cycles at least per instruction, so the ring can't wrap.
+      run_until(&nes.cpu, nes.cpu.cycles + NESTEST_ENTRIES);
+    }
+    trace_format(actual, &trace.entries[line & trace.mask]);
+    line++;
+    if (!lines_match(expected, actual)) {
+      char message[3 * TRACE_LINE_SIZE];
+      snprintf(message, sizeof(message),
+               "line %llu\n  expected: %s\n  actual:   %s",
+               (unsigned long long)line, expected, actual);
+      TEST_FAIL_MESSAGE(message);
+    }
+  }
+  TEST_ASSERT_TRUE(line > 0);
+  // nestest's own verdict: the first failing test's number, 0 for none.
+  TEST_ASSERT_EQUAL_HEX8(0, nes.cpu.bus.read[0][0x02]);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_official_opcodes_match_log);
+  return UNITY_END();
+}
@@ -1,18 +1,22 @@
+#include "bus.h"
 #include "opcode.h"
 #include "unity.h"
 
 CPU cpu;
+u8 mem[0x10000];
 
 void setUp(void) {
-  cpu.P = 0b00100000;
+  set_status(&cpu, 0b00100000);
   cpu.A = 0;
   cpu.X = 0;
   cpu.Y = 0;
   cpu.S = 0xFF;
   cpu.PC = 0;
   for (int i = 0; i < 0x10000; i++) {
-    cpu.mem[i] = 0;
+    mem[i] = 0;
   }
+  bus_init(&cpu.bus);
+  bus_map(&cpu.bus, 0x00, 0xFF, mem, sizeof(mem), 1);
 }
 
 void tearDown(void) {
@@ -20,8 +24,8 @@ void tearDown(void) {
 }
 
 static void test_lda_immediate(void) {
-  cpu.mem[0] = LDA_IMM;
-  cpu.mem[1] = 0x42;
+  mem[0] = LDA_IMM;
+  mem[1] = 0x42;
   lda_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x42, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -29,9 +33,9 @@ static void test_lda_immediate(void) {
 }
 
 static void test_lda_zeropage(void) {
-  cpu.mem[0] = LDA_ZP;
-  cpu.mem[1] = 0x20;
-  cpu.mem[0x20] = 0x55;
+  mem[0] = LDA_ZP;
+  mem[1] = 0x20;
+  mem[0x20] = 0x55;
   lda_zeropage(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x55, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -39,10 +43,10 @@ static void test_lda_zeropage(void) {
 }
 
 static void test_lda_zeropage_x(void) {
-  cpu.mem[0] = LDA_ZPX;
-  cpu.mem[1] = 0x20;
+  mem[0] = LDA_ZPX;
+  mem[1] = 0x20;
   cpu.X = 0x05;
-  cpu.mem[0x25] = 0x66;
+  mem[0x25] = 0x66;
   lda_zeropage_x(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x66, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -50,10 +54,10 @@ static void test_lda_zeropage_x(void) {
 }
 
 static void test_lda_absolute(void) {
-  cpu.mem[0] = LDA_ABS;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
-  cpu.mem[0x1234] = 0x77;
+  mem[0] = LDA_ABS;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
+  mem[0x1234] = 0x77;
   lda_absolute(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x77, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -61,11 +65,11 @@ static void test_lda_absolute(void) {
 }
 
 static void test_lda_absolute_x(void) {
-  cpu.mem[0] = LDA_ABSX;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = LDA_ABSX;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   cpu.X = 0x02;
-  cpu.mem[0x1236] = 0x08;
+  mem[0x1236] = 0x08;
   lda_absolute_x(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x08, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -73,11 +77,11 @@ static void test_lda_absolute_x(void) {
 }
 
 static void test_lda_absolute_y(void) {
-  cpu.mem[0] = LDA_ABSY;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = LDA_ABSY;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   cpu.Y = 0x03;
-  cpu.mem[0x1237] = 0x19;
+  mem[0x1237] = 0x19;
   lda_absolute_y(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x19, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -85,12 +89,12 @@ static void test_lda_absolute_y(void) {
 }
 
 static void test_lda_indirect_x(void) {
-  cpu.mem[0] = LDA_INDX;
-  cpu.mem[1] = 0x20;
+  mem[0] = LDA_INDX;
+  mem[1] = 0x20;
   cpu.X = 0x05;
-  cpu.mem[0x25] = 0x34;
-  cpu.mem[0x26] = 0x12;
-  cpu.mem[0x1234] = 0x2A;
+  mem[0x25] = 0x34;
+  mem[0x26] = 0x12;
+  mem[0x1234] = 0x2A;
   lda_indirect_x(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x2A, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -98,21 +102,37 @@ static void test_lda_indirect_x(void) {
 }
 
 static void test_lda_indirect_y(void) {
-  cpu.mem[0] = LDA_INDY;
-  cpu.mem[1] = 0x20;
+  mem[0] = LDA_INDY;
+  mem[1] = 0x20;
   cpu.Y = 0x05;
-  cpu.mem[0x20] = 0x34;
-  cpu.mem[0x21] = 0x12;
-  cpu.mem[0x1239] = 0x3B;
+  mem[0x20] = 0x34;
+  mem[0x21] = 0x12;
+  mem[0x1239] = 0x3B;
   lda_indirect_y(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x3B, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_NEGATIVE));
 }
 
+static void test_lda_indirect_pointer_wraps(void) {
+  mem[0] = LDA_INDY;
+  mem[1] = 0xFF;
+  mem[0xFF] = 0x34;
+  mem[0x00] = 0x12;
+  mem[0x100] = 0x56;
+  mem[0x1234] = 0x42; // Not $5634, where a pointer read across pages goes
+  lda_indirect_y(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x42, cpu.A);
+  cpu.X = 0x01;
+  mem[1] = 0xFE;
+  mem[0x1234] = 0x77;
+  lda_indirect_x(&cpu);
+  TEST_ASSERT_EQUAL_HEX8(0x77, cpu.A);
+}
+
 static void test_lda_zero_flag(void) {
-  cpu.mem[0] = LDA_IMM;
-  cpu.mem[1] = 0x00;
+  mem[0] = LDA_IMM;
+  mem[1] = 0x00;
   lda_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x00, cpu.A);
   TEST_ASSERT_TRUE(get_flag(&cpu, FLAG_ZERO));
@@ -120,8 +140,8 @@ static void test_lda_zero_flag(void) {
 }
 
 static void test_lda_negative_flag(void) {
-  cpu.mem[0] = LDA_IMM;
-  cpu.mem[1] = 0x80;
+  mem[0] = LDA_IMM;
+  mem[1] = 0x80;
   lda_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x80, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -129,8 +149,8 @@ static void test_lda_negative_flag(void) {
 }
 
 static void test_ldx_immediate(void) {
-  cpu.mem[0] = LDX_IMM;
-  cpu.mem[1] = 0x42;
+  mem[0] = LDX_IMM;
+  mem[1] = 0x42;
   ldx_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x42, cpu.X);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -138,9 +158,9 @@ static void test_ldx_immediate(void) {
 }
 
 static void test_ldx_zeropage(void) {
-  cpu.mem[0] = LDX_ZP;
-  cpu.mem[1] = 0x20;
-  cpu.mem[0x20] = 0x55;
+  mem[0] = LDX_ZP;
+  mem[1] = 0x20;
+  mem[0x20] = 0x55;
   ldx_zeropage(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x55, cpu.X);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -148,10 +168,10 @@ static void test_ldx_zeropage(void) {
 }
 
 static void test_ldx_zeropage_y(void) {
-  cpu.mem[0] = LDX_ZPY;
-  cpu.mem[1] = 0x20;
+  mem[0] = LDX_ZPY;
+  mem[1] = 0x20;
   cpu.Y = 0x05;
-  cpu.mem[0x25] = 0x66;
+  mem[0x25] = 0x66;
   ldx_zeropage_y(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x66, cpu.X);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -159,10 +179,10 @@ static void test_ldx_zeropage_y(void) {
 }
 
 static void test_ldx_absolute(void) {
-  cpu.mem[0] = LDX_ABS;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
-  cpu.mem[0x1234] = 0x77;
+  mem[0] = LDX_ABS;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
+  mem[0x1234] = 0x77;
   ldx_absolute(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x77, cpu.X);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -170,11 +190,11 @@ static void test_ldx_absolute(void) {
 }
 
 static void test_ldx_absolute_y(void) {
-  cpu.mem[0] = LDX_ABSY;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = LDX_ABSY;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   cpu.Y = 0x02;
-  cpu.mem[0x1236] = 0x08;
+  mem[0x1236] = 0x08;
   ldx_absolute_y(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x08, cpu.X);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -182,8 +202,8 @@ static void test_ldx_absolute_y(void) {
 }
 
 static void test_ldx_zero_flag(void) {
-  cpu.mem[0] = LDX_IMM;
-  cpu.mem[1] = 0x00;
+  mem[0] = LDX_IMM;
+  mem[1] = 0x00;
   ldx_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x00, cpu.X);
   TEST_ASSERT_TRUE(get_flag(&cpu, FLAG_ZERO));
@@ -191,8 +211,8 @@ static void test_ldx_zero_flag(void) {
 }
 
 static void test_ldx_negative_flag(void) {
-  cpu.mem[0] = LDX_IMM;
-  cpu.mem[1] = 0x80;
+  mem[0] = LDX_IMM;
+  mem[1] = 0x80;
   ldx_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x80, cpu.X);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -200,8 +220,8 @@ static void test_ldx_negative_flag(void) {
 }
 
 static void test_ldy_immediate(void) {
-  cpu.mem[0] = LDY_IMM;
-  cpu.mem[1] = 0x42;
+  mem[0] = LDY_IMM;
+  mem[1] = 0x42;
   ldy_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x42, cpu.Y);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -209,9 +229,9 @@ static void test_ldy_immediate(void) {
 }
 
 static void test_ldy_zeropage(void) {
-  cpu.mem[0] = LDY_ZP;
-  cpu.mem[1] = 0x20;
-  cpu.mem[0x20] = 0x55;
+  mem[0] = LDY_ZP;
+  mem[1] = 0x20;
+  mem[0x20] = 0x55;
   ldy_zeropage(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x55, cpu.Y);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -219,10 +239,10 @@ static void test_ldy_zeropage(void) {
 }
 
 static void test_ldy_zeropage_x(void) {
-  cpu.mem[0] = LDY_ZPX;
-  cpu.mem[1] = 0x20;
+  mem[0] = LDY_ZPX;
+  mem[1] = 0x20;
   cpu.X = 0x05;
-  cpu.mem[0x25] = 0x66;
+  mem[0x25] = 0x66;
   ldy_zeropage_x(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x66, cpu.Y);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -230,10 +250,10 @@ static void test_ldy_zeropage_x(void) {
 }
 
 static void test_ldy_absolute(void) {
-  cpu.mem[0] = LDY_ABS;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
-  cpu.mem[0x1234] = 0x77;
+  mem[0] = LDY_ABS;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
+  mem[0x1234] = 0x77;
   ldy_absolute(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x77, cpu.Y);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -241,11 +261,11 @@ static void test_ldy_absolute(void) {
 }
 
 static void test_ldy_absolute_x(void) {
-  cpu.mem[0] = LDY_ABSX;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = LDY_ABSX;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   cpu.X = 0x02;
-  cpu.mem[0x1236] = 0x08;
+  mem[0x1236] = 0x08;
   ldy_absolute_x(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x08, cpu.Y);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -253,8 +273,8 @@ static void test_ldy_absolute_x(void) {
 }
 
 static void test_ldy_zero_flag(void) {
-  cpu.mem[0] = LDY_IMM;
-  cpu.mem[1] = 0x00;
+  mem[0] = LDY_IMM;
+  mem[1] = 0x00;
   ldy_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x00, cpu.Y);
   TEST_ASSERT_TRUE(get_flag(&cpu, FLAG_ZERO));
@@ -262,8 +282,8 @@ static void test_ldy_zero_flag(void) {
 }
 
 static void test_ldy_negative_flag(void) {
-  cpu.mem[0] = LDY_IMM;
-  cpu.mem[1] = 0x80;
+  mem[0] = LDY_IMM;
+  mem[1] = 0x80;
   ldy_immediate(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x80, cpu.Y);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
@@ -273,86 +293,86 @@ static void test_ldy_negative_flag(void) {
 static void test_sta_zeropage(void) {
   TEST_IGNORE();
   cpu.A = 0x42;
-  cpu.mem[0] = STA_ZP;
-  cpu.mem[1] = 0x20;
+  mem[0] = STA_ZP;
+  mem[1] = 0x20;
   sta_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x42, cpu.mem[0x20]);
+  TEST_ASSERT_EQUAL_HEX8(0x42, mem[0x20]);
 }
 
 static void test_sta_zeropage_x(void) {
   TEST_IGNORE();
   cpu.A = 0x55;
   cpu.X = 0x05;
-  cpu.mem[0] = STA_ZPX;
-  cpu.mem[1] = 0x20;
+  mem[0] = STA_ZPX;
+  mem[1] = 0x20;
   sta_zeropage_x(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x55, cpu.mem[0x25]);
+  TEST_ASSERT_EQUAL_HEX8(0x55, mem[0x25]);
 }
 
 static void test_sta_absolute(void) {
   TEST_IGNORE();
   cpu.A = 0x66;
-  cpu.mem[0] = STA_ABS;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = STA_ABS;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   sta_absolute(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x66, cpu.mem[0x1234]);
+  TEST_ASSERT_EQUAL_HEX8(0x66, mem[0x1234]);
 }
 
 static void test_sta_absolute_x(void) {
   TEST_IGNORE();
   cpu.A = 0x77;
   cpu.X = 0x02;
-  cpu.mem[0] = STA_ABSX;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = STA_ABSX;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   sta_absolute_x(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x77, cpu.mem[0x1236]);
+  TEST_ASSERT_EQUAL_HEX8(0x77, mem[0x1236]);
 }
 
 static void test_sta_absolute_y(void) {
   TEST_IGNORE();
   cpu.A = 0x88;
   cpu.Y = 0x03;
-  cpu.mem[0] = STA_ABSY;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = STA_ABSY;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   sta_absolute_y(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x88, cpu.mem[0x1237]);
+  TEST_ASSERT_EQUAL_HEX8(0x88, mem[0x1237]);
 }
 
 static void test_sta_indirect_x(void) {
   TEST_IGNORE();
   cpu.A = 0x99;
   cpu.X = 0x05;
-  cpu.mem[0] = STA_INDX;
-  cpu.mem[1] = 0x20;
-  cpu.mem[0x25] = 0x34;
-  cpu.mem[0x26] = 0x12;
+  mem[0] = STA_INDX;
+  mem[1] = 0x20;
+  mem[0x25] = 0x34;
+  mem[0x26] = 0x12;
   sta_indirect_x(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x99, cpu.mem[0x1234]);
+  TEST_ASSERT_EQUAL_HEX8(0x99, mem[0x1234]);
 }
 
 static void test_sta_indirect_y(void) {
   TEST_IGNORE();
   cpu.A = 0xAA;
   cpu.Y = 0x05;
-  cpu.mem[0] = STA_INDY;
-  cpu.mem[1] = 0x20;
-  cpu.mem[0x20] = 0x34;
-  cpu.mem[0x21] = 0x12;
+  mem[0] = STA_INDY;
+  mem[1] = 0x20;
+  mem[0x20] = 0x34;
+  mem[0x21] = 0x12;
   sta_indirect_y(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0xAA, cpu.mem[0x1239]);
+  TEST_ASSERT_EQUAL_HEX8(0xAA, mem[0x1239]);
 }
 
 static void test_sta_flags_unchanged_zero(void) {
   TEST_IGNORE();
   u8 original_flags = cpu.P;
   cpu.A = 0x00;
-  cpu.mem[0] = STA_ZP;
-  cpu.mem[1] = 0x30;
+  mem[0] = STA_ZP;
+  mem[1] = 0x30;
   sta_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x00, cpu.mem[0x30]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, mem[0x30]);
   TEST_ASSERT_EQUAL_HEX8(original_flags, cpu.P);
 }
 
@@ -360,50 +380,50 @@ static void test_sta_flags_unchanged_negative(void) {
   TEST_IGNORE();
   u8 original_flags = cpu.P;
   cpu.A = 0x80;
-  cpu.mem[0] = STA_ZP;
-  cpu.mem[1] = 0x31;
+  mem[0] = STA_ZP;
+  mem[1] = 0x31;
   sta_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x80, cpu.mem[0x31]);
+  TEST_ASSERT_EQUAL_HEX8(0x80, mem[0x31]);
   TEST_ASSERT_EQUAL_HEX8(original_flags, cpu.P);
 }
 
 static void test_stx_zeropage(void) {
   TEST_IGNORE();
   cpu.X = 0x42;
-  cpu.mem[0] = STX_ZP;
-  cpu.mem[1] = 0x20;
+  mem[0] = STX_ZP;
+  mem[1] = 0x20;
   stx_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x42, cpu.mem[0x20]);
+  TEST_ASSERT_EQUAL_HEX8(0x42, mem[0x20]);
 }
 
 static void test_stx_zeropage_y(void) {
   TEST_IGNORE();
   cpu.X = 0x55;
   cpu.Y = 0x05;
-  cpu.mem[0] = STX_ZPY;
-  cpu.mem[1] = 0x20;
+  mem[0] = STX_ZPY;
+  mem[1] = 0x20;
   stx_zeropage_y(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x55, cpu.mem[0x25]);
+  TEST_ASSERT_EQUAL_HEX8(0x55, mem[0x25]);
 }
 
 static void test_stx_absolute(void) {
   TEST_IGNORE();
   cpu.X = 0x66;
-  cpu.mem[0] = STX_ABS;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = STX_ABS;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   stx_absolute(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x66, cpu.mem[0x1234]);
+  TEST_ASSERT_EQUAL_HEX8(0x66, mem[0x1234]);
 }
 
 static void test_stx_flags_unchanged_zero(void) {
   TEST_IGNORE();
   u8 original_flags = cpu.P;
   cpu.X = 0x00; // Zero value
-  cpu.mem[0] = STX_ZP;
-  cpu.mem[1] = 0x30;
+  mem[0] = STX_ZP;
+  mem[1] = 0x30;
   stx_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x00, cpu.mem[0x30]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, mem[0x30]);
   TEST_ASSERT_EQUAL_HEX8(original_flags, cpu.P);
 }
 
@@ -411,50 +431,50 @@ static void test_stx_flags_unchanged_negative(void) {
   TEST_IGNORE();
   u8 original_flags = cpu.P;
   cpu.X = 0x80; // Negative value
-  cpu.mem[0] = STX_ZP;
-  cpu.mem[1] = 0x31;
+  mem[0] = STX_ZP;
+  mem[1] = 0x31;
   stx_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x80, cpu.mem[0x31]);
+  TEST_ASSERT_EQUAL_HEX8(0x80, mem[0x31]);
   TEST_ASSERT_EQUAL_HEX8(original_flags, cpu.P);
 }
 
 static void test_sty_zeropage(void) {
   TEST_IGNORE();
   cpu.Y = 0x42;
-  cpu.mem[0] = STY_ZP;
-  cpu.mem[1] = 0x20;
+  mem[0] = STY_ZP;
+  mem[1] = 0x20;
   sty_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x42, cpu.mem[0x20]);
+  TEST_ASSERT_EQUAL_HEX8(0x42, mem[0x20]);
 }
 
 static void test_sty_zeropage_x(void) {
   TEST_IGNORE();
   cpu.Y = 0x55;
   cpu.X = 0x05;
-  cpu.mem[0] = STY_ZPX;
-  cpu.mem[1] = 0x20;
+  mem[0] = STY_ZPX;
+  mem[1] = 0x20;
   sty_zeropage_x(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x55, cpu.mem[0x25]);
+  TEST_ASSERT_EQUAL_HEX8(0x55, mem[0x25]);
 }
 
 static void test_sty_absolute(void) {
   TEST_IGNORE();
   cpu.Y = 0x66;
-  cpu.mem[0] = STY_ABS;
-  cpu.mem[1] = 0x34;
-  cpu.mem[2] = 0x12;
+  mem[0] = STY_ABS;
+  mem[1] = 0x34;
+  mem[2] = 0x12;
   sty_absolute(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x66, cpu.mem[0x1234]);
+  TEST_ASSERT_EQUAL_HEX8(0x66, mem[0x1234]);
 }
 
 static void test_sty_flags_unchanged_zero(void) {
   TEST_IGNORE();
   u8 original_flags = cpu.P;
   cpu.Y = 0x00; // Zero value
-  cpu.mem[0] = STY_ZP;
-  cpu.mem[1] = 0x30;
+  mem[0] = STY_ZP;
+  mem[1] = 0x30;
   sty_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x00, cpu.mem[0x30]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, mem[0x30]);
   TEST_ASSERT_EQUAL_HEX8(original_flags, cpu.P);
 }
 
@@ -462,10 +482,10 @@ static void test_sty_flags_unchanged_negative(void) {
   TEST_IGNORE();
   u8 original_flags = cpu.P;
   cpu.Y = 0x80; // Negative value
-  cpu.mem[0] = STY_ZP;
-  cpu.mem[1] = 0x31;
+  mem[0] = STY_ZP;
+  mem[1] = 0x31;
   sty_zeropage(&cpu);
-  TEST_ASSERT_EQUAL_HEX8(0x80, cpu.mem[0x31]);
+  TEST_ASSERT_EQUAL_HEX8(0x80, mem[0x31]);
   TEST_ASSERT_EQUAL_HEX8(original_flags, cpu.P);
 }
 
@@ -559,8 +579,8 @@ static void test_branch_instructions(void) {
   // Test BCC - Branch if Carry Clear (should branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_CARRY, 0); // Clear carry flag
-  cpu.mem[0x1000] = BCC_REL;
-  cpu.mem[0x1001] = 0x10; // Branch forward 16 bytes
+  mem[0x1000] = BCC_REL;
+  mem[0x1001] = 0x10; // Branch forward 16 bytes
   bcc(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1012, cpu.PC); // 0x1000 + 2 + 0x10
@@ -568,8 +588,8 @@ static void test_branch_instructions(void) {
   // Test BCC - Branch if Carry Clear (should not branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_CARRY, 1); // Set carry flag
-  cpu.mem[0x1000] = BCC_REL;
-  cpu.mem[0x1001] = 0x10;
+  mem[0x1000] = BCC_REL;
+  mem[0x1001] = 0x10;
   bcc(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // PC should advance by 2 only
@@ -577,8 +597,8 @@ static void test_branch_instructions(void) {
   // Test BCS - Branch if Carry Set (should branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_CARRY, 1); // Set carry flag
-  cpu.mem[0x1000] = BCS_REL;
-  cpu.mem[0x1001] = 0x08; // Branch forward 8 bytes
+  mem[0x1000] = BCS_REL;
+  mem[0x1001] = 0x08; // Branch forward 8 bytes
   bcs(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x100A, cpu.PC); // 0x1000 + 2 + 0x08
@@ -586,8 +606,8 @@ static void test_branch_instructions(void) {
   // Test BCS - Branch if Carry Set (should not branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_CARRY, 0); // Clear carry flag
-  cpu.mem[0x1000] = BCS_REL;
-  cpu.mem[0x1001] = 0x08;
+  mem[0x1000] = BCS_REL;
+  mem[0x1001] = 0x08;
   bcs(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // PC should advance by 2 only
@@ -595,8 +615,8 @@ static void test_branch_instructions(void) {
   // Test BEQ - Branch if Equal (should branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_ZERO, 1); // Set zero flag
-  cpu.mem[0x1000] = BEQ_REL;
-  cpu.mem[0x1001] = 0x05; // Branch forward 5 bytes
+  mem[0x1000] = BEQ_REL;
+  mem[0x1001] = 0x05; // Branch forward 5 bytes
   beq(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1007, cpu.PC); // 0x1000 + 2 + 0x05
@@ -604,8 +624,8 @@ static void test_branch_instructions(void) {
   // Test BEQ - Branch if Equal (should not branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_ZERO, 0); // Clear zero flag
-  cpu.mem[0x1000] = BEQ_REL;
-  cpu.mem[0x1001] = 0x05;
+  mem[0x1000] = BEQ_REL;
+  mem[0x1001] = 0x05;
   beq(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // PC should advance by 2 only
@@ -613,8 +633,8 @@ static void test_branch_instructions(void) {
   // Test BNE - Branch if Not Equal (should branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_ZERO, 0); // Clear zero flag
-  cpu.mem[0x1000] = BNE_REL;
-  cpu.mem[0x1001] = 0x0C; // Branch forward 12 bytes
+  mem[0x1000] = BNE_REL;
+  mem[0x1001] = 0x0C; // Branch forward 12 bytes
   bne(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x100E, cpu.PC); // 0x1000 + 2 + 0x0C
@@ -622,8 +642,8 @@ static void test_branch_instructions(void) {
   // Test BNE - Branch if Not Equal (should not branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_ZERO, 1); // Set zero flag
-  cpu.mem[0x1000] = BNE_REL;
-  cpu.mem[0x1001] = 0x0C;
+  mem[0x1000] = BNE_REL;
+  mem[0x1001] = 0x0C;
   bne(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // PC should advance by 2 only
@@ -631,8 +651,8 @@ static void test_branch_instructions(void) {
   // Test BMI - Branch if Minus (should branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_NEGATIVE, 1); // Set negative flag
-  cpu.mem[0x1000] = BMI_REL;
-  cpu.mem[0x1001] = 0x07; // Branch forward 7 bytes
+  mem[0x1000] = BMI_REL;
+  mem[0x1001] = 0x07; // Branch forward 7 bytes
   bmi(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1009, cpu.PC); // 0x1000 + 2 + 0x07
@@ -640,8 +660,8 @@ static void test_branch_instructions(void) {
   // Test BMI - Branch if Minus (should not branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_NEGATIVE, 0); // Clear negative flag
-  cpu.mem[0x1000] = BMI_REL;
-  cpu.mem[0x1001] = 0x07;
+  mem[0x1000] = BMI_REL;
+  mem[0x1001] = 0x07;
   bmi(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // PC should advance by 2 only
@@ -649,8 +669,8 @@ static void test_branch_instructions(void) {
   // Test BPL - Branch if Positive (should branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_NEGATIVE, 0); // Clear negative flag
-  cpu.mem[0x1000] = BPL_REL;
-  cpu.mem[0x1001] = 0x0A; // Branch forward 10 bytes
+  mem[0x1000] = BPL_REL;
+  mem[0x1001] = 0x0A; // Branch forward 10 bytes
   bpl(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x100C, cpu.PC); // 0x1000 + 2 + 0x0A
@@ -658,8 +678,8 @@ static void test_branch_instructions(void) {
   // Test BPL - Branch if Positive (should not branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_NEGATIVE, 1); // Set negative flag
-  cpu.mem[0x1000] = BPL_REL;
-  cpu.mem[0x1001] = 0x0A;
+  mem[0x1000] = BPL_REL;
+  mem[0x1001] = 0x0A;
   bpl(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // PC should advance by 2 only
@@ -667,8 +687,8 @@ static void test_branch_instructions(void) {
   // Test BVC - Branch if Overflow Clear (should branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_OVERFLOW, 0); // Clear overflow flag
-  cpu.mem[0x1000] = BVC_REL;
-  cpu.mem[0x1001] = 0x06; // Branch forward 6 bytes
+  mem[0x1000] = BVC_REL;
+  mem[0x1001] = 0x06; // Branch forward 6 bytes
   bvc(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1008, cpu.PC); // 0x1000 + 2 + 0x06
@@ -676,8 +696,8 @@ static void test_branch_instructions(void) {
   // Test BVC - Branch if Overflow Clear (should not branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_OVERFLOW, 1); // Set overflow flag
-  cpu.mem[0x1000] = BVC_REL;
-  cpu.mem[0x1001] = 0x06;
+  mem[0x1000] = BVC_REL;
+  mem[0x1001] = 0x06;
   bvc(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // PC should advance by 2 only
@@ -685,8 +705,8 @@ static void test_branch_instructions(void) {
   // Test BVS - Branch if Overflow Set (should branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_OVERFLOW, 1); // Set overflow flag
-  cpu.mem[0x1000] = BVS_REL;
-  cpu.mem[0x1001] = 0x04; // Branch forward 4 bytes
+  mem[0x1000] = BVS_REL;
+  mem[0x1001] = 0x04; // Branch forward 4 bytes
   bvs(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1006, cpu.PC); // 0x1000 + 2 + 0x04
@@ -694,8 +714,8 @@ static void test_branch_instructions(void) {
   // Test BVS - Branch if Overflow Set (should not branch)
   cpu.PC = 0x1000;
   set_flag(&cpu, FLAG_OVERFLOW, 0); // Clear overflow flag
-  cpu.mem[0x1000] = BVS_REL;
-  cpu.mem[0x1001] = 0x04;
+  mem[0x1000] = BVS_REL;
+  mem[0x1001] = 0x04;
   bvs(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // PC should advance by 2 only
@@ -703,8 +723,8 @@ static void test_branch_instructions(void) {
   // Test backward branch with negative offset
   cpu.PC = 0x1010;
   set_flag(&cpu, FLAG_ZERO, 1); // Set zero flag for BEQ
-  cpu.mem[0x1010] = BEQ_REL;
-  cpu.mem[0x1011] = 0xF0; // -16 in two's complement
+  mem[0x1010] = BEQ_REL;
+  mem[0x1011] = 0xF0; // -16 in two's complement
   beq(&cpu);
   cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC); // 0x1010 + 2 + (-16) = 0x1002
@@ -717,13 +737,13 @@ static void test_stack_instructions(void) {
   cpu.S = 0xFF; // Reset stack pointer
   pha(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFE, cpu.S);           // Stack pointer decremented
-  TEST_ASSERT_EQUAL_HEX8(0x42, cpu.mem[0x01FF]); // Value pushed to stack
+  TEST_ASSERT_EQUAL_HEX8(0x42, mem[0x01FF]); // Value pushed to stack
 
   // Test PHA multiple times
   cpu.A = 0x33;
   pha(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFD, cpu.S);
-  TEST_ASSERT_EQUAL_HEX8(0x33, cpu.mem[0x01FE]);
+  TEST_ASSERT_EQUAL_HEX8(0x33, mem[0x01FE]);
 
   // Test PLA - Pull Accumulator
   cpu.A = 0x00; // Clear accumulator
@@ -742,7 +762,7 @@ static void test_stack_instructions(void) {
   // Test PLA with zero value
   cpu.A = 0x00;
   cpu.S = 0xFE;
-  cpu.mem[0x01FF] = 0x00; // Put zero on stack
+  mem[0x01FF] = 0x00; // Put zero on stack
   pla(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x00, cpu.A);
   TEST_ASSERT_EQUAL_HEX8(FLAG_ZERO, get_flag(&cpu, FLAG_ZERO));
@@ -751,7 +771,7 @@ static void test_stack_instructions(void) {
   // Test PLA with negative value
   cpu.A = 0x00;
   cpu.S = 0xFE;
-  cpu.mem[0x01FF] = 0x80; // Put negative value on stack
+  mem[0x01FF] = 0x80; // Put negative value on stack
   pla(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x80, cpu.A);
   TEST_ASSERT_EQUAL_HEX8(0, get_flag(&cpu, FLAG_ZERO));
@@ -764,12 +784,12 @@ static void test_stack_instructions(void) {
   TEST_ASSERT_EQUAL_HEX8(0xFE, cpu.S); // Stack pointer decremented
   // PHP should push P with break flag set
   TEST_ASSERT_EQUAL_HEX8(0b11110011,
-                         cpu.mem[0x01FF]); // Break flag should be set
+                         mem[0x01FF]); // Break flag should be set
 
   // Test PLP - Pull Processor Status
   cpu.P = 0x00; // Clear all flags
   cpu.S = 0xFE;
-  cpu.mem[0x01FF] = 0b10100101; // Some flag pattern
+  mem[0x01FF] = 0b10100101; // Some flag pattern
   plp(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFF, cpu.S); // Stack pointer incremented
   // PLP should ignore break flag and bit 5
@@ -781,7 +801,7 @@ static void test_stack_instructions(void) {
   cpu.A = 0x99;
   pha(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFF, cpu.S);           // Should wrap to 0xFF
-  TEST_ASSERT_EQUAL_HEX8(0x99, cpu.mem[0x0100]); // Should store at 0x0100
+  TEST_ASSERT_EQUAL_HEX8(0x99, mem[0x0100]); // Should store at 0x0100
 
   cpu.A = 0x00;
   cpu.S = 0xFF; // Stack at top
@@ -804,103 +824,103 @@ static void test_stack_instructions(void) {
 static void test_bcc_branches(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_CARRY, 0);
-  cpu.mem[0x1000] = BCC_REL; cpu.mem[0x1001] = 0x10; bcc(&cpu); cpu.PC += 2;
+  mem[0x1000] = BCC_REL; mem[0x1001] = 0x10; bcc(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1012, cpu.PC);
 }
 static void test_bcc_no_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_CARRY, 1);
-  cpu.mem[0x1000] = BCC_REL; cpu.mem[0x1001] = 0x10; bcc(&cpu); cpu.PC += 2;
+  mem[0x1000] = BCC_REL; mem[0x1001] = 0x10; bcc(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 static void test_bcs_branches(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_CARRY, 1);
-  cpu.mem[0x1000] = BCS_REL; cpu.mem[0x1001] = 0x08; bcs(&cpu); cpu.PC += 2;
+  mem[0x1000] = BCS_REL; mem[0x1001] = 0x08; bcs(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x100A, cpu.PC);
 }
 static void test_bcs_no_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_CARRY, 0);
-  cpu.mem[0x1000] = BCS_REL; cpu.mem[0x1001] = 0x08; bcs(&cpu); cpu.PC += 2;
+  mem[0x1000] = BCS_REL; mem[0x1001] = 0x08; bcs(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 static void test_beq_branches(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_ZERO, 1);
-  cpu.mem[0x1000] = BEQ_REL; cpu.mem[0x1001] = 0x0A; beq(&cpu); cpu.PC += 2;
+  mem[0x1000] = BEQ_REL; mem[0x1001] = 0x0A; beq(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x100C, cpu.PC);
 }
 static void test_beq_no_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_ZERO, 0);
-  cpu.mem[0x1000] = BEQ_REL; cpu.mem[0x1001] = 0x0A; beq(&cpu); cpu.PC += 2;
+  mem[0x1000] = BEQ_REL; mem[0x1001] = 0x0A; beq(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 static void test_bmi_branches(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_NEGATIVE, 1);
-  cpu.mem[0x1000] = BMI_REL; cpu.mem[0x1001] = 0x04; bmi(&cpu); cpu.PC += 2;
+  mem[0x1000] = BMI_REL; mem[0x1001] = 0x04; bmi(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1006, cpu.PC);
 }
 static void test_bmi_no_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_NEGATIVE, 0);
-  cpu.mem[0x1000] = BMI_REL; cpu.mem[0x1001] = 0x04; bmi(&cpu); cpu.PC += 2;
+  mem[0x1000] = BMI_REL; mem[0x1001] = 0x04; bmi(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 static void test_bne_branches(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_ZERO, 0);
-  cpu.mem[0x1000] = BNE_REL; cpu.mem[0x1001] = 0x0C; bne(&cpu); cpu.PC += 2;
+  mem[0x1000] = BNE_REL; mem[0x1001] = 0x0C; bne(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x100E, cpu.PC);
 }
 static void test_bne_no_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_ZERO, 1);
-  cpu.mem[0x1000] = BNE_REL; cpu.mem[0x1001] = 0x0C; bne(&cpu); cpu.PC += 2;
+  mem[0x1000] = BNE_REL; mem[0x1001] = 0x0C; bne(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 static void test_bpl_branches(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_NEGATIVE, 0);
-  cpu.mem[0x1000] = BPL_REL; cpu.mem[0x1001] = 0x0A; bpl(&cpu); cpu.PC += 2;
+  mem[0x1000] = BPL_REL; mem[0x1001] = 0x0A; bpl(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x100C, cpu.PC);
 }
 static void test_bpl_no_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_NEGATIVE, 1);
-  cpu.mem[0x1000] = BPL_REL; cpu.mem[0x1001] = 0x0A; bpl(&cpu); cpu.PC += 2;
+  mem[0x1000] = BPL_REL; mem[0x1001] = 0x0A; bpl(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 static void test_bvc_branches(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_OVERFLOW, 0);
-  cpu.mem[0x1000] = BVC_REL; cpu.mem[0x1001] = 0x06; bvc(&cpu); cpu.PC += 2;
+  mem[0x1000] = BVC_REL; mem[0x1001] = 0x06; bvc(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1008, cpu.PC);
 }
 static void test_bvc_no_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_OVERFLOW, 1);
-  cpu.mem[0x1000] = BVC_REL; cpu.mem[0x1001] = 0x06; bvc(&cpu); cpu.PC += 2;
+  mem[0x1000] = BVC_REL; mem[0x1001] = 0x06; bvc(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 static void test_bvs_branches(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_OVERFLOW, 1);
-  cpu.mem[0x1000] = BVS_REL; cpu.mem[0x1001] = 0x04; bvs(&cpu); cpu.PC += 2;
+  mem[0x1000] = BVS_REL; mem[0x1001] = 0x04; bvs(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1006, cpu.PC);
 }
 static void test_bvs_no_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1000; set_flag(&cpu, FLAG_OVERFLOW, 0);
-  cpu.mem[0x1000] = BVS_REL; cpu.mem[0x1001] = 0x04; bvs(&cpu); cpu.PC += 2;
+  mem[0x1000] = BVS_REL; mem[0x1001] = 0x04; bvs(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 static void test_beq_backward_branch(void) {
   TEST_IGNORE();
   cpu.PC = 0x1010; set_flag(&cpu, FLAG_ZERO, 1);
-  cpu.mem[0x1010] = BEQ_REL; cpu.mem[0x1011] = 0xF0; beq(&cpu); cpu.PC += 2;
+  mem[0x1010] = BEQ_REL; mem[0x1011] = 0xF0; beq(&cpu); cpu.PC += 2;
   TEST_ASSERT_EQUAL_HEX16(0x1002, cpu.PC);
 }
 
@@ -909,14 +929,14 @@ static void test_pha_push_basic(void) {
   TEST_IGNORE();
   cpu.A = 0x42; cpu.S = 0xFF; pha(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFE, cpu.S);
-  TEST_ASSERT_EQUAL_HEX8(0x42, cpu.mem[0x01FF]);
+  TEST_ASSERT_EQUAL_HEX8(0x42, mem[0x01FF]);
 }
 static void test_pha_multiple(void) {
   TEST_IGNORE();
   cpu.A = 0x42; cpu.S = 0xFF; pha(&cpu);
   cpu.A = 0x33; pha(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFD, cpu.S);
-  TEST_ASSERT_EQUAL_HEX8(0x33, cpu.mem[0x01FE]);
+  TEST_ASSERT_EQUAL_HEX8(0x33, mem[0x01FE]);
 }
 static void test_pla_basic(void) {
   TEST_IGNORE();
@@ -928,14 +948,14 @@ static void test_pla_basic(void) {
 }
 static void test_pla_zero_sets_flag(void) {
   TEST_IGNORE();
-  cpu.A = 0x00; cpu.S = 0xFE; cpu.mem[0x01FF] = 0x00; pla(&cpu);
+  cpu.A = 0x00; cpu.S = 0xFE; mem[0x01FF] = 0x00; pla(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x00, cpu.A);
   TEST_ASSERT_TRUE(get_flag(&cpu, FLAG_ZERO));
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_NEGATIVE));
 }
 static void test_pla_negative_sets_flag(void) {
   TEST_IGNORE();
-  cpu.A = 0x00; cpu.S = 0xFE; cpu.mem[0x01FF] = 0x80; pla(&cpu);
+  cpu.A = 0x00; cpu.S = 0xFE; mem[0x01FF] = 0x80; pla(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x80, cpu.A);
   TEST_ASSERT_FALSE(get_flag(&cpu, FLAG_ZERO));
   TEST_ASSERT_TRUE(get_flag(&cpu, FLAG_NEGATIVE));
@@ -944,11 +964,11 @@ static void test_php_push_sets_break_bit(void) {
   TEST_IGNORE();
   cpu.S = 0xFF; cpu.P = 0b11010011; php(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFE, cpu.S);
-  TEST_ASSERT_EQUAL_HEX8(0b11110011, cpu.mem[0x01FF]);
+  TEST_ASSERT_EQUAL_HEX8(0b11110011, mem[0x01FF]);
 }
 static void test_plp_pull_status_masks_break_and_sets_bit5(void) {
   TEST_IGNORE();
-  cpu.P = 0x00; cpu.S = 0xFE; cpu.mem[0x01FF] = 0b10100101; plp(&cpu);
+  cpu.P = 0x00; cpu.S = 0xFE; mem[0x01FF] = 0b10100101; plp(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFF, cpu.S);
   TEST_ASSERT_EQUAL_HEX8(0b10100101 & ~FLAG_BREAK, cpu.P & ~FLAG_BREAK);
   TEST_ASSERT_EQUAL_HEX8(0b00100000, cpu.P & 0b00100000);
@@ -957,7 +977,7 @@ static void test_stack_wraparound_push_pull(void) {
   TEST_IGNORE();
   cpu.S = 0x00; cpu.A = 0x99; pha(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0xFF, cpu.S);
-  TEST_ASSERT_EQUAL_HEX8(0x99, cpu.mem[0x0100]);
+  TEST_ASSERT_EQUAL_HEX8(0x99, mem[0x0100]);
   cpu.A = 0x00; cpu.S = 0xFF; pla(&cpu);
   TEST_ASSERT_EQUAL_HEX8(0x00, cpu.S);
   TEST_ASSERT_EQUAL_HEX8(0x99, cpu.A);
@@ -993,6 +1013,7 @@ int main(void) {
   RUN_TEST(test_lda_absolute_y);
   RUN_TEST(test_lda_indirect_x);
   RUN_TEST(test_lda_indirect_y);
+  RUN_TEST(test_lda_indirect_pointer_wraps);
   RUN_TEST(test_lda_zero_flag);
   RUN_TEST(test_lda_negative_flag);
 
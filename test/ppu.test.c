@@ -0,0 +1,255 @@
+#include "ppu.h"
+#include "unity.h"
+#include <string.h>
+
+PPU ppu;
+PPU reference;
+Rom rom;
+
+void setUp(void) {
+  memset(&rom, 0, sizeof(rom));
+  rom.mirroring = MIRROR_VERTICAL;
+  ppu_power_on(&ppu, &rom);
+}
+
+void tearDown(void) {
+  // Clean up if needed
+}
+
+static u32 seed;
+
+static u8 random_byte(void) {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 16;
+}
+
+// Random patterns, nametables and palette with sprites scattered over the
+// screen, sprite 0 overlapping the background.
+static void fill_scene(PPU *p, u8 ctrl, u8 mask, u8 scroll_x, u8 scroll_y) {
+  seed = 1;
+  for (u32 addr = 0; addr < 0x3000; addr++) {
+    ppu_write(p, addr, random_byte());
+  }
+  for (u32 addr = 0x3F00; addr < 0x3F20; addr++) {
+    ppu_write(p, addr, random_byte());
+  }
+  for (u32 i = 0; i < 256; i++) {
+    p->oam[i] = random_byte();
+  }
+  p->oam[0] = 40;
+  p->oam[3] = 100;
+  ppu_write_register(p, 0x2000, ctrl);
+  ppu_write_register(p, 0x2005, scroll_x);
+  ppu_write_register(p, 0x2005, scroll_y);
+  ppu_write_register(p, 0x2001, mask);
+}
+
+static void assert_renderers_agree(u8 ctrl, u8 mask, u8 scroll_x,
+                                   u8 scroll_y) {
+  ppu_power_on(&reference, &rom);
+  fill_scene(&ppu, ctrl, mask, scroll_x, scroll_y);
+  fill_scene(&reference, ctrl, mask, scroll_x, scroll_y);
+  u64 end = 3 * PPU_LINES_PER_FRAME * PPU_DOTS_PER_LINE;
+
+  ppu_run_to(&ppu, end);
+  while (reference.dots < end) {
+    ppu_run_to(&reference, reference.dots + 1);
+  }
+
+  TEST_ASSERT_TRUE(ppu.fast_lines > 0);
+  TEST_ASSERT_EQUAL_UINT32(0, reference.fast_lines);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(reference.framebuffer, ppu.framebuffer,
+                               sizeof(ppu.framebuffer));
+  TEST_ASSERT_EQUAL_HEX16(reference.v, ppu.v);
+  TEST_ASSERT_EQUAL_HEX8(reference.status, ppu.status);
+  TEST_ASSERT_EQUAL_UINT16(reference.scanline, ppu.scanline);
+  TEST_ASSERT_EQUAL_UINT16(reference.dot, ppu.dot);
+}
+
+static void test_scroll_registers(void) {
+  ppu_write_register(&ppu, 0x2000, 0x03);
+  ppu_write_register(&ppu, 0x2005, 0x7D); // Coarse X 15, fine X 5
+  ppu_write_register(&ppu, 0x2005, 0x5E); // Coarse Y 11, fine Y 6
+  TEST_ASSERT_EQUAL_HEX16(0x6D6F, ppu.t);
+  TEST_ASSERT_EQUAL_HEX8(5, ppu.x);
+  TEST_ASSERT_EQUAL_HEX8(0, ppu.w);
+
+  ppu_write_register(&ppu, 0x2006, 0x3D);
+  TEST_ASSERT_EQUAL_HEX8(1, ppu.w);
+  ppu_write_register(&ppu, 0x2006, 0xF0);
+  TEST_ASSERT_EQUAL_HEX16(0x3DF0, ppu.t);
+  TEST_ASSERT_EQUAL_HEX16(0x3DF0, ppu.v);
+
+  ppu_write_register(&ppu, 0x2006, 0x12);
+  ppu_read_register(&ppu, 0x2002); // Resets the toggle
+  ppu_write_register(&ppu, 0x2006, 0x21);
+  ppu_write_register(&ppu, 0x2006, 0x08);
+  TEST_ASSERT_EQUAL_HEX16(0x2108, ppu.v);
+}
+
+static void test_data_port(void) {
+  ppu_write_register(&ppu, 0x2006, 0x20);
+  ppu_write_register(&ppu, 0x2006, 0x00);
+  ppu_write_register(&ppu, 0x2007, 0x11);
+  ppu_write_register(&ppu, 0x2000, PPU_CTRL_INCREMENT);
+  ppu_write_register(&ppu, 0x2007, 0x22);
+  TEST_ASSERT_EQUAL_HEX16(0x2021, ppu.v);
+  TEST_ASSERT_EQUAL_HEX8(0x22, ppu_read(&ppu, 0x2001));
+
+  // Reads lag one behind, except from the palette.
+  ppu_write_register(&ppu, 0x2000, 0);
+  ppu_write_register(&ppu, 0x2006, 0x20);
+  ppu_write_register(&ppu, 0x2006, 0x00);
+  ppu_read_register(&ppu, 0x2007);
+  TEST_ASSERT_EQUAL_HEX8(0x11, ppu_read_register(&ppu, 0x2007));
+  ppu_write(&ppu, 0x3F01, 0x2A);
+  ppu_write_register(&ppu, 0x2006, 0x3F);
+  ppu_write_register(&ppu, 0x2006, 0x01);
+  TEST_ASSERT_EQUAL_HEX8(0x2A, ppu_read_register(&ppu, 0x2007) & 0x3F);
+}
+
+static void test_mirroring(void) {
+  ppu_write(&ppu, 0x2005, 0x77);
+  TEST_ASSERT_EQUAL_HEX8(0x77, ppu_read(&ppu, 0x2805));
+  ppu_set_mirroring(&ppu, MIRROR_HORIZONTAL);
+  TEST_ASSERT_EQUAL_HEX8(0x77, ppu_read(&ppu, 0x2405));
+  ppu_write(&ppu, 0x3F10, 0x0F);
+  TEST_ASSERT_EQUAL_HEX8(0x0F, ppu_read(&ppu, 0x3F00));
+  ppu_write(&ppu, 0x3F04, 0x30);
+  TEST_ASSERT_EQUAL_HEX8(0x30, ppu_read(&ppu, 0x3F14));
+}
+
+static void test_vblank_and_nmi(void) {
+  ppu_write_register(&ppu, 0x2000, PPU_CTRL_NMI);
+  u32 vblank = PPU_VBLANK_LINE * PPU_DOTS_PER_LINE + 1;
+  TEST_ASSERT_EQUAL_UINT32(vblank, ppu_dots_to_vblank(&ppu));
+  ppu_run_to(&ppu, vblank);
+  TEST_ASSERT_FALSE(ppu.nmi);
+  ppu_run_to(&ppu, vblank + 1);
+  TEST_ASSERT_TRUE(ppu.nmi);
+  TEST_ASSERT_EQUAL_HEX8(PPU_STATUS_VBLANK,
+                         ppu_read_register(&ppu, 0x2002) & 0xE0);
+  TEST_ASSERT_EQUAL_HEX8(0, ppu_read_register(&ppu, 0x2002) & 0xE0);
+}
+
+static void test_odd_frames_skip_a_dot(void) {
+  ppu_write_register(&ppu, 0x2001, PPU_MASK_BACKGROUND);
+  ppu_run_to(&ppu, 2 * PPU_LINES_PER_FRAME * PPU_DOTS_PER_LINE - 1);
+  TEST_ASSERT_EQUAL_UINT64(2, ppu.frame);
+  TEST_ASSERT_EQUAL_UINT16(0, ppu.scanline);
+  TEST_ASSERT_EQUAL_UINT16(0, ppu.dot);
+}
+
+static void test_sprite_zero_hit(void) {
+  fill_scene(&ppu, 0, PPU_MASK_BACKGROUND | PPU_MASK_SPRITES, 0, 0);
+  ppu_run_to(&ppu, PPU_HEIGHT * PPU_DOTS_PER_LINE);
+  TEST_ASSERT_TRUE(ppu.status & PPU_STATUS_SPRITE0);
+}
+
+static void test_chr_bank_switch(void) {
+  // Two 1 KiB banks of CHR, the second drawing tile 0 solid in colour 3.
+  static u8 chr[0x800];
+  static u8 tiles[0x800 * 4];
+  memset(chr + 0x400, 0xFF, 16);
+  chr_decode(chr, sizeof(chr), tiles);
+  ppu_write(&ppu, 0x3F00, 0x0F);
+  ppu_write(&ppu, 0x3F03, 0x16);
+  ppu_write_register(&ppu, 0x2001, PPU_MASK_BACKGROUND |
+                                       PPU_MASK_BACKGROUND_LEFT);
+
+  ppu_map_chr(&ppu, 0, chr, tiles);
+  ppu_run_to(&ppu, PPU_LINES_PER_FRAME * PPU_DOTS_PER_LINE);
+  TEST_ASSERT_EQUAL_HEX8(0x0F, ppu.framebuffer[PPU_WIDTH * 100 + 50]);
+
+  ppu_map_chr(&ppu, 0, chr + 0x400, tiles + 0x1000);
+  ppu_run_to(&ppu, 2 * PPU_LINES_PER_FRAME * PPU_DOTS_PER_LINE);
+  TEST_ASSERT_EQUAL_HEX8(0x16, ppu.framebuffer[PPU_WIDTH * 100 + 50]);
+}
+
+static void test_chr_ram_writes_redecode(void) {
+  ppu_write(&ppu, 0x1013, 0xFF); // Tile $101, row 3, low plane
+  ppu_write(&ppu, 0x101B, 0x0F);
+  const u8 row[8] = {1, 1, 1, 1, 3, 3, 3, 3};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(row, ppu.chr_tiles[4] + 64 + 3 * 8, 8);
+}
+
+static void test_renderers_agree(void) {
+  assert_renderers_agree(0, 0x1E, 0, 0);
+}
+
+static void test_renderers_agree_scrolled(void) {
+  assert_renderers_agree(PPU_CTRL_BACKGROUND_TABLE | 0x01, 0x1E, 0x3B, 0x97);
+}
+
+static void test_renderers_agree_clipped_tall_sprites(void) {
+  assert_renderers_agree(PPU_CTRL_SPRITE_SIZE | 0x02,
+                         PPU_MASK_BACKGROUND | PPU_MASK_SPRITES |
+                             PPU_MASK_GRAYSCALE,
+                         0xFF, 0xEF);
+}
+
+static void test_a12_rises_predicted(void) {
+  memset(ppu.oam, 0xFF, sizeof(ppu.oam));
+  ppu.ctrl = PPU_CTRL_SPRITE_TABLE;
+  ppu.mask = PPU_MASK_BACKGROUND | PPU_MASK_SPRITES;
+  u64 first = ppu_dots_to_a12_rises(&ppu, 1);
+  TEST_ASSERT_EQUAL_UINT64(260, first);
+  ppu_run_to(&ppu, first);
+  TEST_ASSERT_EQUAL_UINT32(0, ppu.a12_rises);
+  ppu_run_to(&ppu, first + 1);
+  TEST_ASSERT_EQUAL_UINT32(1, ppu.a12_rises);
+  // One for every other line drawn and the pre-render line.
+  u64 last = ppu.dots + ppu_dots_to_a12_rises(&ppu, 240);
+  TEST_ASSERT_EQUAL_UINT64(PPU_PRERENDER_LINE * PPU_DOTS_PER_LINE + 260, last);
+  ppu_run_to(&ppu, last + 1);
+  TEST_ASSERT_EQUAL_UINT32(241, ppu.a12_rises);
+
+  // Both tables at $1000: only after vblank, early on the pre-render line
+  // of the next frame.
+  ppu.ctrl |= PPU_CTRL_BACKGROUND_TABLE;
+  u64 next = ppu.dots + ppu_dots_to_a12_rises(&ppu, 1);
+  TEST_ASSERT_EQUAL_UINT64(
+      (PPU_LINES_PER_FRAME + PPU_PRERENDER_LINE) * PPU_DOTS_PER_LINE + 4,
+      next);
+  ppu_run_to(&ppu, next + 1);
+  TEST_ASSERT_EQUAL_UINT32(242, ppu.a12_rises);
+
+  ppu.mask = 0;
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, ppu_dots_to_a12_rises(&ppu, 1));
+}
+
+static void test_a12_with_tall_sprites_is_a_lower_bound(void) {
+  // Eight sprites from $0000 on lines 20-35 take every slot, so those lines'
+  // sprite fetches never reach $1000.
+  memset(ppu.oam, 0xFF, sizeof(ppu.oam));
+  for (u32 i = 0; i < 8; i++) {
+    ppu.oam[i * 4] = 20;
+    ppu.oam[i * 4 + 1] = 0x02;
+  }
+  ppu.ctrl = PPU_CTRL_SPRITE_SIZE;
+  ppu.mask = PPU_MASK_BACKGROUND | PPU_MASK_SPRITES;
+  u64 predicted = ppu_dots_to_a12_rises(&ppu, 21);
+  TEST_ASSERT_EQUAL_UINT64(20 * PPU_DOTS_PER_LINE + 260, predicted);
+  ppu_run_to(&ppu, predicted + 1);
+  TEST_ASSERT_EQUAL_UINT32(20, ppu.a12_rises);
+  ppu_run_to(&ppu, PPU_LINES_PER_FRAME * PPU_DOTS_PER_LINE);
+  TEST_ASSERT_EQUAL_UINT32(241 - 16, ppu.a12_rises);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_scroll_registers);
+  RUN_TEST(test_data_port);
+  RUN_TEST(test_mirroring);
+  RUN_TEST(test_vblank_and_nmi);
+  RUN_TEST(test_odd_frames_skip_a_dot);
+  RUN_TEST(test_sprite_zero_hit);
+  RUN_TEST(test_chr_bank_switch);
+  RUN_TEST(test_a12_rises_predicted);
+  RUN_TEST(test_a12_with_tall_sprites_is_a_lower_bound);
+  RUN_TEST(test_chr_ram_writes_redecode);
+  RUN_TEST(test_renderers_agree);
+  RUN_TEST(test_renderers_agree_scrolled);
+  RUN_TEST(test_renderers_agree_clipped_tall_sprites);
+  return UNITY_END();
+}
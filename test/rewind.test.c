@@ -0,0 +1,90 @@
+#include "counter_rom.h"
+#include "rewind.h"
+#include "state.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FRAMES 200
+#define LONG_RUN 3000
+
+NES nes;
+Rewind rw;
+static char path[] = "/tmp/melnes_rewind_XXXXXX";
+static u8 *history;      // The last FRAMES frames' states
+static u64 ends[LONG_RUN]; // Every frame's last cycle
+
+void setUp(void) {
+  strcpy(path, "/tmp/melnes_rewind_XXXXXX");
+  load_counter_rom(&nes, path);
+  history = malloc((u64)FRAMES * state_size());
+}
+
+void tearDown(void) {
+  free(history);
+  rewind_free(&rw);
+  nes_unload(&nes);
+  unlink(path);
+}
+
+static void run_frames(u32 first, u32 count) {
+  for (u32 frame = first; frame < first + count; frame++) {
+    nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(frame + 1));
+    state_save(&nes, history + (u64)(frame % FRAMES) * state_size());
+    ends[frame] = nes.cpu.cycles;
+    rewind_push(&rw, &nes);
+  }
+}
+
+static void assert_at_frame(u32 frame) {
+  static u8 state[1 << 16];
+  state_save(&nes, state);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(history + (u64)(frame % FRAMES) * state_size(),
+                               state, state_size());
+}
+
+static void test_seek_restores_exact_frames(void) {
+  TEST_ASSERT_EQUAL_INT(0, rewind_init(&rw, 4 << 20, 30));
+  run_frames(0, FRAMES);
+  TEST_ASSERT_EQUAL_UINT32(FRAMES, rw.frames);
+  // Deltas of a frame that counts and scrolls are a tiny part of a state.
+  TEST_ASSERT_TRUE(rw.head < FRAMES * state_size() / 8);
+
+  TEST_ASSERT_EQUAL_INT(0, rewind_seek(&rw, &nes, 0));
+  assert_at_frame(FRAMES - 1);
+  TEST_ASSERT_EQUAL_INT(0, rewind_seek(&rw, &nes, 17));
+  assert_at_frame(FRAMES - 18);
+  TEST_ASSERT_EQUAL_INT(0, rewind_seek(&rw, &nes, 100));
+  assert_at_frame(FRAMES - 118);
+  TEST_ASSERT_EQUAL_UINT32(FRAMES - 117, rw.frames);
+
+  // Recording carries on from where it went back to.
+  run_frames(FRAMES - 117, 50);
+  TEST_ASSERT_EQUAL_INT(0, rewind_seek(&rw, &nes, 1));
+  assert_at_frame(FRAMES - 117 + 48);
+  TEST_ASSERT_EQUAL_INT(-1, rewind_seek(&rw, &nes, FRAMES));
+}
+
+static void test_full_ring_drops_oldest_keyframes(void) {
+  TEST_ASSERT_EQUAL_INT(0, rewind_init(&rw, 128 << 10, 10));
+  run_frames(0, LONG_RUN);
+  TEST_ASSERT_TRUE(rw.frames < LONG_RUN);
+  TEST_ASSERT_TRUE(rw.frames > FRAMES);
+  // The oldest frame held starts a keyframe interval.
+  u32 oldest = LONG_RUN - rw.frames;
+  TEST_ASSERT_EQUAL_UINT32(0, oldest % 10);
+
+  TEST_ASSERT_EQUAL_INT(0, rewind_seek(&rw, &nes, FRAMES - 1));
+  assert_at_frame(LONG_RUN - FRAMES);
+  TEST_ASSERT_EQUAL_INT(0, rewind_seek(&rw, &nes, rw.frames - 1));
+  TEST_ASSERT_EQUAL_UINT64(ends[oldest], nes.cpu.cycles);
+  TEST_ASSERT_EQUAL_UINT32(0, rw.since_keyframe);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_seek_restores_exact_frames);
+  RUN_TEST(test_full_ring_drops_oldest_keyframes);
+  return UNITY_END();
+}
@@ -0,0 +1,168 @@
+#include "rom.h"
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+Rom rom;
+u8 image[16 + 512 + 0x8000 + 0x2000];
+
+static void header(u8 prg, u8 chr, u8 flags6, u8 flags7) {
+  memcpy(image, "NES\x1A", 4);
+  image[4] = prg;
+  image[5] = chr;
+  image[6] = flags6;
+  image[7] = flags7;
+}
+
+void setUp(void) { memset(image, 0, sizeof(image)); }
+
+void tearDown(void) {
+  // Clean up if needed
+}
+
+static void test_ines_header(void) {
+  header(2, 1, 0x11, 0x40);
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, 16 + 0x8000 + 0x2000));
+  TEST_ASSERT_FALSE(rom.nes2);
+  TEST_ASSERT_EQUAL_UINT(0x41, rom.mapper);
+  TEST_ASSERT_EQUAL(MIRROR_VERTICAL, rom.mirroring);
+  TEST_ASSERT_EQUAL_UINT(0x8000, rom.prg_size);
+  TEST_ASSERT_EQUAL_UINT(0x2000, rom.chr_size);
+  TEST_ASSERT_EQUAL_UINT(0, rom.chr_ram_size);
+  TEST_ASSERT_TRUE(rom.prg == image + 16);
+  TEST_ASSERT_TRUE(rom.chr == image + 16 + 0x8000);
+}
+
+static void test_ines_chr_ram_and_trainer(void) {
+  header(1, 0, 0x06, 0x00);
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, 16 + 512 + 0x4000));
+  TEST_ASSERT_TRUE(rom.battery);
+  TEST_ASSERT_EQUAL(MIRROR_HORIZONTAL, rom.mirroring);
+  TEST_ASSERT_TRUE(rom.prg == image + 16 + 512);
+  TEST_ASSERT_NULL(rom.chr);
+  TEST_ASSERT_EQUAL_UINT(0x2000, rom.chr_ram_size);
+}
+
+static void test_ines_dirty_padding_ignores_upper_mapper(void) {
+  header(1, 1, 0x10, 0x40);
+  memcpy(image + 7, "DiskDude!", 9);
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, 16 + 0x4000 + 0x2000));
+  TEST_ASSERT_EQUAL_UINT(1, rom.mapper);
+}
+
+static void test_nes2_header(void) {
+  header(2, 0, 0x48, 0x48);
+  image[8] = 0x31;  // Submapper 3, mapper bits 8-11 = 1
+  image[10] = 0x70; // 8 KiB PRG NVRAM
+  image[11] = 0x09; // 32 KiB CHR RAM
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, 16 + 0x8000));
+  TEST_ASSERT_TRUE(rom.nes2);
+  TEST_ASSERT_EQUAL_UINT(0x144, rom.mapper);
+  TEST_ASSERT_EQUAL_UINT(3, rom.submapper);
+  TEST_ASSERT_EQUAL(MIRROR_FOUR_SCREEN, rom.mirroring);
+  TEST_ASSERT_EQUAL_UINT(0x2000, rom.prg_ram_size);
+  TEST_ASSERT_EQUAL_UINT(0x8000, rom.chr_ram_size);
+}
+
+static void test_nes2_exponent_size(void) {
+  header(0x3C, 0, 0x00, 0x08); // 2^15 * 1
+  image[9] = 0x0F;
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, sizeof(image)));
+  TEST_ASSERT_EQUAL_UINT(0x8000, rom.prg_size);
+  image[4] = 0x3D; // 2^15 * 3
+  TEST_ASSERT_EQUAL(ROM_ERR_SIZE, rom_parse(&rom, image, sizeof(image)));
+  image[4] = 0x7F; // 2^31 * 7, past 32 bits
+  TEST_ASSERT_EQUAL(ROM_ERR_SIZE, rom_parse(&rom, image, sizeof(image)));
+
+  // Too big a CHR size is an error too, not CHR RAM.
+  image[4] = 0x3C;
+  image[5] = 0xFF; // 2^63 * 7
+  image[9] = 0xFF;
+  TEST_ASSERT_EQUAL(ROM_ERR_SIZE, rom_parse(&rom, image, sizeof(image)));
+  TEST_ASSERT_NULL(rom.chr);
+}
+
+static void test_nes2_partial_windows_are_refused(void) {
+  // 3 KiB of PRG and 1 byte of CHR: neither fills a bank.
+  header(0x29, 0x00, 0x00, 0x08); // 2^10 * 3
+  image[9] = 0xFF;
+  TEST_ASSERT_EQUAL(ROM_ERR_FORMAT,
+                    rom_parse(&rom, image, 16 + 0xC00 + 1));
+  header(0x3C, 0x04, 0x00, 0x08); // 2^15 * 1 of PRG, 2^1 of CHR
+  TEST_ASSERT_EQUAL(ROM_ERR_FORMAT, rom_parse(&rom, image, sizeof(image)));
+  image[5] = 0x28; // 2^10, a whole 1 KiB window
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, sizeof(image)));
+  TEST_ASSERT_EQUAL_UINT(0x400, rom.chr_size);
+}
+
+static void test_rejects_bad_files(void) {
+  TEST_ASSERT_EQUAL(ROM_ERR_FORMAT, rom_parse(&rom, image, sizeof(image)));
+  header(2, 1, 0, 0);
+  TEST_ASSERT_EQUAL(ROM_ERR_SIZE, rom_parse(&rom, image, 16 + 0x8000));
+}
+
+static void test_bank_views_wrap(void) {
+  header(1, 1, 0, 0);
+  TEST_ASSERT_EQUAL(ROM_OK, rom_parse(&rom, image, 16 + 0x4000 + 0x2000));
+  TEST_ASSERT_TRUE(rom_prg_bank(&rom, 0, 0x2000) == rom.prg);
+  TEST_ASSERT_TRUE(rom_prg_bank(&rom, 3, 0x2000) == rom.prg + 0x2000);
+  TEST_ASSERT_TRUE(rom_chr_bank(&rom, 9, 0x400) == rom.chr + 0x400);
+}
+
+static void test_load_maps_file(void) {
+  char path[] = "/tmp/melnes_rom_XXXXXX";
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  header(1, 1, 0x01, 0);
+  image[16] = 0xEA;
+  TEST_ASSERT_EQUAL(16 + 0x4000 + 0x2000,
+                    write(fd, image, 16 + 0x4000 + 0x2000));
+  close(fd);
+
+  TEST_ASSERT_EQUAL(ROM_OK, rom_load(&rom, path));
+  TEST_ASSERT_EQUAL_HEX8(0xEA, rom.prg[0]);
+  TEST_ASSERT_EQUAL(MIRROR_VERTICAL, rom.mirroring);
+  rom_unload(&rom);
+  unlink(path);
+  TEST_ASSERT_EQUAL(ROM_ERR_OPEN, rom_load(&rom, path));
+}
+
+static void test_load_decodes_chr(void) {
+  char path[] = "/tmp/melnes_rom_XXXXXX";
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  header(1, 1, 0, 0);
+  image[16 + 0x4000 + 16 + 2] = 0xF0; // Tile 1, row 2, low plane
+  image[16 + 0x4000 + 16 + 8 + 2] = 0x3C;
+  TEST_ASSERT_EQUAL(16 + 0x4000 + 0x2000,
+                    write(fd, image, 16 + 0x4000 + 0x2000));
+  close(fd);
+
+  TEST_ASSERT_EQUAL(ROM_OK, rom_load(&rom, path));
+  // Nothing is decoded until a bank is asked for, and then only that bank.
+  TEST_ASSERT_EQUAL_HEX8(0, rom.chr_decoded[0]);
+  const u8 row[8] = {1, 1, 3, 3, 2, 2, 0, 0};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(row, rom_chr_tiles(&rom, 0, 0x400) + 64 + 2 * 8,
+                               8);
+  TEST_ASSERT_TRUE(rom_chr_tiles(&rom, 9, 0x400) == rom.chr_tiles + 0x1000);
+  TEST_ASSERT_EQUAL_HEX8(0x03, rom.chr_decoded[0]);
+  rom_unload(&rom);
+  unlink(path);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ines_header);
+  RUN_TEST(test_ines_chr_ram_and_trainer);
+  RUN_TEST(test_ines_dirty_padding_ignores_upper_mapper);
+  RUN_TEST(test_nes2_header);
+  RUN_TEST(test_nes2_exponent_size);
+  RUN_TEST(test_nes2_partial_windows_are_refused);
+  RUN_TEST(test_rejects_bad_files);
+  RUN_TEST(test_bank_views_wrap);
+  RUN_TEST(test_load_maps_file);
+  RUN_TEST(test_load_decodes_chr);
+  return UNITY_END();
+}
@@ -0,0 +1,132 @@
+#include "bus.h"
+#include "emu.h"
+#include "runner.h"
+#include "unity.h"
+#include <stdio.h>
+#include <string.h>
+
+NES nes;
+u8 prg[0x4000];
+
+void setUp(void) {
+  for (int i = 0; i < 0x4000; i++) {
+    prg[i] = 0;
+  }
+  // 16 KiB of NROM, so a reset the ROM asks for finds its banks.
+  nes.rom = (Rom){.prg = prg, .prg_size = sizeof(prg)};
+  power_on(&nes.cpu);
+  ppu_power_on(&nes.ppu, &nes.rom);
+  bus_map(&nes.cpu.bus, 0x60, 0x7F, nes.prg_ram, sizeof(nes.prg_ram), 1);
+  TEST_ASSERT_EQUAL_INT(0, mapper_init(&nes.mapper, &nes.rom, &nes.cpu.bus,
+                                       &nes.ppu));
+  TEST_ASSERT_EQUAL_INT(
+      0, apu_power_on(&nes.apu, &nes.cpu.bus, APU_SAMPLE_RATE));
+  nes.cpu.PC = 0xC000;
+}
+
+void tearDown(void) { apu_free(&nes.apu); }
+
+static void test_parse_until(void) {
+  RunConfig config = {0};
+  TEST_ASSERT_EQUAL_INT(0, runner_parse_until(&config, "6000=80"));
+  TEST_ASSERT_TRUE(config.has_until);
+  TEST_ASSERT_FALSE(config.until_not_equal);
+  TEST_ASSERT_EQUAL_HEX16(0x6000, config.until_addr);
+  TEST_ASSERT_EQUAL_HEX8(0x80, config.until_value);
+  TEST_ASSERT_EQUAL_INT(0, runner_parse_until(&config, "00f0!=1"));
+  TEST_ASSERT_TRUE(config.until_not_equal);
+  TEST_ASSERT_EQUAL_HEX16(0x00F0, config.until_addr);
+  TEST_ASSERT_EQUAL_INT(-1, runner_parse_until(&config, "6000"));
+  TEST_ASSERT_EQUAL_INT(-1, runner_parse_until(&config, "6000=100"));
+  TEST_ASSERT_EQUAL_INT(-1, runner_parse_until(&config, "=1"));
+}
+
+static void test_run_until_condition(void) {
+  // INC $6000; JMP $C000
+  u8 code[] = {0xEE, 0x00, 0x60, 0x4C, 0x00, 0xC0};
+  for (u32 i = 0; i < sizeof(code); i++) {
+    prg[i] = code[i];
+  }
+  RunConfig config = {.check_interval = 9};
+  runner_parse_until(&config, "6000=03");
+  RunResult result = runner_run(&nes, &config);
+  TEST_ASSERT_EQUAL(RUN_PASS, result.status);
+  TEST_ASSERT_EQUAL_HEX8(0x03, result.value);
+  TEST_ASSERT_EQUAL_UINT64(27, result.cycles);
+}
+
+static void test_run_timeout(void) {
+  prg[0] = 0x4C; // JMP $C000
+  prg[1] = 0x00;
+  prg[2] = 0xC0;
+  RunConfig config = {.max_cycles = 3000};
+  runner_parse_until(&config, "6000=01");
+  RunResult result = runner_run(&nes, &config);
+  TEST_ASSERT_EQUAL(RUN_TIMEOUT, result.status);
+  TEST_ASSERT_EQUAL_UINT64(3000, result.cycles);
+  TEST_ASSERT_EQUAL_HEX16(0xC000, result.pc);
+}
+
+static void test_run_jam(void) {
+  prg[0] = 0xEA; // NOP
+  prg[1] = 0x02;
+  RunConfig config = {0};
+  RunResult result = runner_run(&nes, &config);
+  TEST_ASSERT_EQUAL(RUN_JAM, result.status);
+  TEST_ASSERT_EQUAL_HEX16(0xC001, result.pc);
+}
+
+static void test_blargg_protocol(void) {
+  const u8 code[] = {
+      0xEE, 0x10, 0x60,                   // INC $6010, counts resets
+      0xA9, 0xDE, 0x8D, 0x01, 0x60,       // The signature
+      0xA9, 0xB0, 0x8D, 0x02, 0x60,       //
+      0xA9, 0x61, 0x8D, 0x03, 0x60,       //
+      0xAD, 0x10, 0x60, 0xC9, 0x02,       // Second time round?
+      0xF0, 0x08,                         // BEQ done
+      0xA9, 0x81, 0x8D, 0x00, 0x60,       // Ask for a reset
+      0x4C, 0x1E, 0xC0,                   // JMP *
+      0xA9, 'o', 0x8D, 0x04, 0x60,        // done: "ok\n"
+      0xA9, 'k', 0x8D, 0x05, 0x60,        //
+      0xA9, '\n', 0x8D, 0x06, 0x60,       //
+      0xA9, 0x00, 0x8D, 0x07, 0x60,       //
+      0x8D, 0x00, 0x60, 0x4C, 0x38, 0xC0, // Passed, JMP *
+  };
+  memcpy(prg, code, sizeof(code));
+  prg[0x3FFD] = 0xC0; // Reset vector
+  memset(nes.prg_ram, 0, sizeof(nes.prg_ram));
+  RunConfig config = {.max_cycles = FRAMES_TO_CPU_CYCLES(60)};
+  TEST_ASSERT_EQUAL_INT(0, runner_parse_until(&config, "blargg"));
+  RunResult result = runner_run(&nes, &config);
+  TEST_ASSERT_EQUAL(RUN_PASS, result.status);
+  TEST_ASSERT_EQUAL_HEX8(2, nes.prg_ram[0x10]);
+  TEST_ASSERT_EQUAL_STRING("ok", result.message);
+
+  nes.cpu.PC = 0xC035;
+  nes.cpu.A = 0x03; // Fails with code 3 instead
+  result = runner_run(&nes, &config);
+  TEST_ASSERT_EQUAL(RUN_FAIL, result.status);
+  TEST_ASSERT_EQUAL_HEX8(0x03, result.value);
+
+  char line[256];
+  FILE *out = tmpfile();
+  runner_print_unity(out, "fail.nes", &result, RUN_FAIL);
+  runner_print_unity(out, "fail.nes", &result, RUN_PASS);
+  rewind(out);
+  TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), out));
+  TEST_ASSERT_EQUAL_STRING("fail.nes:0:romtest:PASS\n", line);
+  TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), out));
+  TEST_ASSERT_NOT_NULL(strstr(line, ":romtest:FAIL: expected pass, got fail"));
+  TEST_ASSERT_NOT_NULL(strstr(line, "value=03: ok\n"));
+  fclose(out);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_until);
+  RUN_TEST(test_run_until_condition);
+  RUN_TEST(test_run_timeout);
+  RUN_TEST(test_run_jam);
+  RUN_TEST(test_blargg_protocol);
+  return UNITY_END();
+}
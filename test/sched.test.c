@@ -0,0 +1,53 @@
+#include "sched.h"
+#include "unity.h"
+#include <stdint.h>
+
+Scheduler sched;
+
+void setUp(void) { sched_init(&sched); }
+
+void tearDown(void) {
+  // Clean up if needed
+}
+
+static void test_pops_in_time_order(void) {
+  const u64 times[] = {90, 15, 40, 15, 70, 3, 88, 41, 60, 12, 55, 99};
+  for (u8 id = 0; id < sizeof(times) / sizeof(times[0]); id++) {
+    sched_set(&sched, id, times[id]);
+  }
+  TEST_ASSERT_EQUAL_UINT64(3, sched_next(&sched));
+  TEST_ASSERT_EQUAL_HEX8(SCHED_IDLE, sched_pop(&sched, 2));
+
+  u64 last = 0;
+  for (u32 i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+    u8 id = sched_pop(&sched, UINT64_MAX);
+    TEST_ASSERT_NOT_EQUAL(SCHED_IDLE, id);
+    TEST_ASSERT_TRUE(times[id] >= last);
+    last = times[id];
+  }
+  TEST_ASSERT_EQUAL_HEX8(SCHED_IDLE, sched_pop(&sched, UINT64_MAX));
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, sched_next(&sched));
+}
+
+static void test_reschedule_and_cancel(void) {
+  for (u8 id = 0; id < 8; id++) {
+    sched_set(&sched, id, 100 + id * 10);
+  }
+  sched_set(&sched, 5, 20);  // Earlier
+  sched_set(&sched, 0, 500); // Later
+  sched_cancel(&sched, 1);
+  sched_cancel(&sched, 1); // Already gone
+  sched_set(&sched, 1, 300);
+
+  const u8 order[] = {5, 2, 3, 4, 6, 7, 1, 0};
+  for (u32 i = 0; i < sizeof(order); i++) {
+    TEST_ASSERT_EQUAL_HEX8(order[i], sched_pop(&sched, UINT64_MAX));
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_pops_in_time_order);
+  RUN_TEST(test_reschedule_and_cancel);
+  return UNITY_END();
+}
@@ -0,0 +1,143 @@
+#include "bus.h"
+#include "counter_rom.h"
+#include "state.h"
+#include "unity.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+NES nes;
+static char path[] = "/tmp/melnes_state_XXXXXX";
+static char state_path[] = "/tmp/melnes_state_XXXXXX";
+static u8 state[1 << 16];
+
+void setUp(void) {
+  strcpy(path, "/tmp/melnes_state_XXXXXX");
+  load_counter_rom(&nes, path);
+  TEST_ASSERT_TRUE(state_size() <= sizeof(state));
+}
+
+void tearDown(void) {
+  nes_unload(&nes);
+  unlink(path);
+}
+
+static void test_restore_replays_the_same_run(void) {
+  nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(2) + 1234);
+  state_save(&nes, state);
+  nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(5));
+  static CPU expected_cpu;
+  static PPU expected_ppu;
+  expected_cpu = nes.cpu;
+  expected_ppu = nes.ppu;
+
+  TEST_ASSERT_EQUAL(STATE_OK, state_load(&nes, state, state_size()));
+  TEST_ASSERT_TRUE(nes.cpu.cycles < expected_cpu.cycles);
+  nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(5));
+  TEST_ASSERT_EQUAL_UINT64(expected_cpu.cycles, nes.cpu.cycles);
+  TEST_ASSERT_EQUAL_HEX16(expected_cpu.PC, nes.cpu.PC);
+  TEST_ASSERT_EQUAL_HEX8(expected_cpu.X, nes.cpu.X);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_cpu.ram, nes.cpu.ram,
+                               sizeof(nes.cpu.ram));
+  TEST_ASSERT_EQUAL_HEX16(expected_ppu.t, nes.ppu.t);
+  TEST_ASSERT_EQUAL_UINT64(expected_ppu.dots, nes.ppu.dots);
+}
+
+static void test_restore_rebuilds_chr_ram_tiles(void) {
+  ppu_write(&nes.ppu, 0x0013, 0xFF); // Tile 1, row 3, low plane
+  state_save(&nes, state);
+  ppu_write(&nes.ppu, 0x0013, 0x00);
+  ppu_map_chr(&nes.ppu, 0, nes.ppu.chr_ram + 0x400,
+              nes.ppu.chr_ram_tiles + 0x1000);
+
+  TEST_ASSERT_EQUAL(STATE_OK, state_load(&nes, state, state_size()));
+  TEST_ASSERT_TRUE(nes.ppu.chr[0] == nes.ppu.chr_ram);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, ppu_read(&nes.ppu, 0x0013));
+  TEST_ASSERT_EQUAL_HEX8(1, nes.ppu.chr_tiles[0][64 + 3 * 8]);
+}
+
+static void test_restore_maps_the_saved_banks(void) {
+  // UxROM with four 16 KiB banks.
+  static u8 uxrom[16 + 4 * 0x4000];
+  memcpy(uxrom, "NES\x1A\x04\x00\x20", 7);
+  nes_unload(&nes);
+  int fd = open(path, O_WRONLY | O_TRUNC);
+  TEST_ASSERT_EQUAL(sizeof(uxrom), write(fd, uxrom, sizeof(uxrom)));
+  close(fd);
+  TEST_ASSERT_EQUAL(ROM_OK, nes_load(&nes, path));
+
+  mapper_write(&nes.mapper, 0x8000, 2);
+  state_save(&nes, state);
+  mapper_write(&nes.mapper, 0x8000, 1);
+  TEST_ASSERT_TRUE(nes.cpu.bus.read[0x80] == rom_prg_bank(&nes.rom, 1, 0x4000));
+  TEST_ASSERT_EQUAL(STATE_OK, state_load(&nes, state, state_size()));
+  TEST_ASSERT_TRUE(nes.cpu.bus.read[0x80] == rom_prg_bank(&nes.rom, 2, 0x4000));
+  TEST_ASSERT_TRUE(nes.cpu.bus.read[0xFF] ==
+                   rom_prg_bank(&nes.rom, 3, 0x4000) + 0x3F00);
+}
+
+static void test_update_copies_written_pages(void) {
+  static u8 fresh[1 << 16];
+  nes_run_until(&nes, 5000);
+  state_save(&nes, state);
+  bus_clear_dirty(&nes.cpu.bus);
+  nes_run_until(&nes, FRAMES_TO_CPU_CYCLES(2));
+  state_update(&nes, state);
+  state_save(&nes, fresh);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(fresh, state, state_size());
+
+  // Memory changed without going through the bus isn't looked at again.
+  nes.cpu.ram[0x400] = 0x55;
+  nes.prg_ram[0x1000] = 0x66;
+  state_update(&nes, state);
+  state_save(&nes, fresh);
+  TEST_ASSERT_TRUE(memcmp(fresh, state, state_size()) != 0);
+}
+
+static void test_file_round_trip_and_rejects(void) {
+  nes_run_until(&nes, 5000);
+  strcpy(state_path, "/tmp/melnes_state_XXXXXX");
+  close(mkstemp(state_path));
+  TEST_ASSERT_EQUAL(STATE_OK, state_save_file(&nes, state_path));
+  nes_run_until(&nes, 9000);
+  TEST_ASSERT_EQUAL(STATE_OK, state_load_file(&nes, state_path));
+  TEST_ASSERT_TRUE(nes.cpu.cycles < 5010);
+  unlink(state_path);
+  TEST_ASSERT_EQUAL(STATE_ERR_OPEN, state_load_file(&nes, state_path));
+
+  // Rejected states leave the machine alone.
+  state_save(&nes, state);
+  u64 cycles = nes.cpu.cycles;
+  TEST_ASSERT_EQUAL(STATE_ERR_FORMAT, state_load(&nes, state, 100));
+  state[4]++; // Version
+  TEST_ASSERT_EQUAL(STATE_ERR_VERSION, state_load(&nes, state, state_size()));
+  state[4]--;
+  nes.rom.prg_size *= 2;
+  TEST_ASSERT_EQUAL(STATE_ERR_ROM, state_load(&nes, state, state_size()));
+  nes.rom.prg_size /= 2;
+  // The first CHR window, moved to partway into a 1 KiB bank. The windows
+  // are the last chunk.
+  u8 *chr = state + state_size() - 12 * sizeof(u32);
+  u32 window;
+  memcpy(&window, chr, sizeof(window));
+  window += 0x200;
+  memcpy(chr, &window, sizeof(window));
+  TEST_ASSERT_EQUAL(STATE_ERR_FORMAT, state_load(&nes, state, state_size()));
+  window -= 0x200;
+  memcpy(chr, &window, sizeof(window));
+  TEST_ASSERT_EQUAL(STATE_OK, state_load(&nes, state, state_size()));
+  state[0] = 'X';
+  TEST_ASSERT_EQUAL(STATE_ERR_FORMAT, state_load(&nes, state, state_size()));
+  TEST_ASSERT_EQUAL_UINT64(cycles, nes.cpu.cycles);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_restore_replays_the_same_run);
+  RUN_TEST(test_restore_rebuilds_chr_ram_tiles);
+  RUN_TEST(test_restore_maps_the_saved_banks);
+  RUN_TEST(test_update_copies_written_pages);
+  RUN_TEST(test_file_round_trip_and_rejects);
+  return UNITY_END();
+}
@@ -0,0 +1,74 @@
+#include "tile.h"
+#include "unity.h"
+
+u8 lo[256];
+u8 hi[256];
+u8 palette[256];
+u8 expected[256 * 8];
+u8 out[256 * 8 + 1];
+
+void setUp(void) {
+  // Clean up if needed
+}
+
+void tearDown(void) {
+  // Clean up if needed
+}
+
+// Pixel by pixel, the way the dot renderer reads the shifters.
+static void reference(u32 count) {
+  for (u32 i = 0; i < count; i++) {
+    for (u32 px = 0; px < 8; px++) {
+      u8 bit = 7 - px;
+      expected[i * 8 + px] = (palette[i] << 2) | ((lo[i] >> bit) & 1) |
+                             (((hi[i] >> bit) & 1) << 1);
+    }
+  }
+}
+
+static void test_every_plane_pair(void) {
+  const TileDecoder *decoders;
+  u32 count = tile_decoders(&decoders);
+  for (u32 h = 0; h < 256; h++) {
+    for (u32 l = 0; l < 256; l++) {
+      lo[l] = l;
+      hi[l] = h;
+      palette[l] = (l + h) & 3;
+    }
+    reference(256);
+    for (u32 d = 0; d < count; d++) {
+      decoders[d].decode(lo, hi, palette, 256, out);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, out, 256 * 8,
+                                           decoders[d].name);
+    }
+  }
+}
+
+static void test_partial_batches(void) {
+  // Counts that leave rows over for the scalar tail, without writing past
+  // the last row.
+  const TileDecoder *decoders;
+  u32 count = tile_decoders(&decoders);
+  for (u32 i = 0; i < 8; i++) {
+    lo[i] = 0xA5 + i * 17;
+    hi[i] = 0x3C ^ (i * 29);
+    palette[i] = i & 3;
+  }
+  for (u32 rows = 1; rows <= 7; rows++) {
+    reference(rows);
+    for (u32 d = 0; d < count; d++) {
+      out[rows * 8] = 0xEE;
+      decoders[d].decode(lo, hi, palette, rows, out);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, out, rows * 8,
+                                           decoders[d].name);
+      TEST_ASSERT_EQUAL_HEX8(0xEE, out[rows * 8]);
+    }
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_plane_pair);
+  RUN_TEST(test_partial_batches);
+  return UNITY_END();
+}
@@ -0,0 +1,90 @@
+#include "bus.h"
+#include "emu.h"
+#include "opcode.h"
+#include "trace.h"
+#include "unity.h"
+#include <stdio.h>
+#include <string.h>
+
+CPU cpu;
+Trace trace;
+u8 mem[0x10000];
+static const char path[] = "/tmp/melnes_trace.bin";
+
+// The first lines of nestest.log in automation mode.
+static const char *const NESTEST[] = {
+    "C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 "
+    "SP:FD PPU:  0, 21 CYC:7",
+    "C5F5  A2 00     LDX #$00                        A:00 X:00 Y:00 P:24 "
+    "SP:FD PPU:  0, 30 CYC:10",
+    // nestest.log adds " = 00", the value at $00, which isn't recorded.
+    "C5F7  86 00     STX $00                         A:00 X:00 Y:00 P:26 "
+    "SP:FD PPU:  0, 36 CYC:12",
+};
+
+void setUp(void) {
+  memset(mem, 0, sizeof(mem));
+  const u8 code[] = {0x4C, 0xF5, 0xC5};
+  const u8 jumped[] = {0xA2, 0x00, 0x86, 0x00, 0x86, 0x10};
+  memcpy(mem + 0xC000, code, sizeof(code));
+  memcpy(mem + 0xC5F5, jumped, sizeof(jumped));
+  power_on(&cpu);
+  bus_map(&cpu.bus, 0x00, 0xFF, mem, sizeof(mem), 1);
+  cpu.PC = 0xC000;
+  cpu.S = 0xFD;
+  set_status(&cpu, 0x24);
+  cpu.cycles = 7;
+  TEST_ASSERT_EQUAL_INT(0, trace_init(&trace, 3));
+  cpu.trace = &trace;
+}
+
+void tearDown(void) {
+  trace_free(&trace);
+  remove(path);
+}
+
+static void test_records_nestest_lines(void) {
+  run_until(&cpu, 15);
+  TEST_ASSERT_EQUAL_UINT64(3, trace.count);
+  char line[TRACE_LINE_SIZE];
+  for (u32 i = 0; i < 3; i++) {
+    trace_format(line, &trace.entries[i]);
+    TEST_ASSERT_EQUAL_STRING(NESTEST[i], line);
+  }
+}
+
+static void test_saves_the_newest_entries(void) {
+  // Room for 4, so the fifth instruction overwrites the first.
+  run_until(&cpu, 19);
+  TEST_ASSERT_EQUAL_UINT64(5, trace.count);
+  TEST_ASSERT_EQUAL_INT(0, trace_save(&trace, path));
+
+  FILE *out = tmpfile();
+  TEST_ASSERT_EQUAL_INT(0, trace_print(out, path));
+  rewind(out);
+  char line[TRACE_LINE_SIZE];
+  TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), out));
+  line[strcspn(line, "\n")] = '\0';
+  TEST_ASSERT_EQUAL_STRING(NESTEST[1], line);
+  u32 lines = 1;
+  while (fgets(line, sizeof(line), out)) {
+    lines++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(4, lines);
+  TEST_ASSERT_EQUAL_INT(-1, trace_print(out, "/nonexistent/trace"));
+  fclose(out);
+}
+
+static void test_rejects_capacities_past_2_31(void) {
+  Trace huge;
+  TEST_ASSERT_EQUAL_INT(-1, trace_init(&huge, TRACE_MAX_CAPACITY + 1));
+  TEST_ASSERT_NULL(huge.entries);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_nestest_lines);
+  RUN_TEST(test_saves_the_newest_entries);
+  RUN_TEST(test_rejects_capacities_past_2_31);
+  return UNITY_END();
+}